@@ -0,0 +1,362 @@
+#ifndef AL_ALEXT_H
+#define AL_ALEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "al.h"
+#include "alc.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Extensions that mojoAL implements beyond core OpenAL 1.1. */
+
+/* Enumerant values begin at column 50. No tabs. */
+
+/**
+ * ALC_SOFT_loopback
+ *
+ * A loopback device never opens an SDL device; the app pulls mixes from it
+ * with alcRenderSamplesSOFT, on its own thread and at its own pace. The
+ * first context fixes the rate and channel layout. Only ALC_FLOAT_SOFT
+ * samples are rendered, since that's what the mixer works in. The channel
+ * layout attribute also applies to regular devices.
+ */
+#ifndef ALC_FORMAT_CHANNELS_SOFT
+#define ALC_FORMAT_CHANNELS_SOFT                 0x1990
+#define ALC_MONO_SOFT                            0x1500
+#define ALC_STEREO_SOFT                          0x1501
+#define ALC_QUAD_SOFT                            0x1503
+#define ALC_5POINT1_SOFT                         0x1504
+#define ALC_6POINT1_SOFT                         0x1505
+#define ALC_7POINT1_SOFT                         0x1506
+#endif
+
+#ifndef ALC_SOFT_loopback
+#define ALC_SOFT_loopback 1
+#define ALC_FORMAT_TYPE_SOFT                     0x1991
+#define ALC_FLOAT_SOFT                           0x1406
+
+ALC_API ALCdevice* ALC_APIENTRY alcLoopbackOpenDeviceSOFT(const ALCchar *deviceName);
+ALC_API ALCboolean ALC_APIENTRY alcIsRenderFormatSupportedSOFT(ALCdevice *device, ALCsizei freq, ALCenum channels, ALCenum type);
+ALC_API void ALC_APIENTRY alcRenderSamplesSOFT(ALCdevice *device, ALCvoid *buffer, ALCsizei samples);
+typedef ALCdevice*    (ALC_APIENTRY *LPALCLOOPBACKOPENDEVICESOFT)(const ALCchar *deviceName);
+typedef ALCboolean    (ALC_APIENTRY *LPALCISRENDERFORMATSUPPORTEDSOFT)(ALCdevice *device, ALCsizei freq, ALCenum channels, ALCenum type);
+typedef void          (ALC_APIENTRY *LPALCRENDERSAMPLESSOFT)(ALCdevice *device, ALCvoid *buffer, ALCsizei samples);
+#endif
+
+/**
+ * ALC_EXT_thread_local_context
+ *
+ * alcSetThreadContext makes a context current on the calling thread only,
+ * over the one from alcMakeContextCurrent, so threads can each work on their
+ * own context. NULL goes back to the process-wide one. Loopback devices are
+ * rendered under their own lock instead of the API lock, so loopback devices
+ * on different threads mix in parallel.
+ */
+#ifndef ALC_EXT_thread_local_context
+#define ALC_EXT_thread_local_context 1
+ALC_API ALCboolean ALC_APIENTRY alcSetThreadContext(ALCcontext *context);
+ALC_API ALCcontext* ALC_APIENTRY alcGetThreadContext(void);
+typedef ALCboolean    (ALC_APIENTRY *PFNALCSETTHREADCONTEXTPROC)(ALCcontext *context);
+typedef ALCcontext*   (ALC_APIENTRY *PFNALCGETTHREADCONTEXTPROC)(void);
+#endif
+
+/** AL_EXT_FLOAT32 formats, converted on upload like the integer formats. */
+#ifndef AL_FORMAT_MONO_FLOAT32
+#define AL_FORMAT_MONO_FLOAT32                   0x10010
+#define AL_FORMAT_STEREO_FLOAT32                 0x10011
+#endif
+
+/**
+ * AL_EXT_IMA4
+ *
+ * IMA ADPCM buffers in the OpenAL Soft block layout: 65 sample frames per
+ * block, 36 bytes per channel. Each block starts with a 4 byte header per
+ * channel (little endian int16 first sample, step index, padding), followed
+ * by the remaining 64 samples as nibbles, low nibble first, in 4 byte runs
+ * interleaved by channel. Unlike other formats the buffer stays compressed
+ * and the mixer decodes it a block at a time as it plays, so it holds about
+ * a seventh of the float32 copy other formats keep.
+ *
+ * Data is always whole blocks, so the last one is padded out to 65 frames.
+ * alBufferi(AL_BUFFER_FRAMES_SG) trims a IMA4 buffer to the frames it really
+ * has, so it loops and ends without the padding. It can't be longer than the
+ * blocks hold, and like alBufferData it fails while the buffer is in use.
+ */
+#ifndef AL_EXT_IMA4
+#define AL_EXT_IMA4 1
+#define AL_FORMAT_MONO_IMA4                      0x1300
+#define AL_FORMAT_STEREO_IMA4                    0x1301
+#endif
+#define AL_BUFFER_FRAMES_SG                      0x19F0
+
+/**
+ * ALC_SG_device_config
+ *
+ * Context attribute: <int> sample frames mixed per device callback. The
+ * device is opened with this period when the first context is created, so
+ * it has no effect on later contexts on the same device.
+ */
+#define ALC_SG_device_config 1
+#define ALC_PERIOD_SIZE_SG                       0x19A0
+
+/**
+ * ALC_SG_parallel_mix
+ *
+ * Context attribute: <int> worker threads that mix a share of each context's
+ * playing sources alongside the device callback, 0 (the default) mixes them
+ * all on the callback. Contexts with only a few playing sources still mix on
+ * the callback alone. Like ALC_PERIOD_SIZE_SG it is fixed by the first
+ * context on a device, and alcGetIntegerv gives how many workers started.
+ */
+#define ALC_SG_parallel_mix 1
+#define ALC_MIX_THREADS_SG                       0x19A1
+
+/**
+ * ALC_SG_callback_timing
+ *
+ * The device times every mix against how long the frames it mixed take to
+ * play, the deadline past which the output runs dry. Mixes are counted in a
+ * histogram of that ratio: bucket i holds mixes that took between i and i+1
+ * 128ths of their deadline, and the last bucket also holds everything slower.
+ * Loopback renders are timed the same way, a period at a time.
+ * alcGetCallbackTimingSG copies the counts, and zeroes them if reset is set.
+ */
+#define ALC_SG_callback_timing 1
+#define ALC_TIMING_BUCKETS_SG                    512
+#define ALC_TIMING_BUCKETS_PER_DEADLINE_SG       128
+
+typedef struct ALCcallbackTimingSG
+{
+    ALCuint callbacks;
+    ALCuint overruns;        /* mixes that took longer than their deadline */
+    ALCuint max_usec;        /* the slowest mix */
+    ALCuint deadline_usec;   /* the deadline of the last mix */
+    ALCuint buckets[ALC_TIMING_BUCKETS_SG];
+} ALCcallbackTimingSG;
+
+ALC_API ALCboolean ALC_APIENTRY alcGetCallbackTimingSG(ALCdevice *device, ALCcallbackTimingSG *timing, ALCboolean reset);
+typedef ALCboolean    (ALC_APIENTRY *LPALCGETCALLBACKTIMINGSG)(ALCdevice *device, ALCcallbackTimingSG *timing, ALCboolean reset);
+
+/**
+ * ALC_SG_clock
+ *
+ * A playback device counts the sample frames it has mixed, from 0 when it is
+ * opened, at the device frequency. alcGetClockSG returns the frame the next
+ * mix starts at. Loopback devices count the frames rendered.
+ */
+#define ALC_SG_clock 1
+
+typedef uint64_t ALuint64SG;
+
+ALC_API ALuint64SG ALC_APIENTRY alcGetClockSG(ALCdevice *device);
+typedef ALuint64SG    (ALC_APIENTRY *LPALCGETCLOCKSG)(ALCdevice *device);
+
+/**
+ * AL_SG_source_events
+ *
+ * While the AL_SOURCE_EVENTS_SG capability is enabled, the mixer records
+ * when it finishes a source or a queued buffer. alGetEventsSG drains them in
+ * the order they happened. The queue is a fixed size; if the mixer finds it
+ * full it drops the event and flags the overflow, which is reported (and
+ * cleared) by the next alGetEventsSG call, so the app can fall back to
+ * polling its sources once.
+ */
+#define AL_SG_source_events 1
+#define AL_SOURCE_EVENTS_SG                      0x19B0
+#define AL_EVENT_SOURCE_STOPPED_SG               0x19B1
+#define AL_EVENT_BUFFER_PROCESSED_SG             0x19B2
+
+typedef struct ALeventSG
+{
+    ALenum type;
+    ALuint source;
+} ALeventSG;
+
+AL_API ALsizei AL_APIENTRY alGetEventsSG(ALeventSG *events, ALsizei maxevents, ALboolean *overflowed);
+typedef ALsizei       (AL_APIENTRY *LPALGETEVENTSSG)(ALeventSG *events, ALsizei maxevents, ALboolean *overflowed);
+
+/**
+ * AL_SG_source_start_batch
+ *
+ * alSourceStartBatchSG sets the static buffer, gain, pitch, position,
+ * distance attenuation, looping and sample offset of each source and then
+ * plays them all, taking the API lock once and submitting them to the mixer
+ * together, so they start in the same mix. Sources must not be playing or
+ * paused. A start_frame of 0 starts right away, otherwise the source starts
+ * at that device clock frame as with alSourcePlayAtSG. bus is the source's
+ * AL_BUS_SG (AL_SG_buses).
+ */
+#define AL_SG_source_start_batch 1
+
+typedef struct ALsourceStartSG
+{
+    ALuint source;
+    ALuint buffer;
+    ALfloat gain;
+    ALfloat pitch;
+    ALfloat position[3];
+    ALboolean relative;
+    ALfloat reference_distance;
+    ALfloat max_distance;
+    ALfloat rolloff_factor;
+    ALboolean looping;
+    ALint sample_offset;
+    ALuint64SG start_frame;
+    ALuint bus;
+} ALsourceStartSG;
+
+AL_API void AL_APIENTRY alSourceStartBatchSG(const ALsourceStartSG *starts, ALsizei n);
+typedef void          (AL_APIENTRY *LPALSOURCESTARTBATCHSG)(const ALsourceStartSG *starts, ALsizei n);
+
+/**
+ * AL_SG_scheduling
+ *
+ * alSourcePlayAtSG plays a source, but the mixer holds it silent until the
+ * device clock (ALC_SG_clock) reaches frame, and starts it on that frame
+ * even if it is partway into a mix. The source is AL_PLAYING while it waits.
+ * alSourceStopAtSG stops a playing source on a frame the same way, as if
+ * alSourceStop was called right then, and is cancelled by playing it again.
+ * Frames the clock has already passed take effect at the start of the next
+ * mix.
+ */
+#define AL_SG_scheduling 1
+
+AL_API void AL_APIENTRY alSourcePlayAtSG(ALuint source, ALuint64SG frame);
+AL_API void AL_APIENTRY alSourceStopAtSG(ALuint source, ALuint64SG frame);
+typedef void          (AL_APIENTRY *LPALSOURCEPLAYATSG)(ALuint source, ALuint64SG frame);
+typedef void          (AL_APIENTRY *LPALSOURCESTOPATSG)(ALuint source, ALuint64SG frame);
+
+/**
+ * AL_SG_positions
+ *
+ * alUpdatePositionsSG moves the listener and any number of sources under
+ * one API lock, for apps that move everything once a frame. If listener is
+ * not NULL it is the listener position, at and up vectors, nine floats.
+ * positions holds three floats for each source. Invalid source names set
+ * AL_INVALID_NAME and are skipped; the rest still move.
+ */
+#define AL_SG_positions 1
+
+AL_API void AL_APIENTRY alUpdatePositionsSG(const ALfloat *listener, const ALuint *sources, const ALfloat *positions, ALsizei n);
+typedef void          (AL_APIENTRY *LPALUPDATEPOSITIONSSG)(const ALfloat *listener, const ALuint *sources, const ALfloat *positions, ALsizei n);
+
+/**
+ * AL_SG_stems
+ *
+ * A stem buffer holds the stems of one song interleaved frame by frame, each
+ * stem in the layout of format, so the stems can never drift apart. A source
+ * playing stem buffers is told how many stems they hold with AL_STEMS_SG, and
+ * the mixer folds them down to one stem with a gain for each before panning.
+ * alSourceStemGainsSG sets those gains, ramping from the current ones over
+ * ramp_frames device frames so stems fade without clicks; stems past n keep
+ * theirs. Stem gains start at 1. Stems times channels can be at most
+ * AL_MAX_STEM_CHANNELS_SG, and IMA4 formats can't be stems.
+ */
+#define AL_SG_stems 1
+#define AL_STEMS_SG                              0x19C0
+#define AL_MAX_STEM_CHANNELS_SG                  8
+
+AL_API void AL_APIENTRY alBufferStemsSG(ALuint buffer, ALenum format, ALsizei stems, const ALvoid *data, ALsizei size, ALsizei freq);
+AL_API void AL_APIENTRY alSourceStemGainsSG(ALuint source, const ALfloat *gains, ALsizei n, ALsizei ramp_frames);
+typedef void          (AL_APIENTRY *LPALBUFFERSTEMSSG)(ALuint buffer, ALenum format, ALsizei stems, const ALvoid *data, ALsizei size, ALsizei freq);
+typedef void          (AL_APIENTRY *LPALSOURCESTEMGAINSSG)(ALuint source, const ALfloat *gains, ALsizei n, ALsizei ramp_frames);
+
+/**
+ * AL_SG_profile
+ *
+ * Only advertised when mojoAL is built with MOJOAL_PROFILE, otherwise the
+ * hooks are accepted and never called. The begin hook is
+ * called as the mixer starts some work and the end hook as it finishes, on
+ * the thread doing it, so spans nest per thread. Names are string literals
+ * that live forever, and the argument depends on the span:
+ *   DeviceCallback  sample frames the device asked for
+ *   RenderSamples   sample frames a loopback device was asked for
+ *   MixSource       the source name
+ *   BufferData      bytes given to alBufferData, covering its conversion
+ * Pass NULL hooks to stop. Hooks must be cheap, they run on the audio thread.
+ */
+#define AL_SG_profile 1
+
+typedef void          (AL_APIENTRY *ALPROFILEBEGINSG)(const char *name, ALuint arg);
+typedef void          (AL_APIENTRY *ALPROFILEENDSG)(void);
+
+AL_API void AL_APIENTRY alProfileHooksSG(ALPROFILEBEGINSG begin, ALPROFILEENDSG end);
+typedef void          (AL_APIENTRY *LPALPROFILEHOOKSSG)(ALPROFILEBEGINSG begin, ALPROFILEENDSG end);
+
+/**
+ * AL_SG_allocator
+ *
+ * alAllocatorSG replaces the allocator for everything mojoAL owns: devices,
+ * contexts, sources, buffer data and mix buffers. Memory SDL allocates for
+ * itself isn't covered. Memory must go back to the allocator that made it,
+ * so this fails and returns AL_FALSE while any device is open. Pass all
+ * three functions, or all NULL to go back to SDL's allocator. realloc gets
+ * NULL like realloc() does, but free never gets NULL.
+ */
+#define AL_SG_allocator 1
+
+typedef void *        (AL_APIENTRY *ALMALLOCSG)(size_t len, void *userdata);
+typedef void *        (AL_APIENTRY *ALREALLOCSG)(void *ptr, size_t len, void *userdata);
+typedef void          (AL_APIENTRY *ALFREESG)(void *ptr, void *userdata);
+
+AL_API ALboolean AL_APIENTRY alAllocatorSG(ALMALLOCSG malloc_fn, ALREALLOCSG realloc_fn, ALFREESG free_fn, void *userdata);
+typedef ALboolean     (AL_APIENTRY *LPALALLOCATORSG)(ALMALLOCSG malloc_fn, ALREALLOCSG realloc_fn, ALFREESG free_fn, void *userdata);
+
+/**
+ * AL_SG_buses
+ *
+ * Every context has AL_MAX_BUSES_SG buses that its sources mix through. Bus
+ * 0 is the master bus, and every other bus has a parent with a lower index,
+ * bus 0 to start with, so they form a tree with master at the root. A bus's
+ * AL_GAIN, AL_BUS_MUTED_SG and AL_BUS_PAUSED_SG apply to the sources on it
+ * and to every bus under it. The mixer works out each bus's gain down to
+ * master once per mix and applies it with the gain the sources already mix
+ * at, so changing a bus costs the same however many sources are on it and
+ * recalculates none of them. Sources on a muted bus play on silently, and
+ * sources on a paused bus stay AL_PLAYING but don't move until it unpauses;
+ * one waiting on a start frame starts late if that frame passes while paused.
+ * A source's AL_BUS_SG picks its bus, 0 to start with.
+ */
+#define AL_SG_buses 1
+#define AL_BUS_SG                                0x19D0
+#define AL_BUS_PARENT_SG                         0x19D1
+#define AL_BUS_MUTED_SG                          0x19D2
+#define AL_BUS_PAUSED_SG                         0x19D3
+#define AL_MAX_BUSES_SG                          16
+
+AL_API void AL_APIENTRY alBusfSG(ALuint bus, ALenum param, ALfloat value);
+AL_API void AL_APIENTRY alBusiSG(ALuint bus, ALenum param, ALint value);
+typedef void          (AL_APIENTRY *LPALBUSFSG)(ALuint bus, ALenum param, ALfloat value);
+typedef void          (AL_APIENTRY *LPALBUSISG)(ALuint bus, ALenum param, ALint value);
+
+/**
+ * AL_SG_fades
+ *
+ * alSourceFadeSG sets a source's AL_GAIN to gain, but the mixer ramps to it
+ * a sample at a time over frames device frames, instead of stepping to it at
+ * the next mix. AL_GAIN reads back as gain right away. A fade started during
+ * another carries on from wherever that one got to, and frames of 0 sets the
+ * gain like AL_GAIN does. If stop is set the source stops on the frame the
+ * fade ends, as if alSourceStop was called right then, and 0 frames stops it
+ * now. Setting AL_GAIN cancels a fade, and a source that stops before its
+ * fade is done jumps to the end of it. AL_MIN_GAIN and AL_MAX_GAIN don't
+ * clamp a fade while it is ramping. A source's AL_FADE_GAIN_SG reads the gain
+ * its fade is at now, AL_GAIN if it isn't fading, and AL_FADE_FRAMES_SG reads
+ * the frames left, so an app that has to stop a source can fade it on from
+ * where it was after.
+ */
+#define AL_SG_fades 1
+#define AL_FADE_GAIN_SG                          0x19E0
+#define AL_FADE_FRAMES_SG                        0x19E1
+
+AL_API void AL_APIENTRY alSourceFadeSG(ALuint source, ALfloat gain, ALsizei frames, ALboolean stop);
+typedef void          (AL_APIENTRY *LPALSOURCEFADESG)(ALuint source, ALfloat gain, ALsizei frames, ALboolean stop);
+
+#if defined(__cplusplus)
+}  /* extern "C" */
+#endif
+
+#endif /* AL_ALEXT_H */
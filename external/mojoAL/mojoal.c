@@ -25,6 +25,7 @@
 
 #include <AL/al.h>
 #include <AL/alc.h>
+#include <AL/alext.h>
 #include <SDL2/SDL.h>
 
 #ifdef __SSE__  /* if you are on x86 or x86-64, we assume you have SSE1 by now. */
@@ -77,6 +78,34 @@
 #define OPENAL_SOURCE_BLOCK_SIZE 64
 #endif
 
+/* Number of mixer events a context can hold before the app drains them. Must be a power of two. */
+#ifndef OPENAL_EVENT_QUEUE_SIZE
+#define OPENAL_EVENT_QUEUE_SIZE 512
+#endif
+
+/* Most worker threads a device can mix sources on with ALC_SG_parallel_mix. */
+#ifndef OPENAL_MAX_MIX_THREADS
+#define OPENAL_MAX_MIX_THREADS 16
+#endif
+
+/* Fewest playing sources on a context before its mix is split across the
+   worker threads; below this, waking them costs more than it saves. */
+#ifndef OPENAL_PARALLEL_MIX_SOURCES
+#define OPENAL_PARALLEL_MIX_SOURCES 32
+#endif
+
+/* Features a game can compile out when it doesn't use them, for a smaller
+   build and fewer branches in the mixer:
+   - MOJOAL_NO_3D: nothing is spatialized, and the vector math and distance
+     models aren't built. Source-relative mono sources still pan left or
+     right by their x position, for 2D games; everything else mixes
+     centered at its gain.
+   - MOJOAL_NO_PITCH: AL_PITCH is accepted but not applied, and the pitch
+     shifter isn't built.
+   - MOJOAL_NO_CAPTURE: alcCaptureOpenDevice always fails.
+   - MOJOAL_FIXED_RATE=hz: contexts and buffers must all be this rate, so no
+     source ever resamples. */
+
 /* AL_EXT_FLOAT32 support... */
 #ifndef AL_FORMAT_MONO_FLOAT32
 #define AL_FORMAT_MONO_FLOAT32 0x10010
@@ -86,6 +115,10 @@
 #define AL_FORMAT_STEREO_FLOAT32 0x10011
 #endif
 
+/* AL_EXT_IMA4 block layout, see AL/alext.h. */
+#define IMA4_BLOCK_FRAMES 65
+#define IMA4_BLOCK_SIZE 36  /* per channel */
+
 /* ALC_EXT_DISCONNECTED support... */
 #ifndef ALC_CONNECTED
 #define ALC_CONNECTED 0x313
@@ -208,6 +241,84 @@ The locking strategy for this OpenAL implementation:
 }
 #endif
 
+/* AL_SG_profile: when built with MOJOAL_PROFILE, the mixer and buffer uploads
+   call the app's hooks around their work, so it shows up on the app's profiler
+   timeline. Otherwise the markers compile to nothing. The hooks are atomic
+   pointers, so the mixer can read them without the api lock. */
+static void *profile_begin_hook = NULL;
+static void *profile_end_hook = NULL;
+
+#ifdef MOJOAL_PROFILE
+#define PROFILE_BEGIN(name, arg) { \
+    const ALPROFILEBEGINSG hook = (ALPROFILEBEGINSG) SDL_AtomicGetPtr(&profile_begin_hook); \
+    if (hook) { hook(name, (ALuint) (arg)); } \
+}
+#define PROFILE_END() { \
+    const ALPROFILEENDSG hook = (ALPROFILEENDSG) SDL_AtomicGetPtr(&profile_end_hook); \
+    if (hook) { hook(); } \
+}
+#define AL_PROFILE_EXTENSION_ITEMS AL_EXTENSION_ITEM(AL_SG_profile)
+#else
+#define PROFILE_BEGIN(name, arg)
+#define PROFILE_END()
+#define AL_PROFILE_EXTENSION_ITEMS
+#endif
+
+/* AL_SG_allocator: everything mojoAL owns is allocated through these, so the
+   app's allocator sees it. The hooks can only change while no device is open,
+   since memory has to be freed by the allocator that made it. */
+static ALMALLOCSG alloc_malloc_hook = NULL;
+static ALREALLOCSG alloc_realloc_hook = NULL;
+static ALFREESG alloc_free_hook = NULL;
+static void *alloc_userdata = NULL;
+static SDL_atomic_t open_devices;
+
+static void *al_malloc(const size_t len)
+{
+    return alloc_malloc_hook ? alloc_malloc_hook(len, alloc_userdata) : SDL_malloc(len);
+}
+
+static void *al_calloc(const size_t nmemb, const size_t len)
+{
+    void *retval;
+    if (!alloc_malloc_hook) {
+        return SDL_calloc(nmemb, len);
+    } else if (len && (nmemb > (((size_t) -1) / len))) {
+        return NULL;  /* overflow */
+    }
+    retval = alloc_malloc_hook(nmemb * len, alloc_userdata);
+    if (retval) {
+        SDL_memset(retval, '\0', nmemb * len);
+    }
+    return retval;
+}
+
+static void *al_realloc(void *ptr, const size_t len)
+{
+    return alloc_realloc_hook ? alloc_realloc_hook(ptr, len, alloc_userdata) : SDL_realloc(ptr, len);
+}
+
+static void al_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    } else if (alloc_free_hook) {
+        alloc_free_hook(ptr, alloc_userdata);
+    } else {
+        SDL_free(ptr);
+    }
+}
+
+static char *al_strdup(const char *str)
+{
+    const size_t len = SDL_strlen(str) + 1;
+    char *retval = (char *) al_malloc(len);
+    if (retval) {
+        SDL_memcpy(retval, str, len);
+    }
+    return retval;
+}
+
 /* restrict is from C99, but __restrict works with both Visual Studio and GCC. */
 #if !defined(restrict) && ((!defined(__STDC_VERSION__) || (__STDC_VERSION__ < 199901)))
 #define restrict __restrict
@@ -292,6 +403,8 @@ typedef struct
     ALCsizei used;
 } RingBuffer;
 
+#ifndef MOJOAL_NO_CAPTURE
+
 static void ring_buffer_put(RingBuffer *ring, const void *_data, const ALCsizei size)
 {
     const ALCubyte *data = (const ALCubyte *) _data;
@@ -367,11 +480,12 @@ static ALCsizei ring_buffer_get(RingBuffer *ring, void *_data, ALCsizei size)
 
     return size;  /* may have been clamped if there wasn't enough data... */
 }
+#endif
 
 static void *calloc_simd_aligned(const size_t len)
 {
     Uint8 *retval = NULL;
-    Uint8 *ptr = (Uint8 *) SDL_calloc(1, len + 16 + sizeof (void *));
+    Uint8 *ptr = (Uint8 *) al_calloc(1, len + 16 + sizeof (void *));
     if (ptr) {
         void **storeptr;
         retval = ptr + sizeof (void *);
@@ -388,7 +502,7 @@ static void free_simd_aligned(void *ptr)
     if (ptr) {
         void **realptr = (void **) ptr;
         realptr--;
-        SDL_free(*realptr);
+        al_free(*realptr);
     }
 }
 
@@ -402,6 +516,7 @@ typedef struct ALbuffer
     ALsizei frequency;
     ALsizei len;   /* length of data in bytes. */
     const float *data;  /* we only work in Float32 format. */
+    const Uint8 *ima4;  /* AL_EXT_IMA4 buffers stay compressed and data is NULL. len is still the decoded float32 size. */
     SDL_atomic_t refcount;  /* if zero, can be deleted or alBufferData'd */
 } ALbuffer;
 
@@ -481,6 +596,22 @@ SIMDALIGNEDSTRUCT ALsource
     ALint queue_channels;
     ALsizei queue_frequency;
     PitchState *pitchstate;
+    ALint stems;  /* AL_SG_stems: stems in each frame of the buffers, 0 or 1 for regular buffers. */
+    ALfloat stem_targets[AL_MAX_STEM_CHANNELS_SG];  /* set by the app, the mixer picks them up on recalc. */
+    ALsizei stem_ramp_frames;
+    ALfloat stem_gains[AL_MAX_STEM_CHANNELS_SG];  /* stem_gains, stem_steps and stem_ramp_to are only touched by the mixer. */
+    ALfloat stem_steps[AL_MAX_STEM_CHANNELS_SG];
+    ALfloat stem_ramp_to[AL_MAX_STEM_CHANNELS_SG];
+    Uint64 start_frame;  /* AL_SG_scheduling: the device clock frame the mixer starts this on, 0 is right away. */
+    Uint64 stop_frame;
+    ALboolean stop_scheduled;
+    ALuint bus;  /* AL_SG_buses: the bus this mixes through, 0 is master. */
+    ALfloat fade_gain;  /* AL_SG_fades: where the fade is. It and the rest of the fade are set by the app under source_lock, and moved along by the mixer. */
+    ALfloat fade_target;
+    ALfloat fade_step;
+    ALsizei fade_remaining;  /* frames left in the fade, 0 if there isn't one. */
+    ALboolean fade_stop;
+    ALboolean fading;  /* mixer only: the panning leaves out AL_GAIN and fade_gain is applied instead. Changes on recalc. */
     ALsource *playlist_next;  /* linked list that contains currently-playing sources! Only touched by mixer thread! */
 };
 
@@ -499,12 +630,75 @@ typedef struct SourcePlayTodo
     struct SourcePlayTodo *next;
 } SourcePlayTodo;
 
+/* Bounded multi-producer/single-consumer queue for AL_SG_source_events.
+   Each slot's sequence number says whose turn it is: a producer may fill
+   slot (pos % size) when sequence == pos, and the consumer may read it when
+   sequence == pos + 1. Producers claim a position with a CAS on enqueue_pos,
+   so the mixer never blocks on the app, and the app only reads under the
+   api lock, so dequeue_pos needs no atomics. */
+typedef struct EventQueueSlot
+{
+    SDL_atomic_t sequence;
+    ALenum type;
+    ALuint source;
+} EventQueueSlot;
+
+typedef struct EventQueue
+{
+    EventQueueSlot slots[OPENAL_EVENT_QUEUE_SIZE];
+    SDL_atomic_t enqueue_pos;
+    SDL_atomic_t overflowed;
+    int dequeue_pos;  /* only touched under api_lock. */
+} EventQueue;
+
+/* ALC_SG_parallel_mix: threads that each mix a share of a context's playing
+   sources into their own accumulator, while the device callback mixes the
+   first share straight into the output. The shares are contiguous runs of
+   the playlist, so the same sources always sum in the same order. */
+typedef struct MixWorker
+{
+    struct MixPool *pool;
+    SDL_Thread *thread;
+    SDL_sem *wake;
+    float *accum;  /* SIMD aligned, a period of stereo frames. */
+    int first;  /* this worker's share of pool->jobs for the mix in progress. */
+    int count;
+} MixWorker;
+
+/* AL_SG_buses: only set by the app, under the api lock. The mixer reads
+   them once per mix and a torn read of one is just a mix late. */
+typedef struct MixBus
+{
+    ALuint parent;  /* always lower than this bus's index, so parents come first. */
+    ALfloat gain;
+    ALboolean muted;
+    ALboolean paused;
+} MixBus;
+
+typedef struct MixPool
+{
+    MixWorker workers[OPENAL_MAX_MIX_THREADS];
+    int num_workers;
+    int accum_len;  /* bytes in each accumulator; longer mixes stay on the callback thread. */
+    SDL_sem *done;
+    SDL_atomic_t quit;
+    /* the mix in progress. Only the callback thread writes these, while the workers are parked. */
+    ALCcontext *ctx;
+    ALsource **jobs;
+    ALCboolean *playing;
+    int capacity;
+    int len;
+    ALboolean force_recalc;
+} MixPool;
+
 struct ALCdevice_struct
 {
     char *name;
     ALCenum error;
     SDL_atomic_t connected;
     ALCboolean iscapture;
+    ALCboolean loopback;  /* ALC_SOFT_loopback: no SDL device, the app pulls mixes with alcRenderSamplesSOFT. */
+    SDL_mutex *loopback_lock;  /* stands in for the SDL device lock on loopback devices, held while rendering. */
     SDL_AudioDeviceID sdldevice;
 
     ALint channels;
@@ -518,6 +712,13 @@ struct ALCdevice_struct
             ALCsizei num_buffer_blocks;
             BufferQueueItem *buffer_queue_pool;  /* mixer thread doesn't touch this. */
             void *source_todo_pool;  /* void* because we'll atomicgetptr it. */
+            ALCint output_channels;  /* what SDL was asked for; we always mix stereo (device->channels). */
+            ALCsizei period_frames;  /* sample frames per device callback. */
+            float *mixbuf;  /* stereo scratch for non-stereo output layouts, NULL when output is stereo. */
+            ALCsizei mixbuf_frames;
+            ALCcallbackTimingSG timing;  /* only written while mixing, read under the device lock. */
+            Uint64 clock;  /* ALC_SG_clock: frames mixed so far, so the frame the mix in progress starts at. Same locking as timing. */
+            MixPool *mixpool;  /* ALC_SG_parallel_mix workers, NULL mixes everything on the callback thread. */
         } playback;
         struct {
             RingBuffer ring;  /* only used if iscapture */
@@ -556,6 +757,13 @@ struct ALCcontext_struct
     ALsource *playlist;  /* linked list of currently-playing sources. Mixer thread only! */
     ALsource *playlist_tail;  /* end of playlist so we know if last item is being readded. Mixer thread only! */
 
+    SDL_atomic_t events_enabled;  /* AL_SOURCE_EVENTS_SG */
+    EventQueue events;
+
+    MixBus buses[AL_MAX_BUSES_SG];
+    ALfloat bus_mix_gains[AL_MAX_BUSES_SG];  /* each bus's gain down to master, worked out at the start of every mix. Mixer thread only! */
+    ALboolean bus_mix_paused[AL_MAX_BUSES_SG];
+
     ALCcontext *prev;  /* contexts are in a double-linked list */
     ALCcontext *next;
 };
@@ -563,6 +771,9 @@ struct ALCcontext_struct
 /* forward declarations */
 static float source_get_offset(ALsource *src, ALenum param);
 static void source_set_offset(ALsource *src, ALenum param, ALfloat value);
+static MixPool *create_mix_pool(ALCdevice *device, const int threads);
+static void destroy_mix_pool(MixPool *pool);
+static void source_stop(ALCcontext *ctx, const ALuint name);
 
 /* the just_queued list is backwards. Add it to the queue in the correct order. */
 static void queue_new_buffer_items_recursive(BufferQueue *queue, BufferQueueItem *items)
@@ -596,6 +807,47 @@ static void obtain_newly_queued_buffers(BufferQueue *queue)
     queue_new_buffer_items_recursive(queue, items);
 }
 
+/* called from the mixer thread; never blocks. Drops the event if the app isn't keeping up. */
+static void queue_source_event(ALCcontext *ctx, const ALenum type, const ALuint name)
+{
+    EventQueue *queue = &ctx->events;
+    int pos;
+
+    if (!SDL_AtomicGet(&ctx->events_enabled)) {
+        return;
+    }
+
+    pos = SDL_AtomicGet(&queue->enqueue_pos);
+    for (;;) {
+        EventQueueSlot *slot = &queue->slots[pos & (OPENAL_EVENT_QUEUE_SIZE - 1)];
+        const int diff = (int) ((unsigned int) SDL_AtomicGet(&slot->sequence) - (unsigned int) pos);
+        if (diff == 0) {
+            if (SDL_AtomicCAS(&queue->enqueue_pos, pos, (int) ((unsigned int) pos + 1))) {
+                slot->type = type;
+                slot->source = name;
+                SDL_MemoryBarrierRelease();
+                SDL_AtomicSet(&slot->sequence, (int) ((unsigned int) pos + 1));  /* publish it. */
+                return;
+            }
+        } else if (diff < 0) {  /* consumer hasn't freed this slot yet; we're full. */
+            SDL_AtomicSet(&queue->overflowed, 1);
+            return;
+        }
+        pos = SDL_AtomicGet(&queue->enqueue_pos);  /* someone else got this slot, try the next one. */
+    }
+}
+
+static void init_event_queue(EventQueue *queue)
+{
+    int i;
+    for (i = 0; i < OPENAL_EVENT_QUEUE_SIZE; i++) {
+        SDL_AtomicSet(&queue->slots[i].sequence, i);
+    }
+    SDL_AtomicSet(&queue->enqueue_pos, 0);
+    SDL_AtomicSet(&queue->overflowed, 0);
+    queue->dequeue_pos = 0;
+}
+
 /* You probably need to hold a lock before you call this (currently). */
 static void source_mark_all_buffers_processed(ALsource *src)
 {
@@ -649,16 +901,39 @@ static void source_release_buffer_queue(ALCcontext *ctx, ALsource *src)
 /* ALC implementation... */
 
 static void *current_context = NULL;
+static SDL_atomic_t thread_context_tls;  /* ALC_EXT_thread_local_context: an SDL_TLSID, 0 until a thread first sets one. */
 static ALCenum null_device_error = ALC_NO_ERROR;
 
 /* we don't have any device-specific extensions. */
+#ifdef MOJOAL_NO_CAPTURE
+#define ALC_CAPTURE_EXTENSION_ITEMS
+#else
+#define ALC_CAPTURE_EXTENSION_ITEMS ALC_EXTENSION_ITEM(ALC_EXT_CAPTURE)
+#endif
+
 #define ALC_EXTENSION_ITEMS \
     ALC_EXTENSION_ITEM(ALC_ENUMERATION_EXT) \
-    ALC_EXTENSION_ITEM(ALC_EXT_CAPTURE) \
-    ALC_EXTENSION_ITEM(ALC_EXT_DISCONNECT)
+    ALC_CAPTURE_EXTENSION_ITEMS \
+    ALC_EXTENSION_ITEM(ALC_EXT_DISCONNECT) \
+    ALC_EXTENSION_ITEM(ALC_EXT_thread_local_context) \
+    ALC_EXTENSION_ITEM(ALC_SOFT_loopback) \
+    ALC_EXTENSION_ITEM(ALC_SG_callback_timing) \
+    ALC_EXTENSION_ITEM(ALC_SG_clock) \
+    ALC_EXTENSION_ITEM(ALC_SG_device_config) \
+    ALC_EXTENSION_ITEM(ALC_SG_parallel_mix)
 
 #define AL_EXTENSION_ITEMS \
-    AL_EXTENSION_ITEM(AL_EXT_FLOAT32)
+    AL_EXTENSION_ITEM(AL_EXT_FLOAT32) \
+    AL_EXTENSION_ITEM(AL_EXT_IMA4) \
+    AL_EXTENSION_ITEM(AL_SG_source_events) \
+    AL_EXTENSION_ITEM(AL_SG_source_start_batch) \
+    AL_EXTENSION_ITEM(AL_SG_positions) \
+    AL_EXTENSION_ITEM(AL_SG_allocator) \
+    AL_EXTENSION_ITEM(AL_SG_stems) \
+    AL_EXTENSION_ITEM(AL_SG_scheduling) \
+    AL_EXTENSION_ITEM(AL_SG_buses) \
+    AL_EXTENSION_ITEM(AL_SG_fades) \
+    AL_PROFILE_EXTENSION_ITEMS
 
 
 static void set_alc_error(ALCdevice *device, const ALCenum error)
@@ -670,28 +945,60 @@ static void set_alc_error(ALCdevice *device, const ALCenum error)
     }
 }
 
+/* Holds off the mixer. Loopback devices have no SDL device to lock, and mix
+   on the app's thread without the api lock, so they have their own. */
+static void lock_device(ALCdevice *device)
+{
+    if (device->loopback) {
+        SDL_LockMutex(device->loopback_lock);
+    } else {
+        SDL_LockAudioDevice(device->sdldevice);
+    }
+}
+
+static void unlock_device(ALCdevice *device)
+{
+    if (device->loopback) {
+        SDL_UnlockMutex(device->loopback_lock);
+    } else {
+        SDL_UnlockAudioDevice(device->sdldevice);
+    }
+}
+
 /* all data written before the release barrier must be available before the recalc flag changes. */ \
 #define context_needs_recalc(ctx) SDL_MemoryBarrierRelease(); ctx->recalc = AL_TRUE;
 #define source_needs_recalc(src) SDL_MemoryBarrierRelease(); src->recalc = AL_TRUE;
 
-static ALCdevice *prep_alc_device(const char *devicename, const ALCboolean iscapture)
+static void free_device(ALCdevice *device)
+{
+    if (device->loopback_lock) {
+        SDL_DestroyMutex(device->loopback_lock);
+    }
+    al_free(device->name);
+    al_free(device);
+    (void) SDL_AtomicDecRef(&open_devices);
+}
+
+static ALCdevice *prep_alc_device(const char *devicename, const ALCboolean iscapture, const ALCboolean isloopback)
 {
+    /* loopback devices never touch SDL audio, so they work where there's no audio backend. */
+    const Uint32 subsystem = isloopback ? 0 : SDL_INIT_AUDIO;
     ALCdevice *dev = NULL;
 
-    if (SDL_InitSubSystem(SDL_INIT_AUDIO) == -1) {
+    if (SDL_InitSubSystem(subsystem) == -1) {
         return NULL;
     }
 
     #ifdef __SSE__
     if (!SDL_HasSSE()) {
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        SDL_QuitSubSystem(subsystem);
         return NULL;  /* whoa! Better order a new Pentium III from Gateway 2000! */
     }
     #endif
 
     #if defined(__ARM_NEON__) && !NEED_SCALAR_FALLBACK
     if (!SDL_HasNEON()) {
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        SDL_QuitSubSystem(subsystem);
         return NULL;  /* :( */
     }
     #elif defined(__ARM_NEON__) && NEED_SCALAR_FALLBACK
@@ -699,25 +1006,37 @@ static ALCdevice *prep_alc_device(const char *devicename, const ALCboolean iscap
     #endif
 
     if (!init_api_lock()) {
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        SDL_QuitSubSystem(subsystem);
         return NULL;
     }
 
-    dev = (ALCdevice *) SDL_calloc(1, sizeof (ALCdevice));
+    dev = (ALCdevice *) al_calloc(1, sizeof (ALCdevice));
     if (!dev) {
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        SDL_QuitSubSystem(subsystem);
         return NULL;
     }
 
-    dev->name = SDL_strdup(devicename);
+    dev->name = al_strdup(devicename);
     if (!dev->name) {
-        SDL_free(dev);
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        al_free(dev);
+        SDL_QuitSubSystem(subsystem);
         return NULL;
     }
 
+    SDL_AtomicIncRef(&open_devices);
+
+    if (isloopback) {
+        dev->loopback_lock = SDL_CreateMutex();
+        if (!dev->loopback_lock) {
+            free_device(dev);
+            SDL_QuitSubSystem(subsystem);
+            return NULL;
+        }
+    }
+
     SDL_AtomicSet(&dev->connected, ALC_TRUE);
     dev->iscapture = iscapture;
+    dev->loopback = isloopback;
 
     return dev;
 }
@@ -729,12 +1048,19 @@ ALCdevice *alcOpenDevice(const ALCchar *devicename)
         devicename = DEFAULT_PLAYBACK_DEVICE;  /* so ALC_DEVICE_SPECIFIER is meaningful */
     }
 
-    return prep_alc_device(devicename, ALC_FALSE);
+    return prep_alc_device(devicename, ALC_FALSE, ALC_FALSE);
 
     /* we don't open an SDL audio device until the first context is
        created, so we can attempt to match audio formats. */
 }
 
+/* no api lock; this creates it and otherwise doesn't have any state that can race */
+ALCdevice *alcLoopbackOpenDeviceSOFT(const ALCchar *devicename)
+{
+    /* never gets an SDL device; the first context sets the format. */
+    return prep_alc_device(devicename ? devicename : "Loopback", ALC_FALSE, ALC_TRUE);
+}
+
 /* no api lock; this requires you to not destroy a device that's still in use */
 ALCboolean alcCloseDevice(ALCdevice *device)
 {
@@ -762,27 +1088,31 @@ ALCboolean alcCloseDevice(ALCdevice *device)
     }
 
     for (i = 0; i < device->playback.num_buffer_blocks; i++) {
-        SDL_free(device->playback.buffer_blocks[i]);
+        al_free(device->playback.buffer_blocks[i]);
     }
-    SDL_free(device->playback.buffer_blocks);
+    al_free(device->playback.buffer_blocks);
 
     item = device->playback.buffer_queue_pool;
     while (item) {
         BufferQueueItem *next = (BufferQueueItem*)item->next;
-        SDL_free(item);
+        al_free(item);
         item = next;
     }
 
     todo = (SourcePlayTodo *) device->playback.source_todo_pool;
     while (todo) {
         SourcePlayTodo *next = todo->next;
-        SDL_free(todo);
+        al_free(todo);
         todo = next;
     }
 
-    SDL_free(device->name);
-    SDL_free(device);
-    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    free_simd_aligned(device->playback.mixbuf);
+    destroy_mix_pool(device->playback.mixpool);
+
+    if (!device->loopback) {
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    }
+    free_device(device);
 
     return ALC_TRUE;
 }
@@ -1152,7 +1482,90 @@ static void mix_float32_c2_neon(const ALfloat * restrict panning, const float *
 }
 #endif
 
+/* AL_SG_fades: scales (frames) frames of 1 or 2 (channels) from (data) into (out), by (gain) stepping by (step) each frame. */
+static void ramp_float32_scalar(ALfloat gain, const ALfloat step, const int channels, const float * restrict data, float * restrict out, const ALsizei frames)
+{
+    ALsizei i;
+
+    if (channels == 1) {
+        for (i = 0; i < frames; i++, gain += step) {
+            out[i] = data[i] * gain;
+        }
+    } else {
+        for (i = 0; i < frames; i++, gain += step, data += 2, out += 2) {
+            out[0] = data[0] * gain;
+            out[1] = data[1] * gain;
+        }
+    }
+}
+
+#ifdef __SSE__
+static void ramp_float32_sse(const ALfloat gain, const ALfloat step, const int channels, const float * restrict data, float * restrict out, const ALsizei frames)
+{
+    const int vecframes = 4 / channels;
+    const int unrolled = frames / vecframes;
+    const __m128 vstep = _mm_set1_ps(step * (ALfloat) vecframes);
+    __m128 vgain;
+    ALsizei i;
+
+    if (channels == 1) {
+        const __m128 vgain1 = { gain, gain + step, gain + (step * 2.0f), gain + (step * 3.0f) };
+        vgain = vgain1;
+    } else {
+        const __m128 vgain2 = { gain, gain, gain + step, gain + step };
+        vgain = vgain2;
+    }
+
+    /* (out) is on the stack and (data) is wherever the buffer is, so don't count on alignment. */
+    for (i = 0; i < unrolled; i++, data += 4, out += 4) {
+        _mm_storeu_ps(out, _mm_mul_ps(_mm_loadu_ps(data), vgain));
+        vgain = _mm_add_ps(vgain, vstep);
+    }
+
+    ramp_float32_scalar(gain + (step * (ALfloat) (unrolled * vecframes)), step, channels, data, out, frames % vecframes);
+}
+#endif
+
+#ifdef __ARM_NEON__
+static void ramp_float32_neon(const ALfloat gain, const ALfloat step, const int channels, const float * restrict data, float * restrict out, const ALsizei frames)
+{
+    const int vecframes = 4 / channels;
+    const int unrolled = frames / vecframes;
+    const float32x4_t vstep = vdupq_n_f32(step * (ALfloat) vecframes);
+    float32x4_t vgain;
+    ALsizei i;
+
+    if (channels == 1) {
+        const float32x4_t vgain1 = { gain, gain + step, gain + (step * 2.0f), gain + (step * 3.0f) };
+        vgain = vgain1;
+    } else {
+        const float32x4_t vgain2 = { gain, gain, gain + step, gain + step };
+        vgain = vgain2;
+    }
+
+    for (i = 0; i < unrolled; i++, data += 4, out += 4) {
+        vst1q_f32(out, vmulq_f32(vld1q_f32(data), vgain));
+        vgain = vaddq_f32(vgain, vstep);
+    }
+
+    ramp_float32_scalar(gain + (step * (ALfloat) (unrolled * vecframes)), step, channels, data, out, frames % vecframes);
+}
+#endif
+
+static void ramp_float32(const ALfloat gain, const ALfloat step, const int channels, const float * restrict data, float * restrict out, const ALsizei frames)
+{
+    #ifdef __SSE__
+    if (has_sse) { ramp_float32_sse(gain, step, channels, data, out, frames); } else
+    #elif defined(__ARM_NEON__)
+    if (has_neon) { ramp_float32_neon(gain, step, channels, data, out, frames); } else
+    #endif
+    {
+    ramp_float32_scalar(gain, step, channels, data, out, frames);
+    }
+}
+
 
+#ifndef MOJOAL_NO_PITCH
 /****************************************************************************
 *
 * pitch_fft and pitch_shift are modified versions of code from:
@@ -1360,20 +1773,196 @@ static void pitch_shift(ALsource *src, const ALbuffer *buffer, int numSampsToPro
         }
     }
 }
+#endif
+
+static const int ima4_index_table[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+static const int ima4_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+/* Decodes one AL_EXT_IMA4 block into IMA4_BLOCK_FRAMES interleaved float32 frames.
+   Each sample depends on the one before it, so this is a serial loop per channel. */
+static void decode_ima4_block(const Uint8 *block, const int channels, float *out)
+{
+    const Uint8 *nibbles = block + (channels * 4);
+    int ch;
+
+    for (ch = 0; ch < channels; ch++) {
+        const Uint8 *header = block + (ch * 4);
+        int sample = (Sint16) (header[0] | (header[1] << 8));
+        int index = SDL_min(header[2], 88);
+        float *dst = out + ch;
+        int i, j;
+
+        *dst = sample * (1.0f / 32768.0f);
+        dst += channels;
+
+        for (i = 0; i < (IMA4_BLOCK_FRAMES - 1) / 8; i++) {
+            const Uint8 *run = nibbles + ((i * channels) + ch) * 4;
+            for (j = 0; j < 8; j++) {
+                const int nibble = (run[j >> 1] >> ((j & 1) * 4)) & 0xF;
+                const int step = ima4_step_table[index];
+                int diff = step >> 3;
+                if (nibble & 4) { diff += step; }
+                if (nibble & 2) { diff += step >> 1; }
+                if (nibble & 1) { diff += step >> 2; }
+                sample += (nibble & 8) ? -diff : diff;
+                sample = SDL_max(SDL_min(sample, 32767), -32768);
+                index = SDL_max(SDL_min(index + ima4_index_table[nibble & 7], 88), 0);
+                *dst = sample * (1.0f / 32768.0f);
+                dst += channels;
+            }
+        }
+    }
+}
+
+/* Gets float32 frames to mix starting at byte offset `offset` of the decoded buffer.
+   `frames` is how many are wanted, and is set to how many the returned pointer has.
+   Float buffers are read in place; IMA4 buffers decode the block holding `offset` into
+   `scratch` (IMA4_BLOCK_FRAMES * channels floats), so at most one block comes back. */
+static const float *get_buffer_frames(const ALbuffer *buffer, const int offset, int *frames, float *scratch)
+{
+    const int bufferframesize = (int) (buffer->channels * sizeof (float));
+    const int frame = offset / bufferframesize;
+    const int framesavail = (buffer->len / bufferframesize) - frame;
+
+    if (!buffer->ima4) {
+        *frames = SDL_min(*frames, framesavail);
+        return buffer->data + (offset / sizeof (float));
+    } else {
+        const int block = frame / IMA4_BLOCK_FRAMES;
+        const int first = frame % IMA4_BLOCK_FRAMES;
+        decode_ima4_block(buffer->ima4 + (block * IMA4_BLOCK_SIZE * buffer->channels), buffer->channels, scratch);
+        *frames = SDL_min(*frames, SDL_min(framesavail, IMA4_BLOCK_FRAMES - first));
+        return scratch + (first * buffer->channels);
+    }
+}
+
+/* picks up new stem gains from the app, and works out the step to ramp to each. */
+static void update_stem_ramps(ALsource *src)
+{
+    int i;
+    for (i = 0; i < AL_MAX_STEM_CHANNELS_SG; i++) {
+        const ALfloat target = src->stem_targets[i];
+        if (target != src->stem_ramp_to[i]) {
+            src->stem_ramp_to[i] = target;
+            src->stem_steps[i] = (target - src->stem_gains[i]) / (ALfloat) SDL_max(src->stem_ramp_frames, 1);
+        }
+    }
+}
+
+/* scales (data) by the fade gain into (out), a ramp while the fade lasts and
+   flat after, and moves the fade along. (out) is NULL to only move it along,
+   for sources mixing silence. */
+static void fade_source_frames(ALsource *src, const int channels, const float * restrict data, float * restrict out, const ALsizei mixframes)
+{
+    const ALsizei ramped = SDL_min(src->fade_remaining, mixframes);
+
+    if (out && ramped) {
+        ramp_float32(src->fade_gain, src->fade_step, channels, data, out, ramped);
+    }
+
+    if (ramped) {
+        src->fade_remaining -= ramped;
+        if (src->fade_remaining == 0) {
+            src->fade_gain = src->fade_target;
+            src->recalc = AL_TRUE;  /* put AL_GAIN back in the panning next mix. */
+        } else {
+            src->fade_gain += src->fade_step * (ALfloat) ramped;
+        }
+    }
+
+    if (out && (ramped < mixframes)) {
+        ramp_float32(src->fade_gain, 0.0f, channels, data + (ramped * channels), out + (ramped * channels), mixframes - ramped);
+    }
+}
+
+/* jumps a fade to its end, for sources that stop before it's done. Called
+   by the mixer, or by the app under source_lock. */
+static void finish_source_fade(ALsource *src)
+{
+    src->fade_remaining = 0;
+    src->fade_gain = src->fade_target;
+    src->fade_stop = AL_FALSE;
+    source_needs_recalc(src);
+}
+
+/* sums the stems of `channels` interleaved channels down to one stem, stepping each stem's gain a frame at a time. */
+static void fold_stems(ALsource *src, const int channels, const float * restrict data, float * restrict folded, const ALsizei mixframes)
+{
+    const int stems = src->stems;
+    const int stemchannels = channels / stems;
+    int i, j, k;
+
+    SDL_memset(folded, '\0', mixframes * stemchannels * sizeof (float));
+    for (i = 0; i < stems; i++) {
+        const float *in = data + (i * stemchannels);
+        const ALfloat target = src->stem_ramp_to[i];
+        const ALfloat step = src->stem_steps[i];
+        ALfloat gain = src->stem_gains[i];
+        float *out = folded;
+        if ((gain == 0.0f) && (target == 0.0f)) {
+            continue;  /* muted stems cost nothing. */
+        }
+        for (j = 0; j < mixframes; j++) {
+            if (gain != target) {
+                gain += step;
+                if (((step > 0.0f) && (gain > target)) || ((step < 0.0f) && (gain < target)) || (step == 0.0f)) {
+                    gain = target;
+                }
+            }
+            for (k = 0; k < stemchannels; k++) {
+                *(out++) += in[k] * gain;
+            }
+            in += channels;
+        }
+        src->stem_gains[i] = gain;
+    }
+}
 
 static void mix_buffer(ALsource *src, const ALbuffer *buffer, const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes)
 {
+    int channels = buffer->channels;
+
+    #ifndef MOJOAL_NO_PITCH
     if ((src->pitch != 1.0f) && (src->pitchstate != NULL)) {
-        float *pitched = (float *) alloca(mixframes * buffer->channels * sizeof (float));
-        pitch_shift(src, buffer, mixframes * buffer->channels, data, pitched);
+        float *pitched = (float *) alloca(mixframes * channels * sizeof (float));
+        pitch_shift(src, buffer, mixframes * channels, data, pitched);
         data = pitched;
     }
+    #endif
+
+    if ((src->stems > 1) && ((channels % src->stems) == 0) && ((channels / src->stems) <= 2)) {
+        float *folded = (float *) alloca(mixframes * (channels / src->stems) * sizeof (float));
+        fold_stems(src, channels, data, folded, mixframes);
+        data = folded;
+        channels /= src->stems;
+    } else if (channels > 2) {
+        return;  /* stem buffers on a source that wasn't told how to fold them. */
+    }
 
     const ALfloat left = panning[0];
     const ALfloat right = panning[1];
+
+    if (src->fading) {
+        if ((left != 0.0f) || (right != 0.0f)) {
+            float *faded = (float *) alloca(mixframes * channels * sizeof (float));
+            fade_source_frames(src, channels, data, faded, mixframes);
+            data = faded;
+        } else {
+            fade_source_frames(src, channels, data, NULL, mixframes);
+        }
+    }
+
     FIXME("currently expects output to be stereo");
     if ((left != 0.0f) || (right != 0.0f)) {  /* don't bother mixing in silence. */
-        if (buffer->channels == 1) {
+        if (channels == 1) {
             #ifdef __SSE__
             if (has_sse) { mix_float32_c1_sse(panning, data, stream, mixframes); } else
             #elif defined(__ARM_NEON__)
@@ -1387,7 +1976,7 @@ static void mix_buffer(ALsource *src, const ALbuffer *buffer, const ALfloat * re
             #endif
             }
         } else {
-            SDL_assert(buffer->channels == 2);
+            SDL_assert(channels == 2);
             #ifdef __SSE__
             if (has_sse) { mix_float32_c2_sse(panning, data, stream, mixframes); } else
             #elif defined(__ARM_NEON__)
@@ -1404,29 +1993,30 @@ static void mix_buffer(ALsource *src, const ALbuffer *buffer, const ALfloat * re
     }
 }
 
-static ALboolean mix_source_buffer(ALCcontext *ctx, ALsource *src, BufferQueueItem *queue, float **stream, int *len)
+static ALboolean mix_source_buffer(ALCcontext *ctx, ALsource *src, const ALfloat *panning, BufferQueueItem *queue, float **stream, int *len)
 {
     const ALbuffer *buffer = queue ? queue->buffer : NULL;
     ALboolean processed = AL_TRUE;
 
     /* you can legally queue or set a NULL buffer. */
-    if (buffer && buffer->data && (buffer->len > 0)) {
-        const float *data = buffer->data + (src->offset / sizeof (float));
+    if (buffer && (buffer->data || buffer->ima4) && (buffer->len > 0)) {
         const int bufferframesize = (int) (buffer->channels * sizeof (float));
         const int deviceframesize = ctx->device->framesize;
         const int framesneeded = *len / deviceframesize;
+        float scratch[IMA4_BLOCK_FRAMES * 2];
 
         SDL_assert(src->offset < buffer->len);
 
+        #ifndef MOJOAL_FIXED_RATE
         if (src->stream) {  /* resampling? */
             int mixframes, mixlen, remainingmixframes;
             while ( (((mixlen = SDL_AudioStreamAvailable(src->stream)) / bufferframesize) < framesneeded) && (src->offset < buffer->len) ) {
-                const int framesput = (buffer->len - src->offset) / bufferframesize;
-                const int bytesput = SDL_min(framesput, 1024) * bufferframesize;
+                int framesput = 1024;
+                const float *data = get_buffer_frames(buffer, src->offset, &framesput, scratch);
+                const int bytesput = framesput * bufferframesize;
                 FIXME("dynamically adjust frames here?");  /* we hardcode 1024 samples when opening the audio device, too. */
                 SDL_AudioStreamPut(src->stream, data, bytesput);
                 src->offset += bytesput;
-                data += bytesput / sizeof (float);
             }
 
             mixframes = SDL_min(mixlen / bufferframesize, framesneeded);
@@ -1437,18 +2027,24 @@ static ALboolean mix_source_buffer(ALCcontext *ctx, ALsource *src, BufferQueueIt
                 const int mixbufframes = mixbuflen / bufferframesize;
                 const int getframes = SDL_min(remainingmixframes, mixbufframes);
                 SDL_AudioStreamGet(src->stream, mixbuf, getframes * bufferframesize);
-                mix_buffer(src, buffer, src->panning, mixbuf, *stream, getframes);
+                mix_buffer(src, buffer, panning, mixbuf, *stream, getframes);
                 *len -= getframes * deviceframesize;
                 *stream += getframes * ctx->device->channels;
                 remainingmixframes -= getframes;
             }
-        } else {
-            const int framesavail = (buffer->len - src->offset) / bufferframesize;
-            const int mixframes = SDL_min(framesneeded, framesavail);
-            mix_buffer(src, buffer, src->panning, data, *stream, mixframes);
-            src->offset += mixframes * bufferframesize;
-            *len -= mixframes * deviceframesize;
-            *stream += mixframes * ctx->device->channels;
+        } else
+        #endif
+        {
+            int remainingmixframes = framesneeded;
+            while ((remainingmixframes > 0) && (src->offset < buffer->len)) {
+                int mixframes = remainingmixframes;
+                const float *data = get_buffer_frames(buffer, src->offset, &mixframes, scratch);
+                mix_buffer(src, buffer, panning, data, *stream, mixframes);
+                src->offset += mixframes * bufferframesize;
+                *len -= mixframes * deviceframesize;
+                *stream += mixframes * ctx->device->channels;
+                remainingmixframes -= mixframes;
+            }
         }
 
         SDL_assert(src->offset <= buffer->len);
@@ -1463,11 +2059,11 @@ static ALboolean mix_source_buffer(ALCcontext *ctx, ALsource *src, BufferQueueIt
     return processed;
 }
 
-static ALCboolean mix_source_buffer_queue(ALCcontext *ctx, ALsource *src, BufferQueueItem *queue, float *stream, int len)
+static ALCboolean mix_source_buffer_queue(ALCcontext *ctx, ALsource *src, const ALfloat *panning, BufferQueueItem *queue, float *stream, int len)
 {
     ALCboolean keep = ALC_TRUE;
 
-    while ((len > 0) && (mix_source_buffer(ctx, src, queue, &stream, &len))) {
+    while ((len > 0) && (mix_source_buffer(ctx, src, panning, queue, &stream, &len))) {
         /* Finished this buffer! */
         BufferQueueItem *item = queue;
         BufferQueueItem *next = queue ? (BufferQueueItem*)queue->next : NULL;
@@ -1496,6 +2092,7 @@ static ALCboolean mix_source_buffer_queue(ALCcontext *ctx, ALsource *src, Buffer
                 } while (!SDL_AtomicCASPtr(&src->buffer_queue_processed.just_queued, ptr, item));
 
                 SDL_AtomicAdd(&src->buffer_queue_processed.num_items, 1);
+                queue_source_event(ctx, AL_EVENT_BUFFER_PROCESSED_SG, src->name);
             }
         }
 
@@ -1507,6 +2104,7 @@ static ALCboolean mix_source_buffer_queue(ALCcontext *ctx, ALsource *src, Buffer
                 }
             } else {
                 SDL_AtomicSet(&src->state, AL_STOPPED);
+                queue_source_event(ctx, AL_EVENT_SOURCE_STOPPED_SG, src->name);
                 keep = ALC_FALSE;
             }
             break;  /* nothing else to mix here, so stop. */
@@ -1516,6 +2114,39 @@ static ALCboolean mix_source_buffer_queue(ALCcontext *ctx, ALsource *src, Buffer
     return keep;
 }
 
+/* AL_GAIN, or 1 while a fade (AL_SG_fades) applies it in the mix instead. */
+static ALfloat source_gain(const ALsource *src)
+{
+    return src->fading ? 1.0f : src->gain;
+}
+
+#ifdef MOJOAL_NO_3D
+/* built without 3D: there's no distance or listener orientation, but AL_GAIN
+   (etc) is still applied, and a source-relative mono source still pans by
+   its x, as if it sat on a unit circle in front of a listener facing -z.
+   That's the same constant power pan the 3D build gives it, so a 2D pan
+   sounds the same in both builds. */
+static void calculate_channel_gains(const ALCcontext *ctx, const ALsource *src, float *gains)
+{
+    const ALboolean pan = (ctx->distance_model != AL_NONE) &&
+                          (src->queue_channels == 1) &&
+                          (src->rolloff_factor != 0.0f) &&
+                          src->source_relative;
+    const ALfloat gain = SDL_min(SDL_max(source_gain(src), src->min_gain), src->max_gain) * ctx->listener.gain;
+
+    if (pan) {
+        #define SQRT2_DIV2 0.7071067812f  /* sqrt(2.0) / 2.0 ... */
+        /* x on the unit circle is already the sine of the angle. Past 45
+           degrees either way is full left or right, like the 3D build. */
+        const ALfloat sine = SDL_min(SDL_max(src->position[0], -SQRT2_DIV2), SQRT2_DIV2);
+        const ALfloat cosine = SDL_sqrtf(1.0f - (sine * sine));
+        gains[0] = (SQRT2_DIV2 * (cosine - sine)) * gain;
+        gains[1] = (SQRT2_DIV2 * (cosine + sine)) * gain;
+    } else {
+        gains[0] = gains[1] = gain;
+    }
+}
+#else
 /* All the 3D math here is way overcommented because I HAVE NO IDEA WHAT I'M
    DOING and had to research the hell out of what are probably pretty simple
    concepts. Pay attention in math class, kids. */
@@ -1712,7 +2343,7 @@ static void calculate_channel_gains(const ALCcontext *ctx, const ALsource *src,
 
     if (!spatialize) {
         /* simpler path through the same AL spec details if not spatializing. */
-        gain = SDL_min(SDL_max(src->gain, src->min_gain), src->max_gain) * ctx->listener.gain;
+        gain = SDL_min(SDL_max(source_gain(src), src->min_gain), src->max_gain) * ctx->listener.gain;
         gains[0] = gains[1] = gain;  /* no spatialization, but AL_GAIN (etc) is still applied. */
         return;
     }
@@ -1754,7 +2385,7 @@ static void calculate_channel_gains(const ALCcontext *ctx, const ALsource *src,
     gain = calculate_distance_attenuation(ctx, src, distance);
 
     /* AL SPEC: "2. The result is then multiplied by source gain (AL_GAIN)." */
-    gain *= src->gain;
+    gain *= source_gain(src);
 
     /* AL SPEC: "3. If the source is directional (AL_CONE_INNER_ANGLE less
        than AL_CONE_OUTER_ANGLE), an angle-dependent attenuation is calculated
@@ -1927,36 +2558,122 @@ static void calculate_channel_gains(const ALCcontext *ctx, const ALsource *src,
     gains[0] *= gain;
     gains[1] *= gain;
 }
+#endif
 
 
+/* AL_SG_scheduling: narrows a mix to the frames between (src)'s start and stop
+   frames. Returns AL_FALSE if it doesn't start in this mix at all, and sets
+   (stopping) if it stops in it. */
+static ALboolean schedule_source_mix(ALCcontext *ctx, ALsource *src, float **stream, int *len, ALboolean *stopping)
+{
+    const Uint64 clock = ctx->device->playback.clock;
+    const int framesize = ctx->device->framesize;
+    const Uint64 frames = (Uint64) (*len / framesize);
+    Uint64 start = clock;
+
+    *stopping = AL_FALSE;
+    if (src->start_frame > clock) {
+        const Uint64 wait = src->start_frame - clock;
+        if (wait >= frames) {
+            return AL_FALSE;  /* not yet. */
+        }
+        *stream += wait * ctx->device->channels;
+        *len -= (int) wait * framesize;
+        start = src->start_frame;
+    }
+
+    if (src->stop_scheduled) {
+        const Uint64 remaining = (src->stop_frame > start) ? (src->stop_frame - start) : 0;
+        if (remaining < (Uint64) (*len / framesize)) {
+            *len = (int) remaining * framesize;
+            *stopping = AL_TRUE;
+        }
+    }
+    return AL_TRUE;
+}
+
 static ALCboolean mix_source(ALCcontext *ctx, ALsource *src, float *stream, int len, const ALboolean force_recalc)
 {
     ALCboolean keep;
+    ALboolean stopping = AL_FALSE;
 
     keep = (SDL_AtomicGet(&src->state) == AL_PLAYING);
     if (keep) {
+        ALfloat panning[2];
         SDL_assert(src->allocated);
+        if (ctx->bus_mix_paused[src->bus]) {
+            return ALC_TRUE;  /* held where it is until its bus unpauses. */
+        }
         if (src->recalc || force_recalc) {
             SDL_MemoryBarrierAcquire();
             src->recalc = AL_FALSE;
+            if ((src->fade_remaining > 0) && (src->gain != src->fade_target)) {
+                src->fade_remaining = 0;  /* AL_GAIN was set over the top of the fade. */
+                src->fade_stop = AL_FALSE;
+            }
+            src->fading = (src->fade_remaining > 0) ? AL_TRUE : AL_FALSE;
             calculate_channel_gains(ctx, src, src->panning);
+            update_stem_ramps(src);
+        }
+        /* the bus gain rides along with the multiply-add the source mixes with anyhow. */
+        panning[0] = src->panning[0] * ctx->bus_mix_gains[src->bus];
+        panning[1] = src->panning[1] * ctx->bus_mix_gains[src->bus];
+        if (!schedule_source_mix(ctx, src, &stream, &len, &stopping)) {
+            return ALC_TRUE;  /* still waiting for its start frame. */
         }
-        if (src->type == AL_STATIC) {
+        if (src->fade_stop && (src->fade_remaining > 0) && (((Sint64) src->fade_remaining * ctx->device->framesize) <= len)) {
+            len = src->fade_remaining * ctx->device->framesize;  /* the fade ends in this mix, and the source with it. */
+            stopping = AL_TRUE;
+        }
+        if (len == 0) {
+            /* stopping right where this mix starts, nothing to mix. */
+        } else if (src->type == AL_STATIC) {
             BufferQueueItem fakequeue = { src->buffer, NULL };
-            keep = mix_source_buffer_queue(ctx, src, &fakequeue, stream, len);
+            keep = mix_source_buffer_queue(ctx, src, panning, &fakequeue, stream, len);
         } else if (src->type == AL_STREAMING) {
             obtain_newly_queued_buffers(&src->buffer_queue);
-            keep = mix_source_buffer_queue(ctx, src, src->buffer_queue.head, stream, len);
+            keep = mix_source_buffer_queue(ctx, src, panning, src->buffer_queue.head, stream, len);
         } else if (src->type == AL_UNDETERMINED) {
             keep = ALC_FALSE;  /* this has AL_BUFFER set to 0; just dump it. */
         } else {
             SDL_assert(!"unknown source type");
         }
+        if (stopping && keep) {
+            SDL_AtomicSet(&src->state, AL_STOPPED);
+            source_mark_all_buffers_processed(src);
+            if (src->stream) {
+                SDL_AudioStreamClear(src->stream);
+            }
+            src->stop_scheduled = AL_FALSE;
+            queue_source_event(ctx, AL_EVENT_SOURCE_STOPPED_SG, src->name);
+            keep = ALC_FALSE;
+        }
+        if (!keep && src->fading) {
+            finish_source_fade(src);
+        }
     }
 
     return keep;
 }
 
+/* Works out each bus's gain and pause down to master, once per mix instead
+   of once per source. Parents have lower indices, so they're done first. */
+static void update_bus_mix(ALCcontext *ctx)
+{
+    int i;
+    for (i = 0; i < AL_MAX_BUSES_SG; i++) {
+        const MixBus *bus = &ctx->buses[i];
+        ALfloat gain = bus->muted ? 0.0f : bus->gain;
+        ALboolean paused = bus->paused;
+        if (i > 0) {
+            gain *= ctx->bus_mix_gains[bus->parent];
+            paused = paused || ctx->bus_mix_paused[bus->parent];
+        }
+        ctx->bus_mix_gains[i] = gain;
+        ctx->bus_mix_paused[i] = paused;
+    }
+}
+
 /* move new play requests over to the mixer thread. */
 static void migrate_playlist_requests(ALCcontext *ctx)
 {
@@ -1993,25 +2710,262 @@ static void migrate_playlist_requests(ALCcontext *ctx)
     } while (!SDL_AtomicCASPtr(&ctx->device->playback.source_todo_pool, i, todo));
 }
 
-static void mix_context(ALCcontext *ctx, float *stream, int len)
+/* Adds (frames) of stereo (data) to (stream); the unity gain path of the stereo mixers. */
+static void add_float32_c2(float * restrict stream, const float * restrict data, const ALsizei frames)
 {
-    const ALboolean force_recalc = ctx->recalc;
-    ALsource *next = NULL;
-    ALsource *prev = NULL;
-    ALsource *i;
+    static const ALfloat unity[2] = { 1.0f, 1.0f };
+    #ifdef __SSE__
+    if (has_sse) { mix_float32_c2_sse(unity, data, stream, frames); } else
+    #elif defined(__ARM_NEON__)
+    if (has_neon) { mix_float32_c2_neon(unity, data, stream, frames); } else
+    #endif
+    {
+    #if NEED_SCALAR_FALLBACK
+    mix_float32_c2_scalar(unity, data, stream, frames);
+    #else
+    SDL_assert(!"uhoh, we didn't compile in enough mixers!");
+    #endif
+    }
+}
 
-    if (force_recalc) {
-        SDL_MemoryBarrierAcquire();
-        ctx->recalc = AL_FALSE;
+static void mix_pool_sources(MixPool *pool, const int first, const int count, float *stream)
+{
+    int i;
+    for (i = first; i < first + count; i++) {
+        ALsource *src = pool->jobs[i];
+        /* per source, like the serial mix, so the app only waits on the source it's changing. */
+        SDL_LockMutex(pool->ctx->source_lock);
+        PROFILE_BEGIN("MixSource", src->name);
+        pool->playing[i] = mix_source(pool->ctx, src, stream, pool->len, pool->force_recalc);
+        PROFILE_END();
+        SDL_UnlockMutex(pool->ctx->source_lock);
     }
+}
 
-    migrate_playlist_requests(ctx);
+static int SDLCALL mix_worker_thread(void *data)
+{
+    MixWorker *worker = (MixWorker *) data;
+    MixPool *pool = worker->pool;
 
-    for (i = ctx->playlist; i != NULL; i = next) {
+    /* SDL can't pin threads to cores, so do what it does for its own audio thread. */
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL);
+
+    for (;;) {
+        SDL_SemWait(worker->wake);
+        if (SDL_AtomicGet(&pool->quit)) {
+            break;
+        }
+        SDL_memset(worker->accum, '\0', pool->len);
+        PROFILE_BEGIN("MixWorker", (ALuint) worker->count);
+        mix_pool_sources(pool, worker->first, worker->count, worker->accum);
+        PROFILE_END();
+        SDL_SemPost(pool->done);
+    }
+
+    return 0;
+}
+
+static MixPool *create_mix_pool(ALCdevice *device, const int threads)
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    (void) device; (void) threads;
+    return NULL;  /* no threads to mix on. */
+#else
+    MixPool *pool;
+    int i;
+
+    if (threads <= 0) {
+        return NULL;
+    }
+
+    pool = (MixPool *) al_calloc(1, sizeof (MixPool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->accum_len = (int) (device->playback.period_frames * device->framesize);
+    pool->done = SDL_CreateSemaphore(0);
+    if (!pool->done) {
+        al_free(pool);
+        return NULL;
+    }
+
+    for (i = 0; i < SDL_min(threads, OPENAL_MAX_MIX_THREADS); i++) {
+        MixWorker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->wake = SDL_CreateSemaphore(0);
+        worker->accum = (float *) calloc_simd_aligned(pool->accum_len);
+        if (worker->wake && worker->accum) {
+            worker->thread = SDL_CreateThread(mix_worker_thread, "mojoAL mixer", worker);
+        }
+        if (!worker->thread) {  /* run with the workers we got. */
+            if (worker->wake) {
+                SDL_DestroySemaphore(worker->wake);
+            }
+            free_simd_aligned(worker->accum);
+            break;
+        }
+        pool->num_workers++;
+    }
+
+    if (pool->num_workers == 0) {
+        destroy_mix_pool(pool);
+        return NULL;
+    }
+
+    return pool;
+#endif
+}
+
+static void destroy_mix_pool(MixPool *pool)
+{
+    int i;
+
+    if (!pool) {
+        return;
+    }
+
+    SDL_AtomicSet(&pool->quit, 1);
+    for (i = 0; i < pool->num_workers; i++) {
+        MixWorker *worker = &pool->workers[i];
+        SDL_SemPost(worker->wake);
+        SDL_WaitThread(worker->thread, NULL);
+        SDL_DestroySemaphore(worker->wake);
+        free_simd_aligned(worker->accum);
+    }
+    SDL_DestroySemaphore(pool->done);
+    al_free(pool->jobs);
+    al_free(pool->playing);
+    al_free(pool);
+}
+
+/* Mixes the playlist across the device's workers and this thread, then sums
+   the workers' accumulators pairwise into (stream). Returns ALC_FALSE without
+   mixing anything when there's too little to be worth waking them. */
+static ALCboolean mix_context_parallel(ALCcontext *ctx, float *stream, int len, const ALboolean force_recalc)
+{
+    MixPool *pool = ctx->device->playback.mixpool;
+    const ALsizei frames = len / ctx->device->framesize;
+    int participants;
+    int num_jobs = 0;
+    ALsource *prev = NULL;
+    ALsource *i;
+    int stride;
+    int j;
+
+    if (!pool || (len > pool->accum_len)) {
+        return ALC_FALSE;
+    }
+
+    for (i = ctx->playlist; i != NULL; i = i->playlist_next) {
+        num_jobs++;
+    }
+
+    if (num_jobs < OPENAL_PARALLEL_MIX_SOURCES) {
+        return ALC_FALSE;
+    }
+
+    if (num_jobs > pool->capacity) {  /* only grows, so this settles down after the first busy mixes. */
+        const int capacity = num_jobs * 2;
+        ALsource **jobs = (ALsource **) al_realloc(pool->jobs, sizeof (ALsource *) * capacity);
+        ALCboolean *playing;
+        if (!jobs) {
+            return ALC_FALSE;
+        }
+        pool->jobs = jobs;
+        playing = (ALCboolean *) al_realloc(pool->playing, sizeof (ALCboolean) * capacity);
+        if (!playing) {
+            return ALC_FALSE;
+        }
+        pool->playing = playing;
+        pool->capacity = capacity;
+    }
+
+    num_jobs = 0;
+    for (i = ctx->playlist; i != NULL; i = i->playlist_next) {
+        pool->jobs[num_jobs++] = i;
+    }
+
+    pool->ctx = ctx;
+    pool->len = len;
+    pool->force_recalc = force_recalc;
+    participants = pool->num_workers + 1;
+    for (j = 0; j < pool->num_workers; j++) {
+        MixWorker *worker = &pool->workers[j];
+        worker->first = (int) (((Sint64) num_jobs * (j + 1)) / participants);
+        worker->count = (int) (((Sint64) num_jobs * (j + 2)) / participants) - worker->first;
+        SDL_SemPost(worker->wake);
+    }
+
+    mix_pool_sources(pool, 0, (int) (num_jobs / participants), stream);
+
+    for (j = 0; j < pool->num_workers; j++) {
+        SDL_SemWait(pool->done);
+    }
+
+    PROFILE_BEGIN("MixSum", (ALuint) pool->num_workers);
+    for (stride = 1; stride < pool->num_workers; stride *= 2) {
+        for (j = 0; j + stride < pool->num_workers; j += stride * 2) {
+            add_float32_c2(pool->workers[j].accum, pool->workers[j + stride].accum, frames);
+        }
+    }
+    add_float32_c2(stream, pool->workers[0].accum, frames);
+    PROFILE_END();
+
+    /* take the sources that finished out of the playlist. */
+    SDL_LockMutex(ctx->source_lock);
+    ctx->playlist = NULL;
+    for (j = 0; j < num_jobs; j++) {
+        i = pool->jobs[j];
+        if (pool->playing[j]) {
+            if (prev) {
+                prev->playlist_next = i;
+            } else {
+                ctx->playlist = i;
+            }
+            prev = i;
+        } else {
+            i->playlist_next = NULL;
+            SDL_AtomicSet(&i->mixer_accessible, 0);
+        }
+    }
+    if (prev) {
+        prev->playlist_next = NULL;
+    }
+    ctx->playlist_tail = prev;
+
+    SDL_UnlockMutex(ctx->source_lock);
+
+    return ALC_TRUE;
+}
+
+static void mix_context(ALCcontext *ctx, float *stream, int len)
+{
+    const ALboolean force_recalc = ctx->recalc;
+    ALsource *next = NULL;
+    ALsource *prev = NULL;
+    ALsource *i;
+
+    if (force_recalc) {
+        SDL_MemoryBarrierAcquire();
+        ctx->recalc = AL_FALSE;
+    }
+
+    migrate_playlist_requests(ctx);
+    update_bus_mix(ctx);
+
+    if (mix_context_parallel(ctx, stream, len, force_recalc)) {
+        return;
+    }
+
+    for (i = ctx->playlist; i != NULL; i = next) {
         next = i->playlist_next;  /* save this to a local in case we leave the list. */
 
         SDL_LockMutex(ctx->source_lock);
-        if (!mix_source(ctx, i, stream, len, force_recalc)) {
+        PROFILE_BEGIN("MixSource", i->name);
+        const ALCboolean playing = mix_source(ctx, i, stream, len, force_recalc);
+        PROFILE_END();
+        if (!playing) {
             /* take it out of the playlist. It wasn't actually playing or it just finished. */
             i->playlist_next = NULL;
             if (next == NULL) {
@@ -2049,6 +3003,7 @@ static void mix_disconnected_context(ALCcontext *ctx)
             SDL_assert(i->allocated);
             SDL_AtomicSet(&i->state, AL_STOPPED);
             source_mark_all_buffers_processed(i);
+            queue_source_event(ctx, AL_EVENT_SOURCE_STOPPED_SG, i->name);
         }
 
         i->playlist_next = NULL;
@@ -2059,12 +3014,93 @@ static void mix_disconnected_context(ALCcontext *ctx)
     ctx->playlist_tail = NULL;
 }
 
+static void mix_device_contexts(ALCdevice *device, const ALCboolean connected, float *stream, int len)
+{
+    ALCcontext *ctx;
+    for (ctx = device->playback.contexts; ctx != NULL; ctx = ctx->next) {
+        if (SDL_AtomicGet(&ctx->processing)) {
+            if (connected) {
+                mix_context(ctx, stream, len);
+            } else {
+                mix_disconnected_context(ctx);
+            }
+        }
+    }
+}
+
+/* Count a mix of (frames) that started at (start) against how long those
+   frames take to play, which is the most it can take without the device
+   running dry. */
+static void record_mix_timing(ALCdevice *device, const Uint64 start, const int frames)
+{
+    ALCcallbackTimingSG *timing = &device->playback.timing;
+    const double seconds = (double) (SDL_GetPerformanceCounter() - start) / (double) SDL_GetPerformanceFrequency();
+    const double deadline = (double) frames / (double) device->frequency;
+    const ALCuint usec = (ALCuint) (seconds * 1000000.0);
+    int bucket;
+
+    if (frames <= 0) {
+        return;
+    }
+
+    bucket = (int) SDL_min(seconds / deadline * ALC_TIMING_BUCKETS_PER_DEADLINE_SG, (double) (ALC_TIMING_BUCKETS_SG - 1));
+    timing->buckets[bucket]++;
+    timing->callbacks++;
+    if (seconds > deadline) {
+        timing->overruns++;
+    }
+    if (usec > timing->max_usec) {
+        timing->max_usec = usec;
+    }
+    timing->deadline_usec = (ALCuint) (deadline * 1000000.0);
+}
+
+/* Mix every processing context on (device) into (stream), which is (len) bytes
+   of float32 in the layout the device was opened with, and already zeroed. */
+static void mix_device_output(ALCdevice *device, const ALCboolean connected, float *stream, int len)
+{
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    if (device->playback.mixbuf == NULL) {  /* stereo output, mix straight into the output buffer. */
+        mix_device_contexts(device, connected, stream, len);
+        device->playback.clock += (Uint64) (len / device->framesize);
+    } else {
+        /* mix in stereo, then lay that out in whatever channel format the device was opened with. */
+        const int outchans = (int) device->playback.output_channels;
+        const int outframesize = outchans * (int) sizeof (float);
+        float *out = stream;
+        int remaining = len / outframesize;
+        while (remaining > 0) {
+            const int frames = SDL_min(remaining, (int) device->playback.mixbuf_frames);
+            const float *mixed = device->playback.mixbuf;
+            int i;
+
+            SDL_memset(device->playback.mixbuf, '\0', frames * device->framesize);
+            mix_device_contexts(device, connected, device->playback.mixbuf, frames * device->framesize);
+            device->playback.clock += (Uint64) frames;
+
+            if (outchans == 1) {
+                for (i = 0; i < frames; i++, mixed += 2) {
+                    *(out++) = (mixed[0] + mixed[1]) * 0.5f;
+                }
+            } else {  /* front left/right are the first two channels of every SDL layout; the rest stay silent. */
+                for (i = 0; i < frames; i++, mixed += 2, out += outchans) {
+                    out[0] = mixed[0];
+                    out[1] = mixed[1];
+                }
+            }
+            remaining -= frames;
+        }
+    }
+
+    record_mix_timing(device, start, len / (int) (device->playback.output_channels * sizeof (float)));
+}
+
 /* We process all unsuspended ALC contexts during this call, mixing their
    output to (stream). SDL then plays this mixed audio to the hardware. */
 static void SDLCALL playback_device_callback(void *userdata, Uint8 *stream, int len)
 {
     ALCdevice *device = (ALCdevice *) userdata;
-    ALCcontext *ctx;
     ALCboolean connected = ALC_FALSE;
 
     SDL_memset(stream, '\0', len);
@@ -2077,24 +3113,129 @@ static void SDLCALL playback_device_callback(void *userdata, Uint8 *stream, int
         }
     }
 
-    for (ctx = device->playback.contexts; ctx != NULL; ctx = ctx->next) {
-        if (SDL_AtomicGet(&ctx->processing)) {
-            if (connected) {
-                mix_context(ctx, (float *) stream, len);
-            } else {
-                mix_disconnected_context(ctx);
-            }
-        }
+    PROFILE_BEGIN("DeviceCallback", len / (device->playback.output_channels * sizeof (float)));
+    mix_device_output(device, connected, (float *) stream, len);
+    PROFILE_END();
+}
+
+/* Loopback devices mix on the caller's thread, under their loopback_lock
+   instead of the SDL device lock. We go a period at a time so the mixer's per-call
+   scratch space stays the same size it would be for a real device. */
+static void _alcRenderSamplesSOFT(ALCdevice *device, ALCvoid *buffer, ALCsizei samples)
+{
+    float *out = (float *) buffer;
+    ALCboolean connected;
+    ALCsizei outframesize;
+
+    if (!device || !device->loopback || !device->framesize) {
+        set_alc_error(device, ALC_INVALID_DEVICE);
+        return;
+    } else if ((samples < 0) || (!buffer && samples)) {
+        set_alc_error(device, ALC_INVALID_VALUE);
+        return;
+    }
+
+    connected = SDL_AtomicGet(&device->connected) ? ALC_TRUE : ALC_FALSE;
+    outframesize = device->playback.output_channels * (ALCsizei) sizeof (float);
+    PROFILE_BEGIN("RenderSamples", samples);
+    lock_device(device);
+    while (samples > 0) {
+        const ALCsizei frames = SDL_min(samples, device->playback.period_frames);
+        SDL_memset(out, '\0', frames * outframesize);
+        mix_device_output(device, connected, out, (int) (frames * outframesize));
+        out += frames * device->playback.output_channels;
+        samples -= frames;
+    }
+    unlock_device(device);
+    PROFILE_END();
+}
+
+/* no api lock; this mixes like the SDL audio callback would, so loopback
+   devices on other threads mix in parallel. */
+void alcRenderSamplesSOFT(ALCdevice *device, ALCvoid *buffer, ALCsizei samples)
+{
+    _alcRenderSamplesSOFT(device, buffer, samples);
+}
+
+static ALCboolean _alcGetCallbackTimingSG(ALCdevice *device, ALCcallbackTimingSG *timing, ALCboolean reset)
+{
+    if (!device || device->iscapture) {
+        set_alc_error(device, ALC_INVALID_DEVICE);
+        return ALC_FALSE;
+    } else if (!timing) {
+        set_alc_error(device, ALC_INVALID_VALUE);
+        return ALC_FALSE;
+    }
+
+    lock_device(device);
+    SDL_memcpy(timing, &device->playback.timing, sizeof (*timing));
+    if (reset) {
+        SDL_zero(device->playback.timing);
+    }
+    unlock_device(device);
+    return ALC_TRUE;
+}
+ENTRYPOINT(ALCboolean,alcGetCallbackTimingSG,(ALCdevice *device, ALCcallbackTimingSG *timing, ALCboolean reset),(device,timing,reset))
+
+static ALuint64SG _alcGetClockSG(ALCdevice *device)
+{
+    ALuint64SG clock;
+
+    if (!device || device->iscapture) {
+        set_alc_error(device, ALC_INVALID_DEVICE);
+        return 0;
+    }
+
+    /* 64 bits can't be read atomically everywhere, so hold off the mixer like alcGetCallbackTimingSG does. */
+    lock_device(device);
+    clock = (ALuint64SG) device->playback.clock;
+    unlock_device(device);
+    return clock;
+}
+ENTRYPOINT(ALuint64SG,alcGetClockSG,(ALCdevice *device),(device))
+
+/* no api lock; immutable. We always mix float32, so that's the only type loopback renders. */
+ALCboolean alcIsRenderFormatSupportedSOFT(ALCdevice *device, ALCsizei freq, ALCenum channels, ALCenum type)
+{
+    if (!device || !device->loopback) {
+        set_alc_error(device, ALC_INVALID_DEVICE);
+        return ALC_FALSE;
+    }
+
+    switch (channels) {
+        case ALC_MONO_SOFT: case ALC_STEREO_SOFT: case ALC_QUAD_SOFT:
+        case ALC_5POINT1_SOFT: case ALC_6POINT1_SOFT: case ALC_7POINT1_SOFT:
+            break;
+        default:
+            return ALC_FALSE;
     }
+
+    #ifdef MOJOAL_FIXED_RATE
+    if (freq != MOJOAL_FIXED_RATE) {
+        return ALC_FALSE;
+    }
+    #endif
+
+    return ((freq > 0) && (type == ALC_FLOAT_SOFT)) ? ALC_TRUE : ALC_FALSE;
 }
 
 static ALCcontext *_alcCreateContext(ALCdevice *device, const ALCint* attrlist)
 {
     ALCcontext *retval = NULL;
     ALCsizei attrcount = 0;
+    ALCint output_channels = 2;
+    #ifdef MOJOAL_FIXED_RATE
+    ALCint freq = MOJOAL_FIXED_RATE;
+    #else
     ALCint freq = 48000;
+    #endif
     ALCboolean sync = ALC_FALSE;
     ALCint refresh = 100;
+    ALCint channel_layout = ALC_STEREO_SOFT;
+    ALCint period = 1024;
+    ALCint mix_threads = 0;
+    ALCint format_type = ALC_FLOAT_SOFT;
+    int i;
     /* we don't care about ALC_MONO_SOURCES or ALC_STEREO_SOURCES as we have no hardware limitation. */
 
     if (!device) {
@@ -2114,6 +3255,10 @@ static ALCcontext *_alcCreateContext(ALCdevice *device, const ALCint* attrlist)
                 case ALC_FREQUENCY: freq = attrlist[attrcount++]; break;
                 case ALC_REFRESH: refresh = attrlist[attrcount++]; break;
                 case ALC_SYNC: sync = (attrlist[attrcount++] ? ALC_TRUE : ALC_FALSE); break;
+                case ALC_FORMAT_CHANNELS_SOFT: channel_layout = attrlist[attrcount++]; break;
+                case ALC_PERIOD_SIZE_SG: period = attrlist[attrcount++]; break;
+                case ALC_MIX_THREADS_SG: mix_threads = attrlist[attrcount++]; break;
+                case ALC_FORMAT_TYPE_SOFT: format_type = attrlist[attrcount++]; break;
                 default: FIXME("fail for unknown attributes?"); break;
             }
         }
@@ -2121,6 +3266,30 @@ static ALCcontext *_alcCreateContext(ALCdevice *device, const ALCint* attrlist)
 
     FIXME("use these variables at some point"); (void) refresh; (void) sync;
 
+    if ((freq <= 0) || (period <= 0) || (period > 0xFFFF) || (mix_threads < 0) || (format_type != ALC_FLOAT_SOFT)) {
+        set_alc_error(device, ALC_INVALID_VALUE);
+        return NULL;
+    }
+
+    #ifdef MOJOAL_FIXED_RATE
+    if (freq != MOJOAL_FIXED_RATE) {
+        set_alc_error(device, ALC_INVALID_VALUE);  /* built to never resample. */
+        return NULL;
+    }
+    #endif
+
+    switch (channel_layout) {
+        case ALC_MONO_SOFT: output_channels = 1; break;
+        case ALC_STEREO_SOFT: output_channels = 2; break;
+        case ALC_QUAD_SOFT: output_channels = 4; break;
+        case ALC_5POINT1_SOFT: output_channels = 6; break;
+        case ALC_6POINT1_SOFT: output_channels = 7; break;
+        case ALC_7POINT1_SOFT: output_channels = 8; break;
+        default:
+            set_alc_error(device, ALC_INVALID_VALUE);
+            return NULL;
+    }
+
     retval = (ALCcontext *) calloc_simd_aligned(sizeof (ALCcontext));
     if (!retval) {
         set_alc_error(device, ALC_OUT_OF_MEMORY);
@@ -2139,7 +3308,7 @@ static ALCcontext *_alcCreateContext(ALCdevice *device, const ALCint* attrlist)
         return NULL;
     }
 
-    retval->attributes = (ALCint *) SDL_malloc(attrcount * sizeof (ALCint));
+    retval->attributes = (ALCint *) al_malloc(attrcount * sizeof (ALCint));
     if (!retval->attributes) {
         set_alc_error(device, ALC_OUT_OF_MEMORY);
         SDL_DestroyMutex(retval->source_lock);
@@ -2149,8 +3318,30 @@ static ALCcontext *_alcCreateContext(ALCdevice *device, const ALCint* attrlist)
     SDL_memcpy(retval->attributes, attrlist, attrcount * sizeof (ALCint));
     retval->attributes_count = attrcount;
 
-    if (!device->sdldevice) {
+    if (device->loopback) {
+        if (!device->framesize) {  /* first context picks the format, like opening the SDL device does. */
+            device->channels = 2;
+            device->frequency = freq;
+            device->framesize = sizeof (float) * device->channels;
+            device->playback.output_channels = output_channels;
+            device->playback.period_frames = (ALCsizei) period;
+            if (output_channels != 2) {
+                device->playback.mixbuf_frames = device->playback.period_frames;
+                device->playback.mixbuf = (float *) calloc_simd_aligned(device->playback.mixbuf_frames * device->framesize);
+                if (!device->playback.mixbuf) {
+                    device->framesize = 0;
+                    SDL_DestroyMutex(retval->source_lock);
+                    al_free(retval->attributes);
+                    free_simd_aligned(retval);
+                    set_alc_error(device, ALC_OUT_OF_MEMORY);
+                    return NULL;
+                }
+            }
+            device->playback.mixpool = create_mix_pool(device, mix_threads);
+        }
+    } else if (!device->sdldevice) {
         SDL_AudioSpec desired;
+        SDL_AudioSpec obtained;
         const char *devicename = device->name;
 
         if (SDL_strcmp(devicename, DEFAULT_PLAYBACK_DEVICE) == 0) {
@@ -2158,25 +3349,43 @@ static ALCcontext *_alcCreateContext(ALCdevice *device, const ALCint* attrlist)
         }
 
         /* we always want to work in float32, to keep our work simple and
-           let us use SIMD, and we'll let SDL convert when feeding the device. */
+           let us use SIMD, and we'll let SDL convert when feeding the device.
+           Rate and channels are held to what was asked for (SDL converts if
+           the hardware disagrees), but the backend may round the period. */
         SDL_zero(desired);
         desired.freq = freq;
         desired.format = AUDIO_F32SYS;
-        desired.channels = 2;  FIXME("don't force channels?");
-        desired.samples = 1024;  FIXME("base this on refresh");
+        desired.channels = (Uint8) output_channels;
+        desired.samples = (Uint16) period;
         desired.callback = playback_device_callback;
         desired.userdata = device;
-        device->sdldevice = SDL_OpenAudioDevice(devicename, 0, &desired, NULL, 0);
+        device->sdldevice = SDL_OpenAudioDevice(devicename, 0, &desired, &obtained, SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
         if (!device->sdldevice) {
             SDL_DestroyMutex(retval->source_lock);
-            SDL_free(retval->attributes);
+            al_free(retval->attributes);
             free_simd_aligned(retval);
             FIXME("What error do you set for this?");
             return NULL;
         }
-        device->channels = 2;
+        device->channels = 2;  /* the mixer always works in stereo. */
         device->frequency = freq;
         device->framesize = sizeof (float) * device->channels;
+        device->playback.output_channels = output_channels;
+        device->playback.period_frames = (ALCsizei) obtained.samples;
+        if (output_channels != 2) {
+            device->playback.mixbuf_frames = device->playback.period_frames;
+            device->playback.mixbuf = (float *) calloc_simd_aligned(device->playback.mixbuf_frames * device->framesize);
+            if (!device->playback.mixbuf) {
+                SDL_CloseAudioDevice(device->sdldevice);
+                device->sdldevice = 0;
+                SDL_DestroyMutex(retval->source_lock);
+                al_free(retval->attributes);
+                free_simd_aligned(retval);
+                set_alc_error(device, ALC_OUT_OF_MEMORY);
+                return NULL;
+            }
+        }
+        device->playback.mixpool = create_mix_pool(device, mix_threads);
         SDL_PauseAudioDevice(device->sdldevice, 0);
     }
 
@@ -2185,20 +3394,24 @@ static ALCcontext *_alcCreateContext(ALCdevice *device, const ALCint* attrlist)
     retval->doppler_velocity = 1.0f;
     retval->speed_of_sound = 343.3f;
     retval->listener.gain = 1.0f;
+    for (i = 0; i < AL_MAX_BUSES_SG; i++) {
+        retval->buses[i].gain = 1.0f;
+    }
     retval->listener.orientation[2] = -1.0f;
     retval->listener.orientation[5] = 1.0f;
     retval->device = device;
+    init_event_queue(&retval->events);
     context_needs_recalc(retval);
     SDL_AtomicSet(&retval->processing, 1);  /* contexts default to processing */
 
-    SDL_LockAudioDevice(device->sdldevice);
+    lock_device(device);
     if (device->playback.contexts != NULL) {
         SDL_assert(device->playback.contexts->prev == NULL);
         device->playback.contexts->prev = retval;
     }
     retval->next = device->playback.contexts;
     device->playback.contexts = retval;
-    SDL_UnlockAudioDevice(device->sdldevice);
+    unlock_device(device);
 
     return retval;
 }
@@ -2207,7 +3420,9 @@ ENTRYPOINT(ALCcontext *,alcCreateContext,(ALCdevice *device, const ALCint* attrl
 
 static SDL_INLINE ALCcontext *get_current_context(void)
 {
-    return (ALCcontext *) SDL_AtomicGetPtr(&current_context);
+    const SDL_TLSID tls = (SDL_TLSID) SDL_AtomicGet(&thread_context_tls);
+    ALCcontext *ctx = tls ? (ALCcontext *) SDL_TLSGet(tls) : NULL;
+    return ctx ? ctx : (ALCcontext *) SDL_AtomicGetPtr(&current_context);
 }
 
 /* no api lock; it just sets an atomic pointer at the moment */
@@ -2248,8 +3463,9 @@ static void _alcDestroyContext(ALCcontext *ctx)
     FIXME("Should NULL context be an error?");
     if (!ctx) return;
 
-    /* The spec says it's illegal to delete the current context. */
-    if (get_current_context() == ctx) {
+    /* The spec says it's illegal to delete the current context. We can only
+       see this thread's thread context, not other threads'. */
+    if ((get_current_context() == ctx) || (SDL_AtomicGetPtr(&current_context) == ctx)) {
         set_alc_error(ctx->device, ALC_INVALID_CONTEXT);
         return;
     }
@@ -2257,7 +3473,7 @@ static void _alcDestroyContext(ALCcontext *ctx)
     /* do this first in case the mixer is running _right now_. */
     SDL_AtomicSet(&ctx->processing, 0);
 
-    SDL_LockAudioDevice(ctx->device->sdldevice);
+    lock_device(ctx->device);
     if (ctx->prev) {
         ctx->prev->next = ctx->next;
     } else {
@@ -2267,7 +3483,7 @@ static void _alcDestroyContext(ALCcontext *ctx)
     if (ctx->next) {
         ctx->next->prev = ctx->prev;
     }
-    SDL_UnlockAudioDevice(ctx->device->sdldevice);
+    unlock_device(ctx->device);
 
     for (blocki = 0; blocki < ctx->num_source_blocks; blocki++) {
         SourceBlock *sb = ctx->source_blocks[blocki];
@@ -2290,8 +3506,8 @@ static void _alcDestroyContext(ALCcontext *ctx)
     }
 
     SDL_DestroyMutex(ctx->source_lock);
-    SDL_free(ctx->source_blocks);
-    SDL_free(ctx->attributes);
+    al_free(ctx->source_blocks);
+    al_free(ctx->attributes);
     free_simd_aligned(ctx);
 }
 ENTRYPOINTVOID(alcDestroyContext,(ALCcontext *ctx),(ctx))
@@ -2302,6 +3518,36 @@ ALCcontext *alcGetCurrentContext(void)
     return get_current_context();
 }
 
+static ALCboolean _alcSetThreadContext(ALCcontext *ctx)
+{
+    SDL_TLSID tls = (SDL_TLSID) SDL_AtomicGet(&thread_context_tls);
+    if (!tls) {
+        if (!ctx) {
+            return ALC_TRUE;  /* no thread has ever set one, so this one doesn't have one to clear. */
+        }
+        tls = SDL_TLSCreate();
+        if (!tls) {
+            set_alc_error(ctx->device, ALC_OUT_OF_MEMORY);
+            return ALC_FALSE;
+        }
+        SDL_AtomicSet(&thread_context_tls, (int) tls);
+    }
+
+    if (SDL_TLSSet(tls, ctx, NULL) < 0) {
+        set_alc_error(ctx ? ctx->device : NULL, ALC_OUT_OF_MEMORY);
+        return ALC_FALSE;
+    }
+    return ALC_TRUE;
+}
+ENTRYPOINT(ALCboolean,alcSetThreadContext,(ALCcontext *ctx),(ctx))
+
+/* no api lock; thread local. */
+ALCcontext *alcGetThreadContext(void)
+{
+    const SDL_TLSID tls = (SDL_TLSID) SDL_AtomicGet(&thread_context_tls);
+    return tls ? (ALCcontext *) SDL_TLSGet(tls) : NULL;
+}
+
 /* no api lock; immutable. */
 ALCdevice *alcGetContextsDevice(ALCcontext *context)
 {
@@ -2341,6 +3587,8 @@ void *alcGetProcAddress(ALCdevice *device, const ALCchar *funcname)
     FN_TEST(alcSuspendContext);
     FN_TEST(alcDestroyContext);
     FN_TEST(alcGetCurrentContext);
+    FN_TEST(alcSetThreadContext);
+    FN_TEST(alcGetThreadContext);
     FN_TEST(alcGetContextsDevice);
     FN_TEST(alcOpenDevice);
     FN_TEST(alcCloseDevice);
@@ -2355,6 +3603,11 @@ void *alcGetProcAddress(ALCdevice *device, const ALCchar *funcname)
     FN_TEST(alcCaptureStart);
     FN_TEST(alcCaptureStop);
     FN_TEST(alcCaptureSamples);
+    FN_TEST(alcLoopbackOpenDeviceSOFT);
+    FN_TEST(alcIsRenderFormatSupportedSOFT);
+    FN_TEST(alcRenderSamplesSOFT);
+    FN_TEST(alcGetCallbackTimingSG);
+    FN_TEST(alcGetClockSG);
     #undef FN_TEST
 
     set_alc_error(device, ALC_INVALID_VALUE);
@@ -2396,6 +3649,17 @@ ALCenum alcGetEnumValue(ALCdevice *device, const ALCchar *enumname)
     ENUM_TEST(ALC_DEFAULT_ALL_DEVICES_SPECIFIER);
     ENUM_TEST(ALC_ALL_DEVICES_SPECIFIER);
     ENUM_TEST(ALC_CONNECTED);
+    ENUM_TEST(ALC_FORMAT_CHANNELS_SOFT);
+    ENUM_TEST(ALC_MONO_SOFT);
+    ENUM_TEST(ALC_STEREO_SOFT);
+    ENUM_TEST(ALC_QUAD_SOFT);
+    ENUM_TEST(ALC_5POINT1_SOFT);
+    ENUM_TEST(ALC_6POINT1_SOFT);
+    ENUM_TEST(ALC_7POINT1_SOFT);
+    ENUM_TEST(ALC_PERIOD_SIZE_SG);
+    ENUM_TEST(ALC_MIX_THREADS_SG);
+    ENUM_TEST(ALC_FORMAT_TYPE_SOFT);
+    ENUM_TEST(ALC_FLOAT_SOFT);
     #undef ENUM_TEST
 
     set_alc_error(device, ALC_INVALID_VALUE);
@@ -2583,6 +3847,31 @@ static void _alcGetIntegerv(ALCdevice *device, const ALCenum param, const ALCsiz
             *values = device->frequency;
             return;
 
+        case ALC_FORMAT_CHANNELS_SOFT:
+        case ALC_PERIOD_SIZE_SG:
+        case ALC_MIX_THREADS_SG:
+            if (!device || device->iscapture || !device->framesize) {
+                *values = 0;
+                set_alc_error(device, ALC_INVALID_DEVICE);
+                return;
+            }
+
+            if (param == ALC_PERIOD_SIZE_SG) {
+                *values = (ALCint) device->playback.period_frames;
+            } else if (param == ALC_MIX_THREADS_SG) {
+                *values = device->playback.mixpool ? device->playback.mixpool->num_workers : 0;
+            } else {
+                switch (device->playback.output_channels) {
+                    case 1: *values = ALC_MONO_SOFT; break;
+                    case 4: *values = ALC_QUAD_SOFT; break;
+                    case 6: *values = ALC_5POINT1_SOFT; break;
+                    case 7: *values = ALC_6POINT1_SOFT; break;
+                    case 8: *values = ALC_7POINT1_SOFT; break;
+                    default: *values = ALC_STEREO_SOFT; break;
+                }
+            }
+            return;
+
         default: break;
     }
 
@@ -2592,6 +3881,35 @@ static void _alcGetIntegerv(ALCdevice *device, const ALCenum param, const ALCsiz
 ENTRYPOINTVOID(alcGetIntegerv,(ALCdevice *device, ALCenum param, ALCsizei size, ALCint *values),(device,param,size,values))
 
 
+#ifdef MOJOAL_NO_CAPTURE
+/* built without capture: the entry points are still here so apps link, but no device ever opens. */
+ALCdevice *alcCaptureOpenDevice(const ALCchar *devicename, ALCuint frequency, ALCenum format, ALCsizei buffersize)
+{
+    (void) devicename; (void) frequency; (void) format; (void) buffersize;
+    return NULL;
+}
+
+ALCboolean alcCaptureCloseDevice(ALCdevice *device)
+{
+    (void) device;
+    return ALC_FALSE;
+}
+
+void alcCaptureStart(ALCdevice *device)
+{
+    (void) device;
+}
+
+void alcCaptureStop(ALCdevice *device)
+{
+    (void) device;
+}
+
+void alcCaptureSamples(ALCdevice *device, ALCvoid *buffer, ALCsizei samples)
+{
+    (void) device; (void) buffer; (void) samples;
+}
+#else
 /* audio callback for capture devices just needs to move data into our
    ringbuffer for later recovery by the app in alcCaptureSamples(). SDL
    should have handled resampling and conversion for us to the expected
@@ -2641,7 +3959,7 @@ ALCdevice *alcCaptureOpenDevice(const ALCchar *devicename, ALCuint frequency, AL
         sdldevname = devicename;  /* we want NULL for the best SDL default unless app is explicit. */
     }
 
-    device = prep_alc_device(devicename, ALC_TRUE);
+    device = prep_alc_device(devicename, ALC_TRUE, ALC_FALSE);
     if (!device) {
         return NULL;
     }
@@ -2651,12 +3969,11 @@ ALCdevice *alcCaptureOpenDevice(const ALCchar *devicename, ALCuint frequency, AL
     device->capture.ring.size = framesize * buffersize;
 
     if (device->capture.ring.size >= buffersize) {
-        ringbuf = (ALCubyte *) SDL_malloc(device->capture.ring.size);
+        ringbuf = (ALCubyte *) al_malloc(device->capture.ring.size);
     }
 
     if (!ringbuf) {
-        SDL_free(device->name);
-        SDL_free(device);
+        free_device(device);
         SDL_QuitSubSystem(SDL_INIT_AUDIO);
         return NULL;
     }
@@ -2667,9 +3984,8 @@ ALCdevice *alcCaptureOpenDevice(const ALCchar *devicename, ALCuint frequency, AL
 
     device->sdldevice = SDL_OpenAudioDevice(sdldevname, 1, &desired, NULL, 0);
     if (!device->sdldevice) {
-        SDL_free(ringbuf);
-        SDL_free(device->name);
-        SDL_free(device);
+        al_free(ringbuf);
+        free_device(device);
         SDL_QuitSubSystem(SDL_INIT_AUDIO);
         return NULL;
     }
@@ -2688,9 +4004,8 @@ ALCboolean alcCaptureCloseDevice(ALCdevice *device)
         SDL_CloseAudioDevice(device->sdldevice);
     }
 
-    SDL_free(device->capture.ring.buffer);
-    SDL_free(device->name);
-    SDL_free(device);
+    al_free(device->capture.ring.buffer);
+    free_device(device);
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
 
     return ALC_TRUE;
@@ -2739,6 +4054,7 @@ static void _alcCaptureSamples(ALCdevice *device, ALCvoid *buffer, const ALCsize
     SDL_UnlockAudioDevice(device->sdldevice);
 }
 ENTRYPOINTVOID(alcCaptureSamples,(ALCdevice *device, ALCvoid *buffer, ALCsizei samples),(device,buffer,samples))
+#endif
 
 
 /* AL implementation... */
@@ -2888,23 +4204,114 @@ ENTRYPOINTVOID(alDistanceModel,(ALenum model),(model))
 
 static void _alEnable(const ALenum capability)
 {
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    switch (capability) {
+        case AL_SOURCE_EVENTS_SG: SDL_AtomicSet(&ctx->events_enabled, 1); break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;  /* nothing in core OpenAL 1.1 uses this */
+    }
 }
 ENTRYPOINTVOID(alEnable,(ALenum capability),(capability))
 
 
 static void _alDisable(const ALenum capability)
 {
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    switch (capability) {
+        case AL_SOURCE_EVENTS_SG: SDL_AtomicSet(&ctx->events_enabled, 0); break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;  /* nothing in core OpenAL 1.1 uses this */
+    }
 }
 ENTRYPOINTVOID(alDisable,(ALenum capability),(capability))
 
 
 static ALboolean _alIsEnabled(const ALenum capability)
 {
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return AL_FALSE;
+    }
+
+    switch (capability) {
+        case AL_SOURCE_EVENTS_SG: return SDL_AtomicGet(&ctx->events_enabled) ? AL_TRUE : AL_FALSE;
+        default: break;
+    }
+
+    set_al_error(ctx, AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
     return AL_FALSE;
 }
+
+static ALsizei _alGetEventsSG(ALeventSG *events, const ALsizei maxevents, ALboolean *overflowed)
+{
+    ALCcontext *ctx = get_current_context();
+    EventQueue *queue;
+    ALsizei retval = 0;
+
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return 0;
+    } else if ((maxevents < 0) || (!events && maxevents)) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return 0;
+    }
+
+    queue = &ctx->events;
+    while (retval < maxevents) {
+        EventQueueSlot *slot = &queue->slots[queue->dequeue_pos & (OPENAL_EVENT_QUEUE_SIZE - 1)];
+        const int diff = (int) ((unsigned int) SDL_AtomicGet(&slot->sequence) - ((unsigned int) queue->dequeue_pos + 1));
+        if (diff < 0) {
+            break;  /* nothing published here yet; queue is empty. */
+        }
+        SDL_MemoryBarrierAcquire();
+        events[retval].type = slot->type;
+        events[retval].source = slot->source;
+        retval++;
+        /* hand the slot back to the producers for the next lap around the ring. */
+        SDL_AtomicSet(&slot->sequence, (int) ((unsigned int) queue->dequeue_pos + OPENAL_EVENT_QUEUE_SIZE));
+        queue->dequeue_pos = (int) ((unsigned int) queue->dequeue_pos + 1);
+    }
+
+    if (overflowed) {
+        *overflowed = SDL_AtomicSet(&queue->overflowed, 0) ? AL_TRUE : AL_FALSE;
+    }
+
+    return retval;
+}
+ENTRYPOINT(ALsizei,alGetEventsSG,(ALeventSG *events, ALsizei maxevents, ALboolean *overflowed),(events,maxevents,overflowed))
+
+/* no api lock; this requires every device to be closed, so nothing else is allocating. */
+ALboolean alAllocatorSG(ALMALLOCSG malloc_fn, ALREALLOCSG realloc_fn, ALFREESG free_fn, void *userdata)
+{
+    if (SDL_AtomicGet(&open_devices) != 0) {
+        return AL_FALSE;
+    } else if ((!malloc_fn || !realloc_fn || !free_fn) && (malloc_fn || realloc_fn || free_fn)) {
+        return AL_FALSE;  /* all or nothing. */
+    }
+    alloc_malloc_hook = malloc_fn;
+    alloc_realloc_hook = realloc_fn;
+    alloc_free_hook = free_fn;
+    alloc_userdata = userdata;
+    return AL_TRUE;
+}
+
+/* no api lock; the hooks are atomic. */
+void alProfileHooksSG(ALPROFILEBEGINSG begin, ALPROFILEENDSG end)
+{
+    /* clear begin first and set it last, so the mixer never begins a span it can't end. */
+    SDL_AtomicSetPtr(&profile_begin_hook, NULL);
+    SDL_AtomicSetPtr(&profile_end_hook, (void *) end);
+    SDL_AtomicSetPtr(&profile_begin_hook, (void *) begin);
+}
 ENTRYPOINT(ALboolean,alIsEnabled,(ALenum capability),(capability))
 
 static const ALchar *_alGetString(const ALenum param)
@@ -3137,6 +4544,18 @@ static void *_alGetProcAddress(const ALchar *funcname)
     FN_TEST(alGetBufferi);
     FN_TEST(alGetBuffer3i);
     FN_TEST(alGetBufferiv);
+    FN_TEST(alGetEventsSG);
+    FN_TEST(alSourceStartBatchSG);
+    FN_TEST(alUpdatePositionsSG);
+    FN_TEST(alProfileHooksSG);
+    FN_TEST(alAllocatorSG);
+    FN_TEST(alBufferStemsSG);
+    FN_TEST(alSourceStemGainsSG);
+    FN_TEST(alSourcePlayAtSG);
+    FN_TEST(alSourceStopAtSG);
+    FN_TEST(alBusfSG);
+    FN_TEST(alBusiSG);
+    FN_TEST(alSourceFadeSG);
     #undef FN_TEST
 
     set_al_error(ctx, ALC_INVALID_VALUE);
@@ -3221,6 +4640,18 @@ static ALenum _alGetEnumValue(const ALchar *enumname)
     ENUM_TEST(AL_EXPONENT_DISTANCE_CLAMPED);
     ENUM_TEST(AL_FORMAT_MONO_FLOAT32);
     ENUM_TEST(AL_FORMAT_STEREO_FLOAT32);
+    ENUM_TEST(AL_FORMAT_MONO_IMA4);
+    ENUM_TEST(AL_FORMAT_STEREO_IMA4);
+    ENUM_TEST(AL_BUFFER_FRAMES_SG);
+    ENUM_TEST(AL_SOURCE_EVENTS_SG);
+    ENUM_TEST(AL_EVENT_SOURCE_STOPPED_SG);
+    ENUM_TEST(AL_EVENT_BUFFER_PROCESSED_SG);
+    ENUM_TEST(AL_BUS_SG);
+    ENUM_TEST(AL_BUS_PARENT_SG);
+    ENUM_TEST(AL_BUS_MUTED_SG);
+    ENUM_TEST(AL_BUS_PAUSED_SG);
+    ENUM_TEST(AL_FADE_GAIN_SG);
+    ENUM_TEST(AL_FADE_FRAMES_SG);
     #undef ENUM_TEST
 
     set_al_error(ctx, AL_INVALID_VALUE);
@@ -3491,6 +4922,7 @@ static void _alGenSources(const ALsizei n, ALuint *names)
     ALsizei block_offset = 0;
     ALsizei blocki;
     ALsizei i;
+    ALsizei j;
 
     if (!ctx) {
         set_al_error(ctx, AL_INVALID_OPERATION);
@@ -3500,7 +4932,7 @@ static void _alGenSources(const ALsizei n, ALuint *names)
     if (n <= SDL_arraysize(stackobjs)) {
         SDL_memset(stackobjs, '\0', sizeof (ALsource *) * n);
     } else {
-        objects = (ALsource **) SDL_calloc(n, sizeof (ALsource *));
+        objects = (ALsource **) al_calloc(n, sizeof (ALsource *));
         if (!objects) {
             set_al_error(ctx, AL_OUT_OF_MEMORY);
             return;
@@ -3536,7 +4968,7 @@ static void _alGenSources(const ALsizei n, ALuint *names)
 
     while (found < n) {  /* out of blocks? Add new ones. */
         /* ctx->source_blocks is only accessed on the API thread under a mutex, so it's safe to realloc. */
-        void *ptr = SDL_realloc(ctx->source_blocks, sizeof (SourceBlock *) * (totalblocks + 1));
+        void *ptr = al_realloc(ctx->source_blocks, sizeof (SourceBlock *) * (totalblocks + 1));
         SourceBlock *block;
 
         if (!ptr) {
@@ -3566,7 +4998,7 @@ static void _alGenSources(const ALsizei n, ALuint *names)
     }
 
     if (out_of_memory) {
-        if (objects != stackobjs) SDL_free(objects);
+        if (objects != stackobjs) al_free(objects);
         SDL_memset(names, '\0', sizeof (*names) * n);
         set_al_error(ctx, AL_OUT_OF_MEMORY);
         return;
@@ -3615,11 +5047,19 @@ static void _alGenSources(const ALsizei n, ALuint *names)
         src->pitch = 1.0f;
         src->cone_inner_angle = 360.0f;
         src->cone_outer_angle = 360.0f;
+        for (j = 0; j < AL_MAX_STEM_CHANNELS_SG; j++) {
+            src->stem_targets[j] = src->stem_gains[j] = src->stem_ramp_to[j] = 1.0f;
+        }
+        src->bus = 0;
+        src->fade_gain = src->fade_target = 1.0f;
+        src->fade_remaining = 0;
+        src->fade_stop = AL_FALSE;
+        src->fading = AL_FALSE;
         source_needs_recalc(src);
         src->allocated = AL_TRUE;   /* we officially own it. */
     }
 
-    if (objects != stackobjs) SDL_free(objects);
+    if (objects != stackobjs) al_free(objects);
 }
 ENTRYPOINTVOID(alGenSources,(ALsizei n, ALuint *names),(n,names))
 
@@ -3689,14 +5129,18 @@ ENTRYPOINT(ALboolean,alIsSource,(ALuint name),(name))
 
 static void source_set_pitch(ALCcontext *ctx, ALsource *src, const ALfloat pitch)
 {
+    #ifdef MOJOAL_NO_PITCH
+    (void) ctx;  /* kept so it reads back, but never applied. */
+    #else
     /* only allocate pitchstate if the pitch every changes, because it's a lot of
        RAM and we leave it allocated to the source until forever once needed */
     if ((pitch != 1.0f) && (src->pitchstate == NULL)) {
-        src->pitchstate = (PitchState *) SDL_calloc(1, sizeof (PitchState));
+        src->pitchstate = (PitchState *) al_calloc(1, sizeof (PitchState));
         if (src->pitchstate == NULL) {
             set_al_error(ctx, AL_OUT_OF_MEMORY);
         }
     }
+    #endif
     src->pitch = pitch;
 }
 
@@ -3852,6 +5296,22 @@ static void _alSourceiv(const ALuint name, const ALenum param, const ALint *valu
         case AL_CONE_INNER_ANGLE: src->cone_inner_angle = (ALfloat) *values; break;
         case AL_CONE_OUTER_ANGLE: src->cone_outer_angle = (ALfloat) *values; break;
 
+        case AL_STEMS_SG:
+            if ((*values < 0) || (*values > AL_MAX_STEM_CHANNELS_SG)) {
+                set_al_error(ctx, AL_INVALID_VALUE);
+                return;
+            }
+            src->stems = *values;
+            break;
+
+        case AL_BUS_SG:
+            if ((*values < 0) || (*values >= AL_MAX_BUSES_SG)) {
+                set_al_error(ctx, AL_INVALID_VALUE);
+                return;
+            }
+            src->bus = (ALuint) *values;
+            break;
+
         case AL_DIRECTION:
             src->direction[0] = (ALfloat) values[0];
             src->direction[1] = (ALfloat) values[1];
@@ -3885,6 +5345,8 @@ static void _alSourcei(const ALuint name, const ALenum param, const ALint value)
         case AL_SEC_OFFSET:
         case AL_SAMPLE_OFFSET:
         case AL_BYTE_OFFSET:
+        case AL_STEMS_SG:
+        case AL_BUS_SG:
             _alSourceiv(name, param, &value);
             break;
         default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
@@ -3925,6 +5387,7 @@ static void _alGetSourcefv(const ALuint name, const ALenum param, ALfloat *value
         case AL_CONE_INNER_ANGLE: *values = src->cone_inner_angle; break;
         case AL_CONE_OUTER_ANGLE: *values = src->cone_outer_angle; break;
         case AL_CONE_OUTER_GAIN:  *values = src->cone_outer_gain; break;
+        case AL_FADE_GAIN_SG: *values = (src->fade_remaining > 0) ? src->fade_gain : src->gain; break;
 
         case AL_SEC_OFFSET:
         case AL_SAMPLE_OFFSET:
@@ -3953,6 +5416,7 @@ static void _alGetSourcef(const ALuint name, const ALenum param, ALfloat *value)
         case AL_SEC_OFFSET:
         case AL_SAMPLE_OFFSET:
         case AL_BYTE_OFFSET:
+        case AL_FADE_GAIN_SG:
             _alGetSourcefv(name, param, value);
             break;
         default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
@@ -3997,6 +5461,9 @@ static void _alGetSourceiv(const ALuint name, const ALenum param, ALint *values)
         case AL_MAX_DISTANCE: *values = (ALint) src->max_distance; break;
         case AL_CONE_INNER_ANGLE: *values = (ALint) src->cone_inner_angle; break;
         case AL_CONE_OUTER_ANGLE: *values = (ALint) src->cone_outer_angle; break;
+        case AL_STEMS_SG: *values = (ALint) src->stems; break;
+        case AL_BUS_SG: *values = (ALint) src->bus; break;
+        case AL_FADE_FRAMES_SG: *values = (ALint) src->fade_remaining; break;
         case AL_DIRECTION:
             values[0] = (ALint) src->direction[0];
             values[1] = (ALint) src->direction[1];
@@ -4032,6 +5499,9 @@ static void _alGetSourcei(const ALuint name, const ALenum param, ALint *value)
         case AL_SEC_OFFSET:
         case AL_SAMPLE_OFFSET:
         case AL_BYTE_OFFSET:
+        case AL_STEMS_SG:
+        case AL_BUS_SG:
+        case AL_FADE_FRAMES_SG:
             _alGetSourceiv(name, param, value);
             break;
         default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
@@ -4055,7 +5525,8 @@ static void _alGetSource3i(const ALuint name, const ALenum param, ALint *value1,
 }
 ENTRYPOINTVOID(alGetSource3i,(ALuint name, ALenum param, ALint *value1, ALint *value2, ALint *value3),(name,param,value1,value2,value3))
 
-static void source_play(ALCcontext *ctx, const ALsizei n, const ALuint *names)
+/* (scheduled) keeps the start frames the caller set, otherwise the sources start right away. */
+static void source_play(ALCcontext *ctx, const ALsizei n, const ALuint *names, const ALboolean scheduled)
 {
     ALboolean failed = AL_FALSE;
     SourcePlayTodo todo;
@@ -4087,7 +5558,7 @@ static void source_play(ALCcontext *ctx, const ALsizei n, const ALuint *names)
         } while (!SDL_AtomicCASPtr(&ctx->device->playback.source_todo_pool, item, ptr));
 
         if (!item) {  /* allocate a new item */
-            item = (SourcePlayTodo *) SDL_calloc(1, sizeof (SourcePlayTodo));
+            item = (SourcePlayTodo *) al_calloc(1, sizeof (SourcePlayTodo));
             if (!item) {
                 set_al_error(ctx, AL_OUT_OF_MEMORY);
                 failed = AL_TRUE;
@@ -4122,6 +5593,11 @@ static void source_play(ALCcontext *ctx, const ALsizei n, const ALuint *names)
                 src->offset = 0;
             }
 
+            if (!scheduled) {
+                src->start_frame = 0;
+            }
+            src->stop_scheduled = AL_FALSE;
+
             /* this used to move right to AL_STOPPED if the device is
                disconnected, but now we let the mixer thread handle that to
                avoid race conditions with marking the buffer queue
@@ -4154,16 +5630,260 @@ static void source_play(ALCcontext *ctx, const ALsizei n, const ALuint *names)
 
 static void _alSourcePlay(const ALuint name)
 {
-    source_play(get_current_context(), 1, &name);
+    source_play(get_current_context(), 1, &name, AL_FALSE);
 }
 ENTRYPOINTVOID(alSourcePlay,(ALuint name),(name))
 
 static void _alSourcePlayv(ALsizei n, const ALuint *names)
 {
-    source_play(get_current_context(), n, names);
+    source_play(get_current_context(), n, names, AL_FALSE);
 }
 ENTRYPOINTVOID(alSourcePlayv,(ALsizei n, const ALuint *names),(n, names))
 
+static void _alSourceStartBatchSG(const ALsourceStartSG *starts, const ALsizei n)
+{
+    ALCcontext *ctx = get_current_context();
+    ALuint stacknames[64];
+    ALuint *names = stacknames;
+    ALsizei count = 0;
+    ALsizei i;
+
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    } else if (n < 0) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    } else if (n == 0) {
+        return;
+    }
+
+    if (n > (ALsizei) SDL_arraysize(stacknames)) {
+        names = (ALuint *) al_malloc(sizeof (ALuint) * n);
+        if (!names) {
+            set_al_error(ctx, AL_OUT_OF_MEMORY);
+            return;
+        }
+    }
+
+    /* Set up every source first, then hand them all to the mixer in one
+       playlist_todo submission, so they start in the same mix. Invalid names
+       set AL_INVALID_NAME and are skipped; the rest still play. */
+    for (i = 0; i < n; i++) {
+        const ALsourceStartSG *start = &starts[i];
+        ALsource *src = get_source(ctx, start->source, NULL);
+        if (!src) {
+            continue;
+        }
+        set_source_static_buffer(ctx, src, start->buffer);
+        src->gain = start->gain;
+        source_set_pitch(ctx, src, start->pitch);
+        SDL_memcpy(src->position, start->position, sizeof (ALfloat) * 3);
+        src->source_relative = start->relative ? AL_TRUE : AL_FALSE;
+        src->reference_distance = start->reference_distance;
+        src->max_distance = start->max_distance;
+        src->rolloff_factor = start->rolloff_factor;
+        src->looping = start->looping ? AL_TRUE : AL_FALSE;
+        if (start->sample_offset > 0) {
+            source_set_offset(src, AL_SAMPLE_OFFSET, (ALfloat) start->sample_offset);
+        }
+        src->start_frame = (Uint64) start->start_frame;
+        src->bus = (start->bus < AL_MAX_BUSES_SG) ? start->bus : 0;
+        source_needs_recalc(src);
+        names[count++] = start->source;
+    }
+
+    source_play(ctx, count, names, AL_TRUE);
+
+    if (names != stacknames) {
+        al_free(names);
+    }
+}
+ENTRYPOINTVOID(alSourceStartBatchSG,(const ALsourceStartSG *starts, ALsizei n),(starts, n))
+
+static void _alSourcePlayAtSG(const ALuint name, const ALuint64SG frame)
+{
+    ALCcontext *ctx = get_current_context();
+    ALsource *src = get_source(ctx, name, NULL);
+    if (src) {
+        const ALboolean must_lock = SDL_AtomicGet(&src->mixer_accessible) ? AL_TRUE : AL_FALSE;
+        if (must_lock) {
+            SDL_LockMutex(ctx->source_lock);
+        }
+        src->start_frame = (Uint64) frame;
+        if (must_lock) {
+            SDL_UnlockMutex(ctx->source_lock);
+        }
+        source_play(ctx, 1, &name, AL_TRUE);
+    }
+}
+ENTRYPOINTVOID(alSourcePlayAtSG,(ALuint source, ALuint64SG frame),(source, frame))
+
+static void _alSourceStopAtSG(const ALuint name, const ALuint64SG frame)
+{
+    ALCcontext *ctx = get_current_context();
+    ALsource *src = get_source(ctx, name, NULL);
+    if (src) {
+        const ALboolean must_lock = SDL_AtomicGet(&src->mixer_accessible) ? AL_TRUE : AL_FALSE;
+        if (must_lock) {
+            SDL_LockMutex(ctx->source_lock);
+        }
+        src->stop_frame = (Uint64) frame;
+        src->stop_scheduled = AL_TRUE;
+        if (must_lock) {
+            SDL_UnlockMutex(ctx->source_lock);
+        }
+    }
+}
+ENTRYPOINTVOID(alSourceStopAtSG,(ALuint source, ALuint64SG frame),(source, frame))
+
+static void _alUpdatePositionsSG(const ALfloat *listener, const ALuint *sources, const ALfloat *positions, const ALsizei n)
+{
+    ALCcontext *ctx = get_current_context();
+    ALsizei i;
+
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    } else if ((n < 0) || ((n > 0) && (!sources || !positions))) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    }
+
+    if (listener) {
+        SDL_memcpy(ctx->listener.position, &listener[0], sizeof (ALfloat) * 3);
+        SDL_memcpy(&ctx->listener.orientation[0], &listener[3], sizeof (ALfloat) * 3);
+        SDL_memcpy(&ctx->listener.orientation[4], &listener[6], sizeof (ALfloat) * 3);
+        context_needs_recalc(ctx);
+    }
+
+    for (i = 0; i < n; i++) {
+        ALsource *src = get_source(ctx, sources[i], NULL);
+        if (src) {
+            SDL_memcpy(src->position, &positions[i * 3], sizeof (ALfloat) * 3);
+            source_needs_recalc(src);
+        }
+    }
+}
+ENTRYPOINTVOID(alUpdatePositionsSG,(const ALfloat *listener, const ALuint *sources, const ALfloat *positions, ALsizei n),(listener, sources, positions, n))
+
+static void _alSourceStemGainsSG(const ALuint name, const ALfloat *gains, const ALsizei n, const ALsizei ramp_frames)
+{
+    ALCcontext *ctx = get_current_context();
+    ALsource *src = get_source(ctx, name, NULL);
+    ALsizei i;
+
+    if (!src) {
+        return;
+    } else if ((n < 0) || (n > AL_MAX_STEM_CHANNELS_SG) || (ramp_frames < 0) || ((n > 0) && !gains)) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    }
+
+    for (i = 0; i < n; i++) {
+        src->stem_targets[i] = gains[i];
+    }
+    src->stem_ramp_frames = ramp_frames;
+    source_needs_recalc(src);
+}
+ENTRYPOINTVOID(alSourceStemGainsSG,(ALuint source, const ALfloat *gains, ALsizei n, ALsizei ramp_frames),(source, gains, n, ramp_frames))
+
+static void _alSourceFadeSG(const ALuint name, const ALfloat gain, const ALsizei frames, const ALboolean stop)
+{
+    ALCcontext *ctx = get_current_context();
+    ALsource *src = get_source(ctx, name, NULL);
+    ALboolean must_lock;
+
+    if (!src) {
+        return;
+    } else if ((gain < 0.0f) || (frames < 0)) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    }
+
+    must_lock = SDL_AtomicGet(&src->mixer_accessible) ? AL_TRUE : AL_FALSE;
+    if (must_lock) {
+        SDL_LockMutex(ctx->source_lock);
+    }
+    if (src->fade_remaining == 0) {
+        src->fade_gain = src->gain;  /* starting fresh, else it carries on from where the last fade got to. */
+    }
+    src->gain = src->fade_target = gain;
+    src->fade_remaining = frames;
+    src->fade_step = frames ? ((gain - src->fade_gain) / (ALfloat) frames) : 0.0f;
+    src->fade_stop = (frames && stop) ? AL_TRUE : AL_FALSE;
+    if (!frames) {
+        src->fade_gain = gain;
+    }
+    source_needs_recalc(src);
+    if (must_lock) {
+        SDL_UnlockMutex(ctx->source_lock);
+    }
+
+    if (!frames && stop) {
+        source_stop(ctx, name);
+    }
+}
+ENTRYPOINTVOID(alSourceFadeSG,(ALuint source, ALfloat gain, ALsizei frames, ALboolean stop),(source, gain, frames, stop))
+
+static MixBus *get_bus(ALCcontext *ctx, const ALuint name)
+{
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return NULL;
+    } else if (name >= AL_MAX_BUSES_SG) {
+        set_al_error(ctx, AL_INVALID_NAME);
+        return NULL;
+    }
+    return &ctx->buses[name];
+}
+
+static void _alBusfSG(const ALuint name, const ALenum param, const ALfloat value)
+{
+    ALCcontext *ctx = get_current_context();
+    MixBus *bus = get_bus(ctx, name);
+    if (!bus) {
+        return;
+    }
+
+    switch (param) {
+        case AL_GAIN:
+            if (value < 0.0f) {
+                set_al_error(ctx, AL_INVALID_VALUE);
+                return;
+            }
+            bus->gain = value;
+            break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); return;
+    }
+    SDL_MemoryBarrierRelease();
+}
+ENTRYPOINTVOID(alBusfSG,(ALuint bus, ALenum param, ALfloat value),(bus, param, value))
+
+static void _alBusiSG(const ALuint name, const ALenum param, const ALint value)
+{
+    ALCcontext *ctx = get_current_context();
+    MixBus *bus = get_bus(ctx, name);
+    if (!bus) {
+        return;
+    }
+
+    switch (param) {
+        case AL_BUS_PARENT_SG:
+            if ((name == 0) || (value < 0) || ((ALuint) value >= name)) {
+                set_al_error(ctx, AL_INVALID_VALUE);  /* master has no parent, and a parent must come before its children. */
+                return;
+            }
+            bus->parent = (ALuint) value;
+            break;
+        case AL_BUS_MUTED_SG: bus->muted = value ? AL_TRUE : AL_FALSE; break;
+        case AL_BUS_PAUSED_SG: bus->paused = value ? AL_TRUE : AL_FALSE; break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); return;
+    }
+    SDL_MemoryBarrierRelease();
+}
+ENTRYPOINTVOID(alBusiSG,(ALuint bus, ALenum param, ALint value),(bus, param, value))
+
 
 static void source_stop(ALCcontext *ctx, const ALuint name)
 {
@@ -4179,6 +5899,9 @@ static void source_stop(ALCcontext *ctx, const ALuint name)
             if (src->stream) {
                 SDL_AudioStreamClear(src->stream);
             }
+            if (src->fade_remaining > 0) {
+                finish_source_fade(src);
+            }
             if (must_lock) {
                 SDL_UnlockMutex(ctx->source_lock);
             }
@@ -4306,11 +6029,11 @@ static void source_set_offset(ALsource *src, ALenum param, ALfloat value)
             ALsizei i; \
             if (n > 1) { \
                 FIXME("Can we do this without a full device lock?"); \
-                SDL_LockAudioDevice(ctx->device->sdldevice);  /* lock the SDL device so these all start mixing in the same callback. */ \
+                lock_device(ctx->device);  /* lock the device so these all start mixing in the same callback. */ \
                 for (i = 0; i < n; i++) { \
                     source_##fn(ctx, sources[i]); \
                 } \
-                SDL_UnlockAudioDevice(ctx->device->sdldevice); \
+                unlock_device(ctx->device); \
             } else if (n == 1) { \
                 source_##fn(ctx, *sources); \
             } \
@@ -4375,7 +6098,7 @@ static void _alSourceQueueBuffers(const ALuint name, const ALsizei nb, const ALu
         if (item) {
             ctx->device->playback.buffer_queue_pool = (BufferQueueItem*)item->next;
         } else {  /* allocate a new item */
-            item = (BufferQueueItem *) SDL_calloc(1, sizeof (BufferQueueItem));
+            item = (BufferQueueItem *) al_calloc(1, sizeof (BufferQueueItem));
             if (!item) {
                 set_al_error(ctx, AL_OUT_OF_MEMORY);
                 failed = AL_TRUE;
@@ -4557,7 +6280,7 @@ static void _alGenBuffers(const ALsizei n, ALuint *names)
     if (n <= SDL_arraysize(stackobjs)) {
         SDL_memset(stackobjs, '\0', sizeof (ALbuffer *) * n);
     } else {
-        objects = (ALbuffer **) SDL_calloc(n, sizeof (ALbuffer *));
+        objects = (ALbuffer **) al_calloc(n, sizeof (ALbuffer *));
         if (!objects) {
             set_al_error(ctx, AL_OUT_OF_MEMORY);
             return;
@@ -4590,7 +6313,7 @@ static void _alGenBuffers(const ALsizei n, ALuint *names)
 
     while (found < n) {  /* out of blocks? Add new ones. */
         /* ctx->buffer_blocks is only accessed on the API thread under a mutex, so it's safe to realloc. */
-        void *ptr = SDL_realloc(ctx->device->playback.buffer_blocks, sizeof (BufferBlock *) * (totalblocks + 1));
+        void *ptr = al_realloc(ctx->device->playback.buffer_blocks, sizeof (BufferBlock *) * (totalblocks + 1));
         BufferBlock *block;
 
         if (!ptr) {
@@ -4599,7 +6322,7 @@ static void _alGenBuffers(const ALsizei n, ALuint *names)
         }
         ctx->device->playback.buffer_blocks = (BufferBlock **) ptr;
 
-        block = (BufferBlock *) SDL_calloc(1, sizeof (BufferBlock));
+        block = (BufferBlock *) al_calloc(1, sizeof (BufferBlock));
         if (!block) {
             out_of_memory = AL_TRUE;
             break;
@@ -4620,7 +6343,7 @@ static void _alGenBuffers(const ALsizei n, ALuint *names)
     }
 
     if (out_of_memory) {
-        if (objects != stackobjs) SDL_free(objects);
+        if (objects != stackobjs) al_free(objects);
         SDL_memset(names, '\0', sizeof (*names) * n);
         set_al_error(ctx, AL_OUT_OF_MEMORY);
         return;
@@ -4654,7 +6377,7 @@ static void _alGenBuffers(const ALsizei n, ALuint *names)
         buffer->allocated = AL_TRUE;  /* we officially own it. */
     }
 
-    if (objects != stackobjs) SDL_free(objects);
+    if (objects != stackobjs) al_free(objects);
 }
 ENTRYPOINTVOID(alGenBuffers,(ALsizei n, ALuint *names),(n,names))
 
@@ -4696,6 +6419,8 @@ static void _alDeleteBuffers(const ALsizei n, const ALuint *names)
             buffer->allocated = AL_FALSE;
             buffer->data = NULL;
             free_simd_aligned(data);
+            al_free((void *) buffer->ima4);
+            buffer->ima4 = NULL;
             block->used--;
         }
     }
@@ -4709,10 +6434,58 @@ static ALboolean _alIsBuffer(ALuint name)
 }
 ENTRYPOINT(ALboolean,alIsBuffer,(ALuint name),(name))
 
-static void _alBufferData(const ALuint name, const ALenum alfmt, const ALvoid *data, const ALsizei size, const ALsizei freq)
+/* AL_EXT_IMA4 data is kept as-is and decoded while mixing, instead of being converted to float32 up front. */
+static void buffer_data_ima4(ALCcontext *ctx, ALbuffer *buffer, const ALenum alfmt, const ALvoid *data, const ALsizei size, const ALsizei freq)
+{
+    const ALint channels = (alfmt == AL_FORMAT_STEREO_IMA4) ? 2 : 1;
+    const ALsizei blocksize = IMA4_BLOCK_SIZE * channels;
+    Uint8 *ima4;
+    int prevrefcount;
+
+    if ((size < 0) || ((size % blocksize) != 0)) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    }
+
+    #ifdef MOJOAL_FIXED_RATE
+    if (freq != MOJOAL_FIXED_RATE) {
+        set_al_error(ctx, AL_INVALID_VALUE);  /* built to never resample. */
+        return;
+    }
+    #endif
+
+    /* increment refcount so this can't be deleted or alBufferData'd from another thread */
+    prevrefcount = SDL_AtomicIncRef(&buffer->refcount);
+    SDL_assert(prevrefcount >= 0);
+    if (prevrefcount != 0) {
+        /* this buffer is being used by some source. Unqueue it first. */
+        (void) SDL_AtomicDecRef(&buffer->refcount);
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    ima4 = (Uint8 *) al_malloc(size ? size : 1);
+    if (!ima4) {
+        (void) SDL_AtomicDecRef(&buffer->refcount);
+        set_al_error(ctx, AL_OUT_OF_MEMORY);
+        return;
+    }
+    SDL_memcpy(ima4, data, size);
+
+    free_simd_aligned((void *) buffer->data);  /* nuke any previous data. */
+    al_free((void *) buffer->ima4);
+    buffer->data = NULL;
+    buffer->ima4 = ima4;
+    buffer->channels = channels;
+    buffer->bits = 4;
+    buffer->frequency = freq;
+    buffer->len = (size / blocksize) * IMA4_BLOCK_FRAMES * channels * (ALsizei) sizeof (float);
+    (void) SDL_AtomicDecRef(&buffer->refcount);  /* ready to go! */
+}
+
+/* `stems` copies of alfmt's channels are interleaved in each frame, 1 for regular buffers. */
+static void buffer_data(ALCcontext *ctx, ALbuffer *buffer, const ALenum alfmt, const ALsizei stems, const ALvoid *data, const ALsizei size, const ALsizei freq)
 {
-    ALCcontext *ctx = get_current_context();
-    ALbuffer *buffer = get_buffer(ctx, name, NULL);
     SDL_AudioCVT sdlcvt;
     Uint8 channels;
     SDL_AudioFormat sdlfmt;
@@ -4720,12 +6493,21 @@ static void _alBufferData(const ALuint name, const ALenum alfmt, const ALvoid *d
     int rc;
     int prevrefcount;
 
-    if (!buffer) return;
-
     if (!alcfmt_to_sdlfmt(alfmt, &sdlfmt, &channels, &framesize)) {
         set_al_error(ctx, AL_INVALID_VALUE);
         return;
+    } else if ((stems < 1) || ((channels * stems) > AL_MAX_STEM_CHANNELS_SG)) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    }
+
+    #ifdef MOJOAL_FIXED_RATE
+    if (freq != MOJOAL_FIXED_RATE) {
+        set_al_error(ctx, AL_INVALID_VALUE);  /* built to never resample. */
+        return;
     }
+    #endif
+    channels *= (Uint8) stems;
 
     /* increment refcount so this can't be deleted or alBufferData'd from another thread */
     prevrefcount = SDL_AtomicIncRef(&buffer->refcount);
@@ -4764,7 +6546,7 @@ static void _alBufferData(const ALuint name, const ALenum alfmt, const ALvoid *d
         SDL_assert(rc == 0);  /* this shouldn't fail. */
         #if 0   /* !!! FIXME: need realloc_simd_aligned. */
         if (sdlcvt.len_cvt < (size * sdlcvt.len_mult)) {  /* maybe shrink buffer */
-            void *ptr = SDL_realloc(sdlcvt.buf, sdlcvt.len_cvt);
+            void *ptr = al_realloc(sdlcvt.buf, sdlcvt.len_cvt);
             if (ptr) {
                 sdlcvt.buf = (Uint8 *) ptr;
             }
@@ -4773,6 +6555,8 @@ static void _alBufferData(const ALuint name, const ALenum alfmt, const ALvoid *d
     }
 
     free_simd_aligned((void *) buffer->data);  /* nuke any previous data. */
+    al_free((void *) buffer->ima4);
+    buffer->ima4 = NULL;
     buffer->data = (const float *) sdlcvt.buf;
     buffer->channels = (ALint) channels;
     buffer->bits = (ALint) SDL_AUDIO_BITSIZE(sdlfmt);  /* we're in float32, though. */
@@ -4780,7 +6564,52 @@ static void _alBufferData(const ALuint name, const ALenum alfmt, const ALvoid *d
     buffer->len = (ALsizei) sdlcvt.len_cvt;
     (void) SDL_AtomicDecRef(&buffer->refcount);  /* ready to go! */
 }
-ENTRYPOINTVOID(alBufferData,(ALuint name, ALenum alfmt, const ALvoid *data, ALsizei size, ALsizei freq),(name,alfmt,data,size,freq))
+
+static void _alBufferData(const ALuint name, const ALenum alfmt, const ALvoid *data, const ALsizei size, const ALsizei freq)
+{
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+
+    if (!buffer) return;
+
+    if ((alfmt == AL_FORMAT_MONO_IMA4) || (alfmt == AL_FORMAT_STEREO_IMA4)) {
+        buffer_data_ima4(ctx, buffer, alfmt, data, size, freq);
+        return;
+    }
+
+    buffer_data(ctx, buffer, alfmt, 1, data, size, freq);
+}
+void alBufferData(ALuint name, ALenum alfmt, const ALvoid *data, ALsizei size, ALsizei freq)
+{
+    grab_api_lock();
+    PROFILE_BEGIN("BufferData", size);  /* out here so every early return in the conversion is covered. */
+    _alBufferData(name, alfmt, data, size, freq);
+    PROFILE_END();
+    ungrab_api_lock();
+}
+
+static void _alBufferStemsSG(const ALuint name, const ALenum alfmt, const ALsizei stems, const ALvoid *data, const ALsizei size, const ALsizei freq)
+{
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+
+    if (!buffer) return;
+
+    if ((alfmt == AL_FORMAT_MONO_IMA4) || (alfmt == AL_FORMAT_STEREO_IMA4)) {
+        set_al_error(ctx, AL_INVALID_VALUE);  /* blocks are per channel, there's no stem layout for them. */
+        return;
+    }
+
+    buffer_data(ctx, buffer, alfmt, stems, data, size, freq);
+}
+void alBufferStemsSG(ALuint name, ALenum alfmt, ALsizei stems, const ALvoid *data, ALsizei size, ALsizei freq)
+{
+    grab_api_lock();
+    PROFILE_BEGIN("BufferData", size);
+    _alBufferStemsSG(name, alfmt, stems, data, size, freq);
+    PROFILE_END();
+    ungrab_api_lock();
+}
 
 static void _alBufferfv(const ALuint name, const ALenum param, const ALfloat *values)
 {
@@ -4806,9 +6635,43 @@ static void _alBufferiv(const ALuint name, const ALenum param, const ALint *valu
 }
 ENTRYPOINTVOID(alBufferiv,(ALuint name, ALenum param, const ALint *values),(name,param,values))
 
+/* only AL_BUFFER_FRAMES_SG, which trims the block padding off AL_EXT_IMA4 buffers; nothing in core OpenAL 1.1 uses this */
 static void _alBufferi(const ALuint name, const ALenum param, const ALint value)
 {
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer;
+    ALsizei framesize;
+    int prevrefcount;
+
+    if (param != AL_BUFFER_FRAMES_SG) {
+        set_al_error(ctx, AL_INVALID_ENUM);
+        return;
+    }
+
+    buffer = get_buffer(ctx, name, NULL);
+    if (!buffer) {
+        return;
+    } else if (!buffer->ima4) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    framesize = buffer->channels * (ALsizei) sizeof (float);
+    if ((value <= 0) || (value > (buffer->len / framesize))) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    }
+
+    /* same as alBufferData, a source mixing it can't have the length change under it. */
+    prevrefcount = SDL_AtomicIncRef(&buffer->refcount);
+    SDL_assert(prevrefcount >= 0);
+    if (prevrefcount != 0) {
+        (void) SDL_AtomicDecRef(&buffer->refcount);
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+    buffer->len = value * framesize;
+    (void) SDL_AtomicDecRef(&buffer->refcount);
 }
 ENTRYPOINTVOID(alBufferi,(ALuint name, ALenum param, ALint value),(name,param,value))
 
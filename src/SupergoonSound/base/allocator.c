@@ -0,0 +1,80 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+
+static SoundMallocFunc sound_malloc = NULL;
+static SoundReallocFunc sound_realloc = NULL;
+static SoundFreeFunc sound_free = NULL;
+static void *sound_allocator_userdata = NULL;
+
+void SetSoundAllocator(SoundMallocFunc malloc_fn, SoundReallocFunc realloc_fn, SoundFreeFunc free_fn, void *userdata)
+{
+    // All or nothing, mixing ours and theirs would free memory with the wrong one.
+    if (!malloc_fn || !realloc_fn || !free_fn)
+    {
+        malloc_fn = NULL;
+        realloc_fn = NULL;
+        free_fn = NULL;
+        userdata = NULL;
+    }
+    sound_malloc = malloc_fn;
+    sound_realloc = realloc_fn;
+    sound_free = free_fn;
+    sound_allocator_userdata = userdata;
+}
+
+void *SoundMalloc(size_t size)
+{
+    return sound_malloc ? sound_malloc(size, sound_allocator_userdata) : malloc(size);
+}
+
+void *SoundCalloc(size_t count, size_t size)
+{
+    if (!sound_malloc)
+    {
+        return calloc(count, size);
+    }
+    if (size && count > SIZE_MAX / size)
+    {
+        return NULL;
+    }
+    void *ptr = sound_malloc(count * size, sound_allocator_userdata);
+    if (ptr)
+    {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void *SoundRealloc(void *ptr, size_t size)
+{
+    return sound_realloc ? sound_realloc(ptr, size, sound_allocator_userdata) : realloc(ptr, size);
+}
+
+void SoundFree(void *ptr)
+{
+    if (!ptr)
+    {
+        return;
+    }
+    if (sound_free)
+    {
+        sound_free(ptr, sound_allocator_userdata);
+    }
+    else
+    {
+        free(ptr);
+    }
+}
+
+char *SoundStrdup(const char *string)
+{
+    size_t length = strlen(string) + 1;
+    char *copy = SoundMalloc(length);
+    if (copy)
+    {
+        memcpy(copy, string, length);
+    }
+    return copy;
+}
@@ -0,0 +1,34 @@
+/**
+ * @file allocator.h
+ * @brief Every allocation the library makes goes through here, so the app can supply its own allocator.
+ * @author Kevin Blanchard
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#pragma once
+#include <stddef.h>
+
+typedef void *(*SoundMallocFunc)(size_t size, void *userdata);
+typedef void *(*SoundReallocFunc)(void *ptr, size_t size, void *userdata);
+typedef void (*SoundFreeFunc)(void *ptr, void *userdata);
+
+/**
+ * @brief Replaces the allocator, memory must be freed by the allocator it came from so only change it when nothing is allocated.
+ *
+ * @param malloc_fn Allocates, NULL puts back malloc, realloc and free.
+ * @param realloc_fn Grows or shrinks memory, gets NULL like realloc does.
+ * @param free_fn Frees memory, never gets NULL.
+ * @param userdata Passed to every function.
+ */
+void SetSoundAllocator(SoundMallocFunc malloc_fn, SoundReallocFunc realloc_fn, SoundFreeFunc free_fn, void *userdata);
+void *SoundMalloc(size_t size);
+/**
+ * @brief Allocates zeroed memory for count items, NULL if the size overflows.
+ */
+void *SoundCalloc(size_t count, size_t size);
+void *SoundRealloc(void *ptr, size_t size);
+/**
+ * @brief Frees memory from the allocator, NULL is ignored.
+ */
+void SoundFree(void *ptr);
+char *SoundStrdup(const char *string);
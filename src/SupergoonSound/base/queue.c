@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include "allocator.h"
 #include "queue.h"
 
 /**
@@ -11,8 +12,8 @@ static void MoveDataToFrontOfQueue(queue *queue);
 
 queue *CreateQueue(int capacity)
 {
-    queue *queue = malloc(sizeof(*queue));
-    queue->data = calloc(capacity, sizeof(int));
+    queue *queue = SoundMalloc(sizeof(*queue));
+    queue->data = SoundCalloc(capacity, sizeof(int));
     queue->capacity = capacity;
     queue->rear = queue->front = 0;
     return queue;
@@ -20,9 +21,9 @@ queue *CreateQueue(int capacity)
 
 void DestroyQueue(queue *queue)
 {
-    free(queue->data);
+    SoundFree(queue->data);
     queue->data = NULL;
-    free(queue);
+    SoundFree(queue);
     queue = NULL;
 }
 
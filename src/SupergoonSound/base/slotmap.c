@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include "allocator.h"
+#include "slotmap.h"
+
+#define SLOT_INDEX_BITS 16
+#define SLOT_INDEX_MASK 0xFFFF
+
+SlotMap *CreateSlotMap(int capacity)
+{
+    SlotMap *slot_map = SoundMalloc(sizeof(*slot_map));
+    slot_map->slots = SoundCalloc(capacity, sizeof(SlotMapSlot));
+    slot_map->capacity = capacity;
+    slot_map->size = 0;
+    // Link the free list so the lowest slots are handed out first.
+    for (int i = 0; i < capacity; ++i)
+    {
+        slot_map->slots[i].generation = 1;
+        slot_map->slots[i].next_free = (i + 1 < capacity) ? i + 1 : -1;
+    }
+    slot_map->free_head = capacity ? 0 : -1;
+    return slot_map;
+}
+
+void DestroySlotMap(SlotMap *slot_map)
+{
+    SoundFree(slot_map->slots);
+    slot_map->slots = NULL;
+    SoundFree(slot_map);
+    slot_map = NULL;
+}
+
+SlotHandle SlotMapInsert(SlotMap *slot_map)
+{
+    if (slot_map->free_head == -1)
+        return 0;
+    int index = slot_map->free_head;
+    SlotMapSlot *slot = &slot_map->slots[index];
+    slot_map->free_head = slot->next_free;
+    slot->next_free = -1;
+    slot->in_use = 1;
+    ++slot_map->size;
+    return ((SlotHandle)slot->generation << SLOT_INDEX_BITS) | (SlotHandle)index;
+}
+
+int SlotMapRemove(SlotMap *slot_map, SlotHandle handle)
+{
+    int index = SlotMapIndex(slot_map, handle);
+    if (index == -1)
+        return 0;
+    SlotMapSlot *slot = &slot_map->slots[index];
+    // Skip 0 when wrapping, so a handle can never be 0.
+    if (++slot->generation == 0)
+        slot->generation = 1;
+    slot->in_use = 0;
+    slot->next_free = slot_map->free_head;
+    slot_map->free_head = index;
+    --slot_map->size;
+    return 1;
+}
+
+int SlotMapIndex(SlotMap *slot_map, SlotHandle handle)
+{
+    int index = (int)(handle & SLOT_INDEX_MASK);
+    uint16_t generation = (uint16_t)(handle >> SLOT_INDEX_BITS);
+    if (!handle || index >= slot_map->capacity)
+        return -1;
+    SlotMapSlot *slot = &slot_map->slots[index];
+    if (!slot->in_use || slot->generation != generation)
+        return -1;
+    return index;
+}
+
+SlotHandle SlotMapHandleAt(SlotMap *slot_map, int index)
+{
+    if (index < 0 || index >= slot_map->capacity || !slot_map->slots[index].in_use)
+        return 0;
+    return ((SlotHandle)slot_map->slots[index].generation << SLOT_INDEX_BITS) | (SlotHandle)index;
+}
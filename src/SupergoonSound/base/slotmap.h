@@ -0,0 +1,84 @@
+/**
+ * @file slotmap.h
+ * @brief Fixed size array of slots that hands out generational handles, so stale handles can be detected.
+ * @author Kevin Blanchard
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * @brief A handle is the slot index in the low 16 bits, and the slot generation in the high 16 bits.  0 is never a valid handle.
+ */
+typedef uint32_t SlotHandle;
+
+typedef struct SlotMapSlot
+{
+    // Bumped every time the slot is freed, never 0.
+    uint16_t generation;
+    // The next free slot while this one is free, -1 when in use or the end of the free list.
+    int next_free;
+    unsigned char in_use;
+} SlotMapSlot;
+
+/**
+ * @brief Slots with a intrusive free list, insert/remove/lookup are all O(1).
+ */
+typedef struct SlotMap
+{
+    SlotMapSlot *slots;
+    int capacity;
+    int size;
+    int free_head;
+} SlotMap;
+
+/**
+ * @brief Creates a slot map that does not grow in size.
+ *
+ * @param capacity The amount of slots, max 65536.
+ *
+ * @return A newly created slot map with every slot free.
+ */
+SlotMap *CreateSlotMap(int capacity);
+/**
+ * @brief Destroys a slot map and releases it's data.
+ *
+ * @param slot_map The slot map to destroy.
+ */
+void DestroySlotMap(SlotMap *slot_map);
+/**
+ * @brief Takes a free slot.
+ *
+ * @param slot_map The slot map to take from
+ *
+ * @return The handle for the slot, or 0 if every slot is in use.
+ */
+SlotHandle SlotMapInsert(SlotMap *slot_map);
+/**
+ * @brief Frees the slot a handle points to, which makes every copy of the handle stale.
+ *
+ * @param slot_map The slot map to free from
+ * @param handle The handle to free
+ *
+ * @return 1 if it was freed, 0 if the handle was already stale.
+ */
+int SlotMapRemove(SlotMap *slot_map, SlotHandle handle);
+/**
+ * @brief Gets the slot index for a handle.
+ *
+ * @param slot_map The slot map to look in
+ * @param handle The handle to validate
+ *
+ * @return The slot index, or -1 if the handle is 0 or stale.
+ */
+int SlotMapIndex(SlotMap *slot_map, SlotHandle handle);
+/**
+ * @brief Gets the current handle for a slot in use.
+ *
+ * @param slot_map The slot map to look in
+ * @param index The slot index
+ *
+ * @return The handle, or 0 if the slot is free.
+ */
+SlotHandle SlotMapHandleAt(SlotMap *slot_map, int index);
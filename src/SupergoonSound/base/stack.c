@@ -1,11 +1,12 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include "allocator.h"
 #include "stack.h"
 
 Stack *CreateStack(int capacity)
 {
-    Stack *stack = malloc(sizeof(*stack));
-    stack->data = calloc(capacity, sizeof(int));
+    Stack *stack = SoundMalloc(sizeof(*stack));
+    stack->data = SoundCalloc(capacity, sizeof(int));
     stack->capacity = capacity;
     stack->size = 0;
     return stack;
@@ -31,7 +32,7 @@ void PushStack(Stack *stack, int item)
 
 void DestroyStack(Stack *stack)
 {
-    free(stack->data);
-    free(stack);
+    SoundFree(stack->data);
+    SoundFree(stack);
     stack = NULL;
 }
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include "allocator.h"
 #include "vector.h"
 
 #define VECTOR_INCREASE_MULTIPLIER 2
@@ -9,8 +10,8 @@ static int IncreaseVectorSize(vector *vector);
 vector *CreateVector(void)
 {
     const int initial_size = 2;
-    vector *vector = malloc(sizeof(*vector));
-    vector->data = calloc(initial_size, sizeof(int));
+    vector *vector = SoundMalloc(sizeof(*vector));
+    vector->data = SoundCalloc(initial_size, sizeof(int));
     vector->capacity = initial_size;
     vector->size = 0;
 
@@ -19,9 +20,9 @@ vector *CreateVector(void)
 
 void DestroyVector(vector *vector)
 {
-    free(vector->data);
+    SoundFree(vector->data);
     vector->data = NULL;
-    free(vector);
+    SoundFree(vector);
     vector = NULL;
 }
 
@@ -36,7 +37,7 @@ void VectorPushBack(vector *vector, int value)
 
 static int IncreaseVectorSize(vector *vector)
 {
-    vector->data = realloc(vector->data, sizeof(int) * vector->capacity * VECTOR_INCREASE_MULTIPLIER);
+    vector->data = SoundRealloc(vector->data, sizeof(int) * vector->capacity * VECTOR_INCREASE_MULTIPLIER);
     vector->capacity *= VECTOR_INCREASE_MULTIPLIER;
     return 1;
 }
@@ -7,6 +7,8 @@
  */
 
 #pragma once
+#include <stddef.h>
+#include <stdint.h>
 typedef struct Sg_Loaded_Sfx Sg_Loaded_Sfx;
 #ifdef __cplusplus
 extern "C" {
@@ -22,25 +24,225 @@ typedef struct gsBgm {
 
 } gsBgm;
 
+#define GS_MAX_STEMS 8
+
+/**
+ * @brief The stems of one song, played together on the stem player with a gain for each.
+ */
+typedef struct gsStems {
+	char *stem_names[GS_MAX_STEMS];
+	int count;
+} gsStems;
+
+#define GS_MAX_BUSES 16
+
+/**
+ * @brief The buses everything mixes through.  They form a tree with gsBus_Master at the root, and a bus's volume, mute and pause apply to everything on it and every bus under it.
+ */
+typedef enum gsBus {
+	gsBus_Master,
+	// Bgm, background bgm and stems.
+	gsBus_Music,
+	// Sfx that don't pick another bus.
+	gsBus_Sfx,
+	gsBus_Voice,
+	gsBus_Ui,
+	// The first bus left for the game, every bus up to GS_MAX_BUSES - 1 can be used.  They start under gsBus_Master like the others.
+	gsBus_User,
+} gsBus;
+
 /**
  * @brief Holds a sfx name and the loaded file if it is loaded.
  */
 typedef struct gsSfx {
 	char *sfx_name;
 	Sg_Loaded_Sfx *loaded_sfx;
+	// When there are more voices than sources, higher priority voices get mixed first.  Default 0.
+	int priority;
+	// Most voices of this sfx that can play at once, further triggers are ignored.  0 is no limit.
+	int max_instances;
+	// Triggers closer than this to the last one are ignored.  0 is no limit.
+	float min_retrigger_seconds;
+	// If set, triggers in the same update are added to the first voice's volume (up to 1) instead of starting new voices.
+	int coalesce;
+	// If set before loading, it streams from the file when played instead of being fully decoded, no matter how long it is.  Only ogg files stream, wav files are always used in place.
+	int stream;
+	// Positional voices are full volume within min_distance of the listener, and fade out to silent at max_distance.  Default 0 and 0, a max_distance not past min_distance only pans and never fades.
+	float min_distance;
+	float max_distance;
+	// The bus its voices play through.  Default 0 plays on gsBus_Sfx, put a bus under gsBus_Master to play there instead.
+	gsBus bus;
 } gsSfx;
 
+/**
+ * @brief Which threads can make sound calls.
+ */
+typedef enum gsCommandMode {
+	// Every call must come from the same thread, the default.
+	gsCommandMode_Direct,
+	// Calls from threads other than the one that initialized sound are queued without locking, and applied at the start of gsUpdateSound.
+	gsCommandMode_Queued,
+	// Sound runs on its own thread that updates itself, every call is queued to it and gsUpdateSound does nothing.  The finished callback is called on that thread.
+	gsCommandMode_Thread,
+} gsCommandMode;
+
+/**
+ * @brief Settings used when opening the audio device.  Any field left at 0 uses the default.
+ */
+typedef struct gsSoundConfig {
+	// Mixing rate in hz, default 48000.
+	int sample_rate;
+	// Sample frames mixed per audio callback, default 1024.  Lower is less latency, higher is less cpu wakeups.
+	int period_frames;
+	// Output channels, 1, 2, 4, 6, 7 or 8.  Default 2.
+	int channels;
+	// Which threads can make sound calls, default gsCommandMode_Direct.
+	// When calls are queued they can't know the outcome yet, so plays return a voice of 0 and other calls return 1 if they were queued.
+	// Loading and unloading is queued as well, gsNewSfx and gsLoadBgm can be called from anywhere.
+	// Checking a voice from another thread is only supported in gsCommandMode_Thread, and briefly locks the sound thread.
+	gsCommandMode command_mode;
+	// Ogg sfx longer than this many seconds stream from their file when played, instead of being decoded into memory.  Only 4 can stream at once.  Default 10, negative never streams.
+	float sfx_stream_seconds;
+	// Most bytes of decoded sfx to keep in memory, the least recently played are evicted past it and decoded again when played.  Default 0, no limit.
+	size_t pcm_budget_bytes;
+	// If set, decoded sfx are kept in the mixer as IMA ADPCM and decoded as they play, about a seventh of the memory for a little mixing time and some quality.  Default 0.
+	int compress_sfx;
+	// If set, no audio device is opened and nothing is heard, the mix is pulled with gsRenderSound instead.  Default 0.
+	int headless;
+	// If set, every sound call is recorded to this file with its arguments and time, for the replay tool to run again.  Default NULL, not recorded.
+	const char *trace_filename;
+	// If set in a build configured with GOON_SOUND_PROFILE, timing spans for the mixer, updates, decoding and file loads are written to this file as Chrome trace event json.  Default NULL.
+	const char *profile_filename;
+	// Voices quieter than this after distance fading are culled, kept in time without being mixed until they can be heard again.  Default 0.001.
+	float cull_gain;
+	// Extra threads that mix voices alongside the audio callback, for when hundreds play at once.  Only splits the mix while 32 or more sources are playing, so it needs a build with GOON_SOUND_MAX_SOURCES raised above the default of 10.  Default 0, all on the callback.
+	int mix_threads;
+} gsSoundConfig;
+
+/**
+ * @brief Memory use, decoded sfx cache and voice culling counts, from gsGetSoundStats.
+ */
+typedef struct gsSoundStats {
+	// Bytes of decoded sfx held by the mixer (compressed size when compress_sfx is set), and the budget they are kept under, 0 is no limit.
+	size_t pcm_bytes;
+	size_t pcm_budget;
+	// Bytes of compressed sfx kept in memory, so evicted sfx can be decoded again without the file.
+	size_t encoded_bytes;
+	// Plays that found their sfx still decoded, and plays that had to decode it first.
+	unsigned long pcm_hits;
+	unsigned long pcm_misses;
+	// Decoded sfx evicted to stay under the budget.
+	unsigned long pcm_evictions;
+	// Plays dropped because the sfx couldn't fit in the budget, everything else decoded was playing.
+	unsigned long pcm_failures;
+	// Real voices taken off the mixer because they faded below cull_gain, moved out of range or were occluded.
+	unsigned long voice_culls;
+} gsSoundStats;
+
+/**
+ * @brief How long the mixer takes against its deadline, from gsGetCallbackTiming.  The deadline is how long the frames mixed in one callback take to play, if a mix takes longer the device runs dry and the sound skips.
+ */
+typedef struct gsCallbackTiming {
+	// Mixes timed, and the ones that took longer than their deadline.
+	unsigned long callbacks;
+	unsigned long overruns;
+	// Mix time as a fraction of the deadline, 1 is the deadline.  Percentiles are rounded up to the next 1/128.
+	float p50_load;
+	float p99_load;
+	float max_load;
+	// The same in milliseconds, and the deadline of the last mix.
+	float p50_ms;
+	float p99_ms;
+	float max_ms;
+	float deadline_ms;
+} gsCallbackTiming;
+
+/**
+ * @brief Handle to a playing sfx.  It goes stale when the sound finishes or is stopped, and stale handles are safely ignored.  0 is never a valid voice.
+ */
+typedef unsigned int gsVoice;
+
+/**
+ * @brief One sfx to play with gsPlaySfxBatch.
+ */
+typedef struct gsPlayRequest {
+	gsSfx *sfx;
+	float volume;
+	// 1 is regular pitch, 0 is treated as 1.
+	float pitch;
+	// -1 is full left, 0 is center, 1 is full right.  Only mono sfx can be panned.
+	float pan;
+	// If it should loop until gsStopVoice is called.
+	int looping;
+	// If set, the voice plays at position in the world instead of being panned, and is panned and faded from where the listener is.  Only mono sfx are placed, others play as if the listener was on top of them.
+	int positional;
+	float position[3];
+	// The sound clock frame to start on, from gsGetSoundClock.  0 starts right away.
+	uint64_t start_frame;
+} gsPlayRequest;
+
+/**
+ * @brief Where sound is heard from, for positional voices.  The default listener is at 0, facing -z with +y up, which suits a top down game in the x y plane.
+ */
+typedef struct gsListener {
+	float position[3];
+	// The direction the listener faces and the direction of up from it, left at 0 they keep the default.
+	float forward[3];
+	float up[3];
+} gsListener;
+
+/**
+ * @brief Functions every allocation goes through, including the mixer's.  They can be called from any thread.  realloc gets NULL like realloc does, and free never gets NULL.
+ */
+typedef struct gsAllocator {
+	void *(*malloc)(size_t size, void *userdata);
+	void *(*realloc)(void *ptr, size_t size, void *userdata);
+	void (*free)(void *ptr, void *userdata);
+	// Passed to every function.
+	void *userdata;
+} gsAllocator;
+
+/**
+ * @brief Memory for a group of sfx and bgm, usually a level's, that are all freed at once.
+ */
+typedef struct gsArena gsArena;
+/**
+ * @brief A device and everything playing on it, so more than one can run in a process, like headless engines rendering on their own threads.
+ *
+ * Engines mix in parallel, but the mixer has one lock that every call into it takes, whichever engine it is for.  So
+ * sound calls on different engines still wait on each other, and a call that has to hold off a engine's mix, like
+ * reading its clock while it renders headless, holds up the other engines' calls until that mix is done.
+ */
+typedef struct gsEngine gsEngine;
+
+/**
+ * @brief Called from gsUpdateSound when a sfx finishes playing on its own.
+ *
+ * @param sfx The sfx that finished.
+ * @param voice The voice it was playing on, already stale when this is called.
+ * @param userdata The pointer passed to gsSetSfxFinishedCallback.
+ */
+typedef void (*gsSfxFinishedCallback)(gsSfx *sfx, gsVoice voice, void *userdata);
+
 gsBgm *gsLoadBgm(const char *filename);
 gsBgm *gsLoadBgmWithLoopPoints(const char *filename, float loop_begin, float loop_end);
 void gsUnloadBgm(gsBgm* bgm);
 int gsPreLoadBgm(gsBgm *bgm, int background);
 gsSfx *gsNewSfx(const char *filename);
 /**
- * @brief Load the Sound backend, this must be called before any other functions are available.
+ * @brief Load the Sound backend, this must be called before any other functions are available.  It makes the default engine, the one calls work on from threads that haven't set their own.
  *
  * @return 1 if successful, 0 if failure.
  */
 int gsInitializeSound(void);
+/**
+ * @brief Load the Sound backend with a specific device configuration, this must be called before any other functions are available.
+ *
+ * @param config The device settings to use, NULL is the same as gsInitializeSound.
+ *
+ * @return 1 if successful, 0 if failure.
+ */
+int gsInitializeSoundEx(const gsSoundConfig *config);
 /**
  * @brief Play a specific BGM.  It will loop continuously until you call the Stop function on it.  Its loop points and number are determined by the config file.
  *
@@ -50,6 +252,24 @@ int gsInitializeSound(void);
  * @return 1 if Successful, 0 if failed to start.
  */
 int gsPlayBgm(float volume);
+/**
+ * @brief Play the loaded BGM starting on a exact frame of the sound clock, so it lines up with scheduled sfx.
+ *
+ * @param frame The frame to start on, from gsGetSoundClock.  A frame already passed starts right away.
+ *
+ * @return 1 if Successful, 0 if failed to start.
+ */
+int gsPlayBgmScheduled(float volume, uint64_t frame);
+/**
+ * @brief Gets the sound clock, the number of sample frames mixed since sound was initialized.  It counts at gsGetSoundSampleRate, and is where the next mix starts, so schedule a little past it.
+ *
+ * @return The frame, 0 if called from another thread in gsCommandMode_Queued.
+ */
+uint64_t gsGetSoundClock(void);
+/**
+ * @brief Gets the output sample rate, the rate the sound clock counts at.
+ */
+int gsGetSoundSampleRate(void);
 int gsPlayBackgroundBgm(float volume);
 /**
  * @brief Stops a playing bgm.  If stop_at_end is true, then it will stop playing at the end of the song.
@@ -63,13 +283,162 @@ int gsStopBackgroundBgm(void);
 int gsPauseBgm(void);
 int gsUnPauseBgm(void);
 /**
- * @brief Plays a Sound effect once in its own buffer.  There is only a total of 10 buffers available for playing at a time. If the sound is not loaded, will load the sound
+ * @brief Plays a Sound effect once. If the sound is not loaded, will load the sound
+ * Only 10 voices are mixed at a time, by priority then how loud they are to the listener.  The rest are virtual, they keep their place in the sound without being mixed, and are mixed again when they matter.
  *
  * @param sfx_number The Sound effect to play
  *
- * @return 1 if successful, 0 if failed to start
+ * @return The voice it is playing on, or 0 if failed to start
+ */
+gsVoice gsPlaySfxOneShot(gsSfx *sfx_number, float volume);
+/**
+ * @brief Plays a Sound effect on loop until gsStopVoice is called.  Quiet or low priority loops are virtual, so they are cheap to leave on.
+ *
+ * @param sfx The Sound effect to play
+ *
+ * @return The voice it is playing on, or 0 if failed to start
  */
-int gsPlaySfxOneShot(gsSfx *sfx_number, float volume);
+gsVoice gsPlaySfxLooped(gsSfx *sfx, float volume);
+/**
+ * @brief Plays a Sound effect once at a place in the world, it is panned and faded from where the listener is.  If the sound is not loaded, will load the sound
+ *
+ * @return The voice it is playing on, or 0 if failed to start
+ */
+gsVoice gsPlaySfxAt(gsSfx *sfx, float volume, float x, float y, float z);
+/**
+ * @brief Plays a Sound effect on loop at a place in the world until gsStopVoice is called.  Move it with gsSetEmitterPositions.
+ *
+ * @return The voice it is playing on, or 0 if failed to start
+ */
+gsVoice gsPlaySfxLoopedAt(gsSfx *sfx, float volume, float x, float y, float z);
+/**
+ * @brief Plays many sfx at once.  Cheaper than calling gsPlaySfxOneShot for each, and they all start in the same mix.  Unloaded sfx are loaded.
+ *
+ * @param requests The sfx to play and how to play them.
+ * @param count The number of requests.
+ * @param voices If not NULL, filled with the voice for each request, or 0 for the ones that failed to start.
+ *
+ * @return The number of requests that started.
+ */
+int gsPlaySfxBatch(const gsPlayRequest *requests, int count, gsVoice *voices);
+/**
+ * @brief Stops a playing sfx.  The finished callback is not called for it.
+ *
+ * @param voice The voice returned when it was played.
+ *
+ * @return 1 if it was stopped, 0 if the voice already finished.
+ */
+int gsStopVoice(gsVoice voice);
+/**
+ * @brief Plays a Sound effect once, starting on a exact frame of the sound clock instead of whenever the next mix happens.  It is silent until then, and keeps its time if it is virtual while waiting.
+ *
+ * @param frame The frame to start on, from gsGetSoundClock.  A frame already passed starts right away.
+ *
+ * @return The voice it is playing on, or 0 if failed to start
+ */
+gsVoice gsPlaySfxScheduled(gsSfx *sfx, float volume, uint64_t frame);
+/**
+ * @brief Stops a playing sfx on a exact frame of the sound clock.  The finished callback is not called for it, and playing it again cancels the stop.
+ *
+ * @param frame The frame to stop on, from gsGetSoundClock.  A frame already passed stops it on the next mix.
+ *
+ * @return 1 if it was scheduled, 0 if the voice already finished.
+ */
+int gsStopVoiceScheduled(gsVoice voice, uint64_t frame);
+/**
+ * @brief Changes the volume of a playing sfx.
+ *
+ * @return 1 if successful, 0 if the voice already finished.
+ */
+int gsSetVoiceVolume(gsVoice voice, float volume);
+/**
+ * @brief Fades the volume of a playing sfx, the mixer ramps it every sample so long fades don't step.  Setting the volume cancels the fade.
+ *
+ * @param volume The volume to end on.
+ * @param seconds How long the fade takes, 0 sets it right away.
+ * @param stop 1 to stop the sfx when the fade ends, like gsStopVoiceScheduled.
+ *
+ * @return 1 if it is fading, 0 if the voice already finished.
+ */
+int gsFadeVoice(gsVoice voice, float volume, float seconds, int stop);
+/**
+ * @brief Changes the pitch of a playing sfx.  1 is regular pitch, 2 is an octave up.
+ *
+ * @return 1 if successful, 0 if the voice already finished or pitch is not above 0.
+ */
+int gsSetVoicePitch(gsVoice voice, float pitch);
+/**
+ * @brief Pans a playing sfx between the speakers.  Only mono sfx can be panned.
+ *
+ * @param pan -1 is full left, 0 is center, 1 is full right.
+ *
+ * @return 1 if successful, 0 if the voice already finished or is positional.
+ */
+int gsSetVoicePan(gsVoice voice, float pan);
+/**
+ * @brief Moves positional voices, meant to be called once a frame with every emitter that moved.  The mixer is sent every move and the listener together on the next gsUpdateSound, so moving hundreds of voices costs one call into it.
+ *
+ * @param voices The voices to move, stale and non positional voices are skipped.
+ * @param positions Three floats for each voice.
+ * @param count The number of voices.
+ *
+ * @return The number of voices moved, or when queued the number of moves queued.
+ */
+int gsSetEmitterPositions(const gsVoice *voices, const float *positions, int count);
+/**
+ * @brief Marks a voice as blocked from the listener, for games that check line of sight.  Occluded voices are culled like ones out of range, and mixed again from where they would be when cleared.  Streamed sfx go silent instead.
+ *
+ * @return 1 if successful, 0 if the voice already finished.
+ */
+int gsSetVoiceOccluded(gsVoice voice, int occluded);
+/**
+ * @brief Moves the listener that positional voices are heard from, sent with the emitter moves on the next gsUpdateSound.
+ */
+void gsSetListener(const gsListener *listener);
+/**
+ * @brief Checks if a sfx is still playing.
+ *
+ * @return 1 if it is playing, 0 if it finished or was stopped.
+ */
+int gsVoiceIsPlaying(gsVoice voice);
+/**
+ * @brief Checks if a sfx is virtual, playing but not mixed because it is too quiet or lost out to higher priority sounds.
+ *
+ * @return 1 if it is virtual, 0 if it is mixed or finished.
+ */
+int gsVoiceIsVirtual(gsVoice voice);
+/**
+ * @brief Sets how often a sfx can be triggered.  Triggers over the limits return 0 and don't touch the mixer.
+ *
+ * @param sfx The sfx to limit
+ * @param max_instances Most voices of this sfx that can play at once, 0 is no limit.
+ * @param min_retrigger_seconds Ignore triggers closer than this to the last one, 0 is no limit.
+ * @param coalesce If 1, triggers in the same update are added into one voice, with the volume clamped to 1.
+ */
+void gsSetSfxLimits(gsSfx *sfx, int max_instances, float min_retrigger_seconds, int coalesce);
+/**
+ * @brief Sets the most bytes of decoded sfx to keep in memory.  Sfx that aren't playing are evicted right away to fit.
+ *
+ * @param bytes The budget, 0 is no limit.
+ */
+void gsSetPcmBudget(size_t bytes);
+/**
+ * @brief Gets the current memory use and cache counts.
+ *
+ * @param stats Filled with the stats.
+ *
+ * @return 1 if it was filled, 0 if called from another thread in gsCommandMode_Queued.
+ */
+int gsGetSoundStats(gsSoundStats *stats);
+/**
+ * @brief Gets how long the audio callback takes to mix against its deadline, since sound was initialized or the timing was last reset.  Headless, gsRenderSound is timed instead, a period at a time.  Can be called from any thread.
+ *
+ * @param timing Filled with the timing.
+ * @param reset If set, the timing starts over after it is read.
+ *
+ * @return 1 if it was filled, 0 if sound isn't initialized.
+ */
+int gsGetCallbackTiming(gsCallbackTiming *timing, int reset);
 /**
  * @brief Preloads a sfx sound.
  *
@@ -90,11 +459,200 @@ int gsUnloadSfx(gsSfx *);
  * @brief This should be called every frame.  Updates the BGM sound and such.
  */
 void gsUpdateSound(void);
+/**
+ * @brief Mixes the next frames of sound when initialized headless, as interleaved floats in the configured channel count.  Can be called from any thread.
+ *
+ * @param samples Filled with frames * channels samples.
+ * @param frames The frames to mix.
+ *
+ * @return 1 if it mixed, 0 if sound isn't headless.
+ */
+int gsRenderSound(float *samples, int frames);
+/**
+ * @brief Starts a span on this thread's timeline in the profile, so frames can be lined up with the mixer.  Spans nest, and do nothing unless built with GOON_SOUND_PROFILE and profiling.
+ *
+ * @param name Shown on the timeline, it must stay valid until sound is closed.
+ */
+void gsProfileBegin(const char *name);
+/**
+ * @brief Ends the last span started on this thread with gsProfileBegin.
+ */
+void gsProfileEnd(void);
 /**
  * @brief Closes openal and destroys all bgm and sfx.
  */
 void gsCloseSound(void);
+/**
+ * @brief Creates a engine with its own device, players and caches, and makes it current on the calling thread.  Every call works on the calling thread's current engine, and threads that haven't set one use the one made by gsInitializeSound.  Sfx, bgm and stems play only on the engine they were loaded on.
+ *
+ * @param config The device settings to use, NULL for the defaults.
+ *
+ * @return The engine, or NULL if it couldn't be initialized.
+ */
+gsEngine *gsCreateEngine(const gsSoundConfig *config);
+/**
+ * @brief Closes a engine like gsCloseSound does.  Destroying the one made by gsInitializeSound is the same as gsCloseSound.
+ */
+void gsDestroyEngine(gsEngine *engine);
+/**
+ * @brief Sets the engine calls on this thread work on.  Headless engines can each render on their own thread at the same time.
+ *
+ * @param engine The engine, NULL to use the one made by gsInitializeSound.
+ */
+void gsSetCurrentEngine(gsEngine *engine);
+/**
+ * @brief Gets the engine calls on this thread work on.
+ *
+ * @return The engine, NULL if sound isn't initialized.
+ */
+gsEngine *gsGetCurrentEngine(void);
 void gsSetPlayerLoops(int loop);
+/**
+ * @brief Gets where a bgm player is in its song, to seek back to later.
+ *
+ * @param background 1 for the background player.
+ *
+ * @return The position in seconds, -1 if nothing is loaded or called from another thread in gsCommandMode_Queued.
+ */
+double gsBgmTell(int background);
+/**
+ * @brief Moves a bgm player to a position in its song, it keeps playing or stays paused if it was.  Seeks go straight to the right page using an index built in gsPreLoadBgm.
+ *
+ * @param background 1 for the background player.
+ * @param seconds The position, past the loop end wraps to the loop begin.
+ *
+ * @return 1 if it moved, 0 if nothing is loaded or it couldn't seek, which stops it.
+ */
+int gsBgmSeek(int background, double seconds);
+/**
+ * @brief Fades the volume of a bgm player, the mixer ramps it every sample.  Playing a new song cancels the fade, and seeking keeps it going.
+ *
+ * @param background 1 for the background player.
+ * @param volume The volume to end on.
+ * @param seconds How long the fade takes, 0 sets it right away.
+ * @param stop 1 to stop the bgm when the fade ends, like gsStopBgm.
+ *
+ * @return 1 if it is fading, 0 if nothing is loaded.
+ */
+int gsFadeBgm(int background, float volume, float seconds, int stop);
+/**
+ * @brief Makes stems from the files of a song split into layers, to be faded in and out on their own as the game changes.
+ *
+ * @param filenames The ogg files, every one must be the same rate and channels, and they should be the same length.
+ * @param count How many files, up to GS_MAX_STEMS mono stems or half that many stereo stems.
+ *
+ * @return The stems, NULL if count is out of range.
+ */
+gsStems *gsLoadStems(const char *const *filenames, int count);
+void gsUnloadStems(gsStems *stems);
+/**
+ * @brief Opens stems on the stem player, stopping what it was playing.  Every stem starts at gain 1.
+ *
+ * The stems are decoded together and mixed from one buffer, so they stay on the same sample through loops, seeks and pauses.  The loop points come from the first stem.
+ *
+ * @return 1 if they all opened, 0 if one couldn't or they don't match.
+ */
+int gsPreLoadStems(gsStems *stems);
+int gsPlayStems(float volume);
+int gsStopStems(void);
+int gsPauseStems(void);
+int gsUnPauseStems(void);
+/**
+ * @brief Fades a stem of the playing stems, the mixer ramps it a frame at a time so it doesn't click.
+ *
+ * @param stem The index of the stem, in the order its file was given.
+ * @param gain The gain to fade to, 0 is silent and 1 is regular volume.
+ * @param seconds How long the fade takes, 0 changes it right away.
+ *
+ * @return 1 if it was set, 0 if no stems are loaded or there is no such stem.
+ */
+int gsSetStemGain(int stem, float gain, float seconds);
+/**
+ * @brief Gets where the stem player is in its song.
+ *
+ * @return The position in seconds, -1 if nothing is loaded or called from another thread in gsCommandMode_Queued.
+ */
+double gsStemsTell(void);
+/**
+ * @brief Moves every stem to a position in the song together, it keeps playing or stays paused if it was.
+ *
+ * @param seconds The position, past the loop end wraps to the loop begin.
+ *
+ * @return 1 if it moved, 0 if nothing is loaded or it couldn't seek, which stops it.
+ */
+int gsStemsSeek(double seconds);
+/**
+ * @brief Sets a bus's volume.  The mixer applies it once per mix, so it costs the same no matter how many voices are on the bus.
+ *
+ * @param bus The bus, gsBus_Master turns everything down.
+ * @param volume 0 is silent and 1 is regular volume, it multiplies with the volume of the buses above it.
+ *
+ * @return 1 if it was set, 0 if there is no such bus.
+ */
+int gsSetBusVolume(gsBus bus, float volume);
+/**
+ * @brief Silences a bus, what is on it keeps playing so it picks up where it would be when unmuted.  The volume is kept.
+ *
+ * @return 1 if it was set, 0 if there is no such bus.
+ */
+int gsSetBusMuted(gsBus bus, int muted);
+/**
+ * @brief Holds everything on a bus where it is, like pausing all sfx behind a menu.  Voices that are virtual keep time while paused.
+ *
+ * @return 1 if it was set, 0 if there is no such bus.
+ */
+int gsSetBusPaused(gsBus bus, int paused);
+/**
+ * @brief Moves a bus under another one, every bus starts under gsBus_Master.
+ *
+ * @param parent The bus it goes under, it must come before it in the gsBus order so there are no loops.
+ *
+ * @return 1 if it moved, 0 if either bus doesn't exist, bus is gsBus_Master, or parent doesn't come before it.
+ */
+int gsSetBusParent(gsBus bus, gsBus parent);
+/**
+ * @brief Sets a function to be called when a sfx finishes playing.  It is called from gsUpdateSound, and only for sounds that ended on their own.
+ *
+ * @param callback The function to call, or NULL to stop being notified.
+ * @param userdata Passed back to the callback.
+ */
+void gsSetSfxFinishedCallback(gsSfxFinishedCallback callback, void *userdata);
+/**
+ * @brief Sets the allocator everything is allocated with, including the mixer.  Memory is freed by the allocator it came from, so this must be called before sound is initialized and before any sfx or bgm are made.
+ *
+ * @param allocator The functions to use, they are copied.  NULL goes back to malloc and free.
+ *
+ * @return 1 if it was set, 0 if sound is initialized.
+ */
+int gsSetAllocator(const gsAllocator *allocator);
+/**
+ * @brief Creates a arena to make sfx, bgm and stems in.
+ *
+ * @param block_size Bytes to allocate up front, sized to fit a level's sfx files.  When it fills another block at least this big is allocated.
+ *
+ * @return The arena, NULL if it couldn't be allocated.
+ */
+gsArena *gsCreateArena(size_t block_size);
+/**
+ * @brief Makes sfx, bgm and stems made from now on live in a arena, and loading a sfx made in it reads its file into it too.  Set the arena from the thread that makes the sfx and bgm, each engine has its own current arena.
+ *
+ * @param arena The arena to use, NULL to use the allocator again.
+ *
+ * @return The arena that was being used.
+ */
+gsArena *gsSetArena(gsArena *arena);
+/**
+ * @brief Stops and unloads every sfx, bgm and stems made in a arena, and frees their memory at once so the arena can be filled again.  Any pointers to them are invalid after.  In a threaded mode this waits until the sound thread has applied the calls queued before it.
+ *
+ * @return 1 if it was reset, 0 if the command queue is full.
+ */
+int gsResetArena(gsArena *arena);
+/**
+ * @brief Resets a arena and frees it.
+ *
+ * @return 1 if it was destroyed, 0 if the command queue is full.
+ */
+int gsDestroyArena(gsArena *arena);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,107 @@
+#include <SupergoonSound/gnpch.h>
+#include <SupergoonSound/base/allocator.h>
+#include <SupergoonSound/sound/adpcm.h>
+
+static const int index_table[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+static const int step_table[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+	11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+	32767};
+
+/**
+ * @brief The encoder state for one channel, it is the same as what the decoder will have.
+ */
+typedef struct ImaChannel {
+	int predictor;
+	int index;
+} ImaChannel;
+
+/**
+ * @brief Encodes a sample, and steps the state the same way the decoder will.
+ *
+ * @return The 4 bit code.
+ */
+static int EncodeImaSample(ImaChannel *channel, int sample);
+
+size_t ImaAdpcmSize(long frames, int channels) {
+	size_t blocks = (frames + IMA4_BLOCK_FRAMES - 1) / IMA4_BLOCK_FRAMES;
+	return blocks * IMA4_BLOCK_SIZE * channels;
+}
+
+unsigned char *EncodeImaAdpcm(const short *pcm, long frames, int channels, size_t *size) {
+	*size = ImaAdpcmSize(frames, channels);
+	unsigned char *encoded = SoundMalloc(*size ? *size : 1);
+	if (!encoded)
+		return NULL;
+	// The index carries on between blocks, so each block starts already adapted.
+	ImaChannel state[2] = {{0, 0}, {0, 0}};
+	unsigned char *block = encoded;
+	for (long first = 0; first < frames; first += IMA4_BLOCK_FRAMES) {
+		unsigned char *nibbles = block + channels * 4;
+		for (int ch = 0; ch < channels; ++ch) {
+			ImaChannel *channel = &state[ch];
+			// The header holds the first sample exactly.
+			channel->predictor = pcm[first * channels + ch];
+			unsigned char *header = block + ch * 4;
+			header[0] = channel->predictor & 0xFF;
+			header[1] = (channel->predictor >> 8) & 0xFF;
+			header[2] = channel->index;
+			header[3] = 0;
+			for (int i = 0; i < (IMA4_BLOCK_FRAMES - 1) / 8; ++i) {
+				unsigned char *run = nibbles + (i * channels + ch) * 4;
+				for (int j = 0; j < 8; ++j) {
+					long frame = first + 1 + i * 8 + j;
+					int sample = frame < frames ? pcm[frame * channels + ch] : 0;
+					int nibble = EncodeImaSample(channel, sample);
+					if (j & 1)
+						run[j >> 1] |= nibble << 4;
+					else
+						run[j >> 1] = nibble;
+				}
+			}
+		}
+		block += IMA4_BLOCK_SIZE * channels;
+	}
+	return encoded;
+}
+
+static int EncodeImaSample(ImaChannel *channel, int sample) {
+	int step = step_table[channel->index];
+	int diff = sample - channel->predictor;
+	int nibble = 0;
+	if (diff < 0) {
+		nibble = 8;
+		diff = -diff;
+	}
+	// Same steps as the decoder, so rounding doesn't drift between them.
+	int delta = step >> 3;
+	if (diff >= step) {
+		nibble |= 4;
+		diff -= step;
+		delta += step;
+	}
+	if (diff >= step >> 1) {
+		nibble |= 2;
+		diff -= step >> 1;
+		delta += step >> 1;
+	}
+	if (diff >= step >> 2) {
+		nibble |= 1;
+		delta += step >> 2;
+	}
+	channel->predictor += (nibble & 8) ? -delta : delta;
+	if (channel->predictor > 32767)
+		channel->predictor = 32767;
+	else if (channel->predictor < -32768)
+		channel->predictor = -32768;
+	channel->index += index_table[nibble & 7];
+	if (channel->index < 0)
+		channel->index = 0;
+	else if (channel->index > 88)
+		channel->index = 88;
+	return nibble;
+}
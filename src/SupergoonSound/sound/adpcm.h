@@ -0,0 +1,33 @@
+/**
+ * @file adpcm.h
+ * @brief Encodes 16 bit pcm to IMA ADPCM in the AL_EXT_IMA4 block layout, so sfx can stay compressed in the mixer.
+ * @author Kevin Blanchard
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#pragma once
+#include <stddef.h>
+
+#define IMA4_BLOCK_FRAMES 65  // Sample frames in each block.
+#define IMA4_BLOCK_SIZE 36	  // Bytes in each block, per channel.
+
+/**
+ * @brief Gets the encoded size of some pcm.
+ *
+ * @param frames The length in sample frames.
+ * @param channels 1 or 2.
+ *
+ * @return The size in bytes, the last block is padded with silence.
+ */
+size_t ImaAdpcmSize(long frames, int channels);
+/**
+ * @brief Encodes interleaved 16 bit pcm to IMA ADPCM blocks.
+ *
+ * @param pcm The samples to encode.
+ * @param frames The length in sample frames.
+ * @param channels 1 or 2.
+ * @param size Set to the encoded size.
+ *
+ * @return The encoded data, free it when done.  NULL if it couldn't be allocated.
+ */
+unsigned char *EncodeImaAdpcm(const short *pcm, long frames, int channels, size_t *size);
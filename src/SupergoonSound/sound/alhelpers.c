@@ -32,29 +32,20 @@
 #include <errno.h>
 #include <AL/al.h>
 #include <AL/alc.h>
+#include <AL/alext.h>
 
 
 
-/* InitAL opens a device and sets up a context using default attributes, making
- * the program ready to call OpenAL functions. */
-int InitAL(void)
+/* InitContext sets up a context on an opened device using the given
+ * attributes, closing the device if it fails. The context is only made
+ * current on this thread, so other threads can have their own. */
+static int InitContext(ALCdevice *device, const ALCint *attrlist)
 {
     const ALCchar *name;
-    ALCdevice *device;
     ALCcontext *ctx;
 
-    /* Open and initialize a device */
-    device = NULL;
-    if(!device)
-        device = alcOpenDevice(NULL);
-    if(!device)
-    {
-        fprintf(stderr, "Could not open a device!\n");
-        return 1;
-    }
-
-    ctx = alcCreateContext(device, NULL);
-    if(ctx == NULL || alcMakeContextCurrent(ctx) == ALC_FALSE)
+    ctx = alcCreateContext(device, attrlist);
+    if(ctx == NULL || alcSetThreadContext(ctx) == ALC_FALSE)
     {
         if(ctx != NULL)
             alcDestroyContext(ctx);
@@ -73,6 +64,47 @@ int InitAL(void)
     return 0;
 }
 
+/* InitAL opens a device and sets up a context using the given attributes (or
+ * the defaults if NULL), making the program ready to call OpenAL functions. */
+int InitAL(const ALCint *attrlist)
+{
+    ALCdevice *device;
+
+    /* Open and initialize a device */
+    device = NULL;
+    if(!device)
+        device = alcOpenDevice(NULL);
+    if(!device)
+    {
+        fprintf(stderr, "Could not open a device!\n");
+        return 1;
+    }
+
+    return InitContext(device, attrlist);
+}
+
+/* InitLoopbackAL opens a loopback device instead, nothing is played and the
+ * program pulls the mix with alcRenderSamplesSOFT. */
+int InitLoopbackAL(const ALCint *attrlist)
+{
+    ALCdevice *device;
+
+    if(!alcIsExtensionPresent(NULL, "ALC_SOFT_loopback"))
+    {
+        fprintf(stderr, "Loopback devices are not supported!\n");
+        return 1;
+    }
+
+    device = alcLoopbackOpenDeviceSOFT(NULL);
+    if(!device)
+    {
+        fprintf(stderr, "Could not open a loopback device!\n");
+        return 1;
+    }
+
+    return InitContext(device, attrlist);
+}
+
 /* CloseAL closes the device belonging to the current context, and destroys the
  * context. */
 void CloseAL(void)
@@ -86,7 +118,9 @@ void CloseAL(void)
 
     device = alcGetContextsDevice(ctx);
 
-    alcMakeContextCurrent(NULL);
+    alcSetThreadContext(NULL);
+    if(alcGetCurrentContext() == ctx)
+        alcMakeContextCurrent(NULL);
     alcDestroyContext(ctx);
     alcCloseDevice(device);
 }
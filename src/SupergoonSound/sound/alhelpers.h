@@ -2,6 +2,7 @@
 #define ALHELPERS_H
 
 #include <AL/al.h>
+#include <AL/alc.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -10,8 +11,12 @@ extern "C" {
 /* Some helper functions to get the name from the format enums. */
 const char *FormatName(ALenum type);
 
-/* Easy device init/deinit functions. InitAL returns 0 on success. */
-int InitAL(void);
+/* Easy device init/deinit functions. InitAL returns 0 on success, attrlist is
+ * passed through to alcCreateContext and may be NULL. */
+int InitAL(const ALCint *attrlist);
+/* InitLoopbackAL is the same, but opens a ALC_SOFT_loopback device that plays
+ * nothing and is mixed by calling alcRenderSamplesSOFT. */
+int InitLoopbackAL(const ALCint *attrlist);
 void CloseAL(void);
 
 /* Cross-platform timeget and sleep functions. */
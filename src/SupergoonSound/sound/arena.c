@@ -0,0 +1,215 @@
+#include <SupergoonSound/gnpch.h>
+#include <SupergoonSound/base/allocator.h>
+#include <SupergoonSound/sound/arena.h>
+#include <SupergoonSound/sound/engine.h>
+
+#define ARENA_ALIGNMENT 16
+
+/**
+ * @brief A chunk of arena memory, the allocations follow the header.
+ */
+typedef struct ArenaBlock {
+	struct ArenaBlock *next;
+	unsigned char *data;
+	size_t size;
+	size_t used;
+} ArenaBlock;
+
+/**
+ * @brief Put before every AssetMalloc allocation, so freeing and unloading it don't have to search the arenas.
+ */
+typedef union AssetHeader {
+	struct {
+		// NULL if it came from the allocator.
+		gsArena *arena;
+		// Its entry in the arena's assets, NULL if it isn't a asset.
+		ArenaAsset *entry;
+	};
+	// Keeps the memory after it aligned like the rest of the arena.
+	unsigned char align[ARENA_ALIGNMENT];
+} AssetHeader;
+
+struct gsArena {
+	// Newest first, the first block is last and is kept on reset.
+	ArenaBlock *blocks;
+	size_t block_size;
+	ArenaAsset *assets;
+	struct gsArena *next;
+};
+
+/**
+ * @brief Guards every arena, allocations only happen while loading so one lock is plenty.
+ */
+static SDL_mutex *arenas_lock = NULL;
+static gsArena *arenas = NULL;
+/**
+ * @brief The current arena while there is no engine, each engine has its own after that.
+ */
+static gsArena *loose_arena = NULL;
+
+/**
+ * @brief Allocates a block with room for at least size bytes after aligning.
+ */
+static ArenaBlock *NewArenaBlock(size_t size);
+/**
+ * @brief Allocates from a arena, arenas_lock must be held.
+ */
+static void *ArenaMallocLocked(gsArena *arena, size_t size);
+
+gsArena *CreateArena(size_t block_size) {
+	if (!arenas_lock)
+		arenas_lock = SDL_CreateMutex();
+	gsArena *arena = SoundCalloc(1, sizeof(*arena));
+	if (!arena)
+		return NULL;
+	arena->block_size = block_size ? block_size : 1;
+	arena->blocks = NewArenaBlock(arena->block_size);
+	if (!arena->blocks) {
+		SoundFree(arena);
+		return NULL;
+	}
+	SDL_LockMutex(arenas_lock);
+	arena->next = arenas;
+	arenas = arena;
+	SDL_UnlockMutex(arenas_lock);
+	return arena;
+}
+
+void DestroyArena(gsArena *arena) {
+	if (!arena)
+		return;
+	SDL_LockMutex(arenas_lock);
+	for (gsArena **link = &arenas; *link; link = &(*link)->next) {
+		if (*link == arena) {
+			*link = arena->next;
+			break;
+		}
+	}
+	gsEngine *engine = CurrentEngine();
+	if (engine && engine->current_arena == arena)
+		engine->current_arena = NULL;
+	if (loose_arena == arena)
+		loose_arena = NULL;
+	SDL_UnlockMutex(arenas_lock);
+	while (arena->blocks) {
+		ArenaBlock *next = arena->blocks->next;
+		SoundFree(arena->blocks);
+		arena->blocks = next;
+	}
+	SoundFree(arena);
+}
+
+void ResetArena(gsArena *arena) {
+	SDL_LockMutex(arenas_lock);
+	while (arena->blocks->next) {
+		ArenaBlock *next = arena->blocks->next;
+		SoundFree(arena->blocks);
+		arena->blocks = next;
+	}
+	arena->blocks->used = 0;
+	arena->assets = NULL;
+	SDL_UnlockMutex(arenas_lock);
+}
+
+void *ArenaMalloc(gsArena *arena, size_t size) {
+	SDL_LockMutex(arenas_lock);
+	void *ptr = ArenaMallocLocked(arena, size);
+	SDL_UnlockMutex(arenas_lock);
+	return ptr;
+}
+
+static void *ArenaMallocLocked(gsArena *arena, size_t size) {
+	size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+	ArenaBlock *block = arena->blocks;
+	if (block->size - block->used < size) {
+		// The newest block is the only one with room worth using, what is left in the old one is wasted until reset.
+		block = NewArenaBlock(size > arena->block_size ? size : arena->block_size);
+		if (!block)
+			return NULL;
+		block->next = arena->blocks;
+		arena->blocks = block;
+	}
+	void *ptr = block->data + block->used;
+	block->used += size;
+	return ptr;
+}
+
+static ArenaBlock *NewArenaBlock(size_t size) {
+	size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+	// The allocator may only align to 8, so leave room to align the data.
+	ArenaBlock *block = SoundMalloc(sizeof(*block) + ARENA_ALIGNMENT - 1 + size);
+	if (!block)
+		return NULL;
+	uintptr_t data = (uintptr_t)(block + 1);
+	block->data = (unsigned char *)((data + ARENA_ALIGNMENT - 1) & ~(uintptr_t)(ARENA_ALIGNMENT - 1));
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	return block;
+}
+
+gsArena *AssetArena(const void *ptr) {
+	if (!ptr)
+		return NULL;
+	return ((const AssetHeader *)ptr - 1)->arena;
+}
+
+void SetCurrentArena(gsArena *arena) {
+	gsEngine *engine = CurrentEngine();
+	if (engine)
+		engine->current_arena = arena;
+	else
+		loose_arena = arena;
+}
+
+gsArena *CurrentArena(void) {
+	gsEngine *engine = CurrentEngine();
+	return engine ? engine->current_arena : loose_arena;
+}
+
+void *AssetMalloc(gsArena *arena, size_t size) {
+	AssetHeader *header = arena ? ArenaMalloc(arena, sizeof(*header) + size) : SoundMalloc(sizeof(*header) + size);
+	if (!header)
+		return NULL;
+	header->arena = arena;
+	header->entry = NULL;
+	return header + 1;
+}
+
+void AssetFree(void *ptr) {
+	if (!ptr)
+		return;
+	AssetHeader *header = (AssetHeader *)ptr - 1;
+	if (!header->arena)
+		SoundFree(header);
+}
+
+int ArenaAddAsset(gsArena *arena, void *asset, ArenaAssetKind kind) {
+	SDL_LockMutex(arenas_lock);
+	ArenaAsset *entry = ArenaMallocLocked(arena, sizeof(*entry));
+	if (entry) {
+		entry->asset = asset;
+		entry->kind = kind;
+		entry->next = arena->assets;
+		arena->assets = entry;
+		((AssetHeader *)asset - 1)->entry = entry;
+	}
+	SDL_UnlockMutex(arenas_lock);
+	return entry != NULL;
+}
+
+void ArenaRemoveAsset(const void *asset) {
+	if (!asset)
+		return;
+	AssetHeader *header = (AssetHeader *)asset - 1;
+	if (!header->entry)
+		return;
+	SDL_LockMutex(arenas_lock);
+	header->entry->asset = NULL;
+	header->entry = NULL;
+	SDL_UnlockMutex(arenas_lock);
+}
+
+ArenaAsset *ArenaAssets(gsArena *arena) {
+	return arena->assets;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file arena.h
+ * @brief Arenas that sfx and bgm for a level are allocated from, so they are all freed together with one reset.
+ * @author Kevin Blanchard
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * While a arena is current, gsNewSfx and gsLoadBgm allocate from it, and loading a sfx that lives in a arena puts its
+ * file there too.  The arena remembers the sfx, bgm and stems made in it, so a reset can unload them before the memory is
+ * reused.  Arena memory is handed out in blocks from the allocator, and freeing memory that is in a arena does nothing.
+ * AssetMalloc puts a small header before each allocation with its arena and asset entry, so freeing and unloading
+ * assets doesn't search, and releasing a arena full of them stays linear.
+ */
+#pragma once
+#include <SupergoonSound/include/sound.h>
+
+typedef enum ArenaAssetKind {
+	ArenaAsset_Sfx,
+	ArenaAsset_Bgm,
+	ArenaAsset_Stems,
+} ArenaAssetKind;
+
+/**
+ * @brief A sfx, bgm or stems made while the arena was current.
+ */
+typedef struct ArenaAsset {
+	// NULL once it has been unloaded on its own.
+	void *asset;
+	ArenaAssetKind kind;
+	struct ArenaAsset *next;
+} ArenaAsset;
+
+/**
+ * @brief Creates a empty arena.
+ *
+ * @param block_size The size of the first block, later blocks are at least this big.
+ *
+ * @return The arena, NULL if the first block couldn't be allocated.
+ */
+gsArena *CreateArena(size_t block_size);
+/**
+ * @brief Frees every block, its assets must have been unloaded already.
+ */
+void DestroyArena(gsArena *arena);
+/**
+ * @brief Forgets every allocation and asset, keeping the first block for the next level.
+ */
+void ResetArena(gsArena *arena);
+/**
+ * @brief Allocates from a arena, aligned to 16 bytes.  Safe to call from any thread.
+ *
+ * @return The memory, NULL if a new block was needed and couldn't be allocated.
+ */
+void *ArenaMalloc(gsArena *arena, size_t size);
+/**
+ * @brief Gets the arena memory from AssetMalloc was allocated from.
+ *
+ * @return The arena, NULL if it came from the allocator.
+ */
+gsArena *AssetArena(const void *ptr);
+void SetCurrentArena(gsArena *arena);
+gsArena *CurrentArena(void);
+/**
+ * @brief Allocates from a arena if there is one, otherwise from the allocator.
+ */
+void *AssetMalloc(gsArena *arena, size_t size);
+/**
+ * @brief Frees memory from AssetMalloc, memory in a arena is left for the reset.
+ */
+void AssetFree(void *ptr);
+/**
+ * @brief Remembers a sfx, bgm or stems made in a arena, so a reset can unload it.  The asset must be from AssetMalloc on that arena.
+ *
+ * @return 1 if it is remembered, 0 if there was no room.
+ */
+int ArenaAddAsset(gsArena *arena, void *asset, ArenaAssetKind kind);
+/**
+ * @brief Forgets a asset that is being unloaded on its own, does nothing if it isn't in a arena.
+ */
+void ArenaRemoveAsset(const void *asset);
+/**
+ * @brief Gets the assets made in a arena, newest first.
+ */
+ArenaAsset *ArenaAssets(gsArena *arena);
@@ -0,0 +1,80 @@
+#include <SupergoonSound/gnpch.h>
+#include <SupergoonSound/base/allocator.h>
+#include <SupergoonSound/sound/commands.h>
+
+/**
+ * @brief Each slot has a sequence number, that says if it is ready to be written or read for the current lap of the ring.
+ */
+typedef struct SoundCommandSlot {
+	SDL_atomic_t sequence;
+	SoundCommand command;
+} SoundCommandSlot;
+
+struct SoundCommandQueue {
+	SoundCommandSlot *slots;
+	int mask;
+	// Claimed by producers with a CAS.
+	SDL_atomic_t enqueue_pos;
+	// Only touched by the consumer.
+	int dequeue_pos;
+};
+
+SoundCommandQueue *CreateSoundCommandQueue(int capacity) {
+	assert(capacity > 0 && (capacity & (capacity - 1)) == 0 && "Command queue capacity must be a power of two");
+	SoundCommandQueue *queue = SoundCalloc(1, sizeof(*queue));
+	queue->slots = SoundCalloc(capacity, sizeof(SoundCommandSlot));
+	queue->mask = capacity - 1;
+	for (int i = 0; i < capacity; ++i) {
+		SDL_AtomicSet(&queue->slots[i].sequence, i);
+	}
+	SDL_AtomicSet(&queue->enqueue_pos, 0);
+	return queue;
+}
+
+void DestroySoundCommandQueue(SoundCommandQueue *queue) {
+	if (!queue)
+		return;
+	SoundFree(queue->slots);
+	SoundFree(queue);
+}
+
+int PushSoundCommand(SoundCommandQueue *queue, const SoundCommand *command) {
+	int pos = SDL_AtomicGet(&queue->enqueue_pos);
+	for (;;) {
+		SoundCommandSlot *slot = &queue->slots[pos & queue->mask];
+		// Unsigned so the positions can wrap.
+		int diff = (int)((unsigned int)SDL_AtomicGet(&slot->sequence) - (unsigned int)pos);
+		if (diff == 0) {
+			if (SDL_AtomicCAS(&queue->enqueue_pos, pos, (int)((unsigned int)pos + 1))) {
+				slot->command = *command;
+				// The command has to be written before the consumer can see the slot is full.
+				SDL_MemoryBarrierRelease();
+				SDL_AtomicSet(&slot->sequence, (int)((unsigned int)pos + 1));
+				return 1;
+			}
+			pos = SDL_AtomicGet(&queue->enqueue_pos);
+		} else if (diff < 0) {
+			// The consumer hasn't freed this slot from the last lap yet.
+			return 0;
+		} else {
+			// Another producer claimed it first.
+			pos = SDL_AtomicGet(&queue->enqueue_pos);
+		}
+	}
+}
+
+int PopSoundCommand(SoundCommandQueue *queue, SoundCommand *command) {
+	int pos = queue->dequeue_pos;
+	SoundCommandSlot *slot = &queue->slots[pos & queue->mask];
+	int diff = (int)((unsigned int)SDL_AtomicGet(&slot->sequence) - ((unsigned int)pos + 1));
+	if (diff < 0)
+		return 0;
+	// Don't read the command until after seeing the slot is full.
+	SDL_MemoryBarrierAcquire();
+	*command = slot->command;
+	// And finish reading it before a producer can reuse the slot.
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&slot->sequence, (int)((unsigned int)pos + queue->mask + 1));
+	queue->dequeue_pos = (int)((unsigned int)pos + 1);
+	return 1;
+}
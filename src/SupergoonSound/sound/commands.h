@@ -0,0 +1,158 @@
+/**
+ * @file commands.h
+ * @brief Lock free queue of sound calls made on other threads, to be applied on the thread that owns the sound state.
+ * @author Kevin Blanchard
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#pragma once
+#include <SupergoonSound/include/sound.h>
+
+typedef enum SoundCommandType {
+	SoundCommand_PlaySfx,
+	SoundCommand_StopVoice,
+	SoundCommand_SetVoiceVolume,
+	SoundCommand_SetVoicePitch,
+	SoundCommand_SetVoicePan,
+	SoundCommand_LoadSfx,
+	SoundCommand_UnloadSfx,
+	SoundCommand_SetSfxLimits,
+	SoundCommand_PreLoadBgm,
+	SoundCommand_PlayBgm,
+	SoundCommand_PlayBackgroundBgm,
+	SoundCommand_StopBgm,
+	SoundCommand_StopBackgroundBgm,
+	SoundCommand_PauseBgm,
+	SoundCommand_UnPauseBgm,
+	SoundCommand_SetPlayerLoops,
+	SoundCommand_SetSfxFinishedCallback,
+	SoundCommand_SetPcmBudget,
+	SoundCommand_BgmSeek,
+	SoundCommand_SetEmitterPosition,
+	SoundCommand_SetListener,
+	SoundCommand_SetVoiceOccluded,
+	SoundCommand_ReleaseArena,
+	SoundCommand_PreLoadStems,
+	SoundCommand_PlayStems,
+	SoundCommand_StopStems,
+	SoundCommand_PauseStems,
+	SoundCommand_UnPauseStems,
+	SoundCommand_SetStemGain,
+	SoundCommand_StemsSeek,
+	SoundCommand_StopVoiceScheduled,
+	SoundCommand_PlayBgmScheduled,
+	SoundCommand_SetBusVolume,
+	SoundCommand_SetBusMuted,
+	SoundCommand_SetBusPaused,
+	SoundCommand_SetBusParent,
+	SoundCommand_FadeVoice,
+	SoundCommand_FadeBgm,
+} SoundCommandType;
+
+/**
+ * @brief A public sound call and its arguments.
+ */
+typedef struct SoundCommand {
+	SoundCommandType type;
+	union {
+		gsPlayRequest play;
+		struct {
+			gsVoice voice;
+			float value;
+		} voice;
+		struct {
+			gsSfx *sfx;
+			int max_instances;
+			float min_retrigger_seconds;
+			int coalesce;
+		} limits;
+		struct {
+			gsBgm *bgm;
+			int background;
+		} bgm;
+		struct {
+			gsSfxFinishedCallback callback;
+			void *userdata;
+		} callback;
+		struct {
+			int background;
+			double seconds;
+		} seek;
+		struct {
+			gsVoice voice;
+			float position[3];
+		} emitter;
+		gsListener listener;
+		struct {
+			gsVoice voice;
+			int occluded;
+		} occlusion;
+		struct {
+			gsArena *arena;
+			int destroy;
+			// Posted once it is released, the caller waits on it.
+			SDL_sem *done;
+		} arena;
+		struct {
+			int stem;
+			float gain;
+			float seconds;
+		} stem_gain;
+		struct {
+			gsVoice voice;
+			float volume;
+			uint64_t frame;
+		} scheduled;
+		struct {
+			gsBus bus;
+			float volume;
+			// The flag or parent bus.
+			int value;
+		} bus;
+		struct {
+			gsVoice voice;
+			int background;
+			float volume;
+			float seconds;
+			int stop;
+		} fade;
+		gsStems *stems;
+		double seconds;
+		gsSfx *sfx;
+		float volume;
+		int loops;
+		size_t bytes;
+	};
+} SoundCommand;
+
+/**
+ * @brief Fixed size queue that any number of threads can push to, and one thread pops from.
+ */
+typedef struct SoundCommandQueue SoundCommandQueue;
+
+/**
+ * @brief Creates a command queue.
+ *
+ * @param capacity The most commands that can be waiting, must be a power of two.
+ *
+ * @return A new empty queue.
+ */
+SoundCommandQueue *CreateSoundCommandQueue(int capacity);
+/**
+ * @brief Destroys a command queue, any waiting commands are dropped.
+ */
+void DestroySoundCommandQueue(SoundCommandQueue *queue);
+/**
+ * @brief Adds a command, safe to call from any thread without locking.
+ *
+ * @return 1 if it was added, 0 if the queue is full.
+ */
+int PushSoundCommand(SoundCommandQueue *queue, const SoundCommand *command);
+/**
+ * @brief Takes the oldest command, must only be called from one thread at a time.
+ *
+ * @param command Filled with the command.
+ *
+ * @return 1 if there was a command, 0 if the queue is empty.
+ */
+int PopSoundCommand(SoundCommandQueue *queue, SoundCommand *command);
@@ -0,0 +1,40 @@
+#include <SupergoonSound/gnpch.h>
+#include <AL/alext.h>
+#include <SupergoonSound/sound/engine.h>
+
+static gsEngine *default_engine = NULL;
+/**
+ * @brief The engine bound to each thread, created the first time one is bound.
+ */
+static SDL_TLSID engine_tls = 0;
+static SDL_SpinLock engine_tls_lock = 0;
+
+gsEngine *CurrentEngine(void) {
+	gsEngine *engine = BoundEngine();
+	return engine ? engine : default_engine;
+}
+
+gsEngine *BoundEngine(void) {
+	return engine_tls ? SDL_TLSGet(engine_tls) : NULL;
+}
+
+void BindEngine(gsEngine *engine) {
+	if (!engine_tls) {
+		SDL_AtomicLock(&engine_tls_lock);
+		if (!engine_tls)
+			engine_tls = SDL_TLSCreate();
+		SDL_AtomicUnlock(&engine_tls_lock);
+	}
+	SDL_TLSSet(engine_tls, engine, NULL);
+	// Without one the thread falls back to the default engine's context, which is current for the process.
+	alcSetThreadContext(engine ? engine->context : NULL);
+}
+
+void SetDefaultEngine(gsEngine *engine) {
+	default_engine = engine;
+	alcMakeContextCurrent(engine ? engine->context : NULL);
+}
+
+gsEngine *DefaultEngine(void) {
+	return default_engine;
+}
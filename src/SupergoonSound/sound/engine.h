@@ -0,0 +1,64 @@
+/**
+ * @file engine.h
+ * @brief A engine is a device and everything playing on it, so a process can run more than one.
+ * @author Kevin Blanchard
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * Every sound call works on the calling thread's current engine.  That is the one set with gsSetCurrentEngine, or the
+ * default engine made by gsInitializeSound on threads that haven't set one.  The mixer's context follows the engine, so
+ * AL calls made while a engine is bound go to its device.  Sfx, bgm and stems are loaded into a engine and only play
+ * on it.
+ */
+#pragma once
+#include <AL/al.h>
+#include <AL/alc.h>
+#include <SupergoonSound/include/sound.h>
+#include <SupergoonSound/sound/commands.h>
+
+struct AlEngine;
+struct TraceWriter;
+
+struct gsEngine {
+	ALCcontext *context;
+	// The players, voices and caches, owned by openal.c.
+	struct AlEngine *al;
+	// Where this engine's calls are recorded, NULL if they aren't.
+	struct TraceWriter *trace;
+	gsArena *current_arena;
+	// If the profile was opened by this engine, so it is closed with it.
+	int profiling;
+	gsCommandMode command_mode;
+	// The thread that owns the sound state, calls from any other thread are queued when not in direct mode.
+	SDL_threadID owner_thread;
+	SoundCommandQueue *command_queue;
+	SDL_Thread *thread;
+	// Posted when commands are queued so the sound thread applies them right away, and once at start so it knows its id is set.
+	SDL_sem *thread_wake;
+	SDL_sem *thread_start;
+	SDL_atomic_t thread_quit;
+	// Held by the sound thread while it is changing the sound state, so queries from other threads see it whole.
+	SDL_mutex *state_lock;
+};
+
+/**
+ * @brief Gets the engine calls on this thread work on.
+ *
+ * @return The engine bound to this thread, or the default engine, NULL if there is neither.
+ */
+gsEngine *CurrentEngine(void);
+/**
+ * @brief Gets the engine bound to this thread, without falling back to the default.
+ */
+gsEngine *BoundEngine(void);
+/**
+ * @brief Binds a engine to this thread, and makes its context current on it.
+ *
+ * @param engine The engine, NULL to go back to the default.
+ */
+void BindEngine(gsEngine *engine);
+/**
+ * @brief Sets the engine used on threads that haven't bound one, and makes its context current for the process.
+ */
+void SetDefaultEngine(gsEngine *engine);
+gsEngine *DefaultEngine(void);
@@ -19,19 +19,79 @@
 #endif
 #include <AL/al.h>
 #include <AL/alc.h>
+#include <AL/alext.h>
+#include <SupergoonSound/base/allocator.h>
+#include <SupergoonSound/base/slotmap.h>
 #include <SupergoonSound/base/stack.h>
-#include <SupergoonSound/base/vector.h>
 #include <SupergoonSound/gnpch.h>
+#include <SupergoonSound/sound/adpcm.h>
 #include <SupergoonSound/sound/alhelpers.h>
+#include <SupergoonSound/sound/arena.h>
+#include <SupergoonSound/sound/engine.h>
 #include <SupergoonSound/sound/openal.h>
+#include <SupergoonSound/sound/profile.h>
+#include <float.h>
+#include <math.h>
 #include <vorbis/vorbisfile.h>
 
+// The limits can be set from the build, see GOON_SOUND_MAX_SOURCES and GOON_SOUND_MAX_VOICES.
+#ifndef BGM_NUM_BUFFERS
 #define BGM_NUM_BUFFERS 4
+#endif
+#ifndef BGM_BUFFER_SAMPLES
 #define BGM_BUFFER_SAMPLES 8192	 // 8kb
-#define MAX_SFX_SOUNDS 10
+#endif
+#ifndef MAX_SFX_SOUNDS
+#define MAX_SFX_SOUNDS 10  // Real sources that sfx can be mixed on.
+#endif
+#ifndef MAX_SFX_VOICES
+#define MAX_SFX_VOICES 128	// Sfx voices that can be playing, real or virtual.
+#endif
+#if MAX_SFX_VOICES > 65536
+#error "MAX_SFX_VOICES can't be over 65536, voices keep their slot in 16 bits"
+#endif
+#if GS_MAX_BUSES > AL_MAX_BUSES_SG
+#error "GS_MAX_BUSES can't be over the mixer's AL_MAX_BUSES_SG"
+#endif
+#define SFX_CULL_GAIN 0.001f	  // Default for voices too quiet to need a source.
+#define SFX_STREAM_PLAYERS 4		  // Long sfx that can stream at once.
+#define SFX_STREAM_SECONDS 10.0f	  // Default length where sfx start streaming instead of fully decoding.
 #define VORBIS_REQUEST_SIZE 4096  // Max size to request from vorbis to load.
+#define SOURCE_EVENT_BATCH 64	  // How many mixer events to drain per call.
 
-static int music_ended = 0;
+/**
+ * @brief The decoded sfx, newest played first, so the oldest ones that aren't playing can be evicted to stay in the budget.
+ */
+typedef struct PcmCache {
+	Sg_Loaded_Sfx *newest;
+	Sg_Loaded_Sfx *oldest;
+	// 0 is no limit.
+	size_t budget;
+	gsSoundStats stats;
+} PcmCache;
+/**
+ * @brief A compressed file in memory that vorbis reads from.
+ */
+typedef struct OggMemory {
+	const unsigned char *data;
+	size_t size;
+	size_t position;
+} OggMemory;
+/**
+ * @brief The stems after the first of a stem song, decoded in lockstep with the player's own file and interleaved after it.
+ */
+typedef struct StemFiles {
+	// Stems after the first, the player's vbfile is the first.
+	int count;
+	OggVorbis_File files[GS_MAX_STEMS - 1];
+	OggPageIndex page_indexes[GS_MAX_STEMS - 1];
+	// The gain each stem is at or ramping to, including the first.
+	ALfloat gains[GS_MAX_STEMS];
+	// One stem's data, read to the same length as membuf.
+	short *scratch;
+	// Every stem interleaved frame by frame, what the mixer is given.
+	short *block;
+} StemFiles;
 /**
  * @brief The BGM streaming player.  Probably only need one of these at any time
  *
@@ -47,17 +107,86 @@ typedef struct StreamPlayer {
 	short *membuf;
 	ALenum format;
 	unsigned short file_loaded;
+	// Set when the file was read to the end and there are no loops left.
+	unsigned short ended;
 	uint8_t loops;
+	// The frame each queued buffer starts at, oldest_buffer is the one playing.
+	ogg_int64_t buffer_starts[BGM_NUM_BUFFERS];
+	int oldest_buffer;
+	// Pages of the file, only built for the bgm players so they can seek.
+	OggPageIndex page_index;
+	// Only the stem player has these, NULL for everything else.
+	StemFiles *stems;
+	// Set while a fade will stop it, so the update closes it instead of restarting it.
+	unsigned short fade_stop;
 } StreamPlayer;
 
+/**
+ * @brief A playing sfx.  It is real when it has a source to mix on, and virtual when it only keeps time until it gets one.
+ */
+typedef struct SfxVoice {
+	gsSfx *sfx;
+	float gain;
+	float pitch;
+	float pan;
+	int priority;
+	int looping;
+	// If it is placed at position in the world instead of panned.
+	int positional;
+	float position[3];
+	// Culled while set, as if it was out of range.
+	int occluded;
+	// Gain after distance fading, occlusion and its buses, what voices are ranked and culled by.
+	float audible_gain;
+	// The source this is mixed on, -1 while virtual.
+	int source_num;
+	// The stream player this plays on, -1 if it isn't streamed.  Streamed voices are never virtual.
+	int stream_num;
+	// The index in the virtual voice list, -1 while real.
+	int virtual_num;
+	// While virtual, the sample frame that playback was at on device frame virtual_since.
+	Sint64 virtual_offset;
+	Uint64 virtual_since;
+	// Set while virtual on a paused bus, time stands still for it at virtual_offset like it does in the mixer.
+	int bus_paused;
+	// The device frame it starts on, 0 once it has started or if it started right away.
+	Uint64 start_frame;
+	// The device frame it stops on, if stop_scheduled is set.
+	Uint64 stop_frame;
+	int stop_scheduled;
+	// A fade from fade_from to gain, over fade_frames device frames from fade_start.  The mixer ramps it, this keeps
+	// where it is for culling and for sources that start partway through.
+	float fade_from;
+	Uint64 fade_start;
+	Uint64 fade_frames;
+} SfxVoice;
+
 /**
  * @brief The Sfx player that is used to handle playing sfx
  */
 typedef struct SfxPlayer {
-	ALuint buffers[MAX_SFX_SOUNDS];
 	ALuint sources[MAX_SFX_SOUNDS];
-	vector *playing_buffers_vector;
-	Stack *free_buffers_stack;
+	// The voice mixed on each source, -1 when the source is free.
+	int source_voices[MAX_SFX_SOUNDS];
+	Stack *free_sources_stack;
+	SfxVoice voices[MAX_SFX_VOICES];
+	// One slot per voice, the slot handles are the gsVoices given out when playing.
+	SlotMap *voice_slots;
+	// Voices without a source, so that updates only look at these.
+	int virtual_voices[MAX_SFX_VOICES];
+	int num_virtual_voices;
+	// Sources set up by RealizeSfxVoice, that FlushSfxStarts sends to the mixer together.
+	ALsourceStartSG pending_starts[MAX_SFX_SOUNDS];
+	int num_pending_starts;
+	// The pending start for each source, -1 when it has none.
+	int source_pending[MAX_SFX_SOUNDS];
+	// Long sfx play through these, each with a small buffer queue instead of the whole decoded file.
+	StreamPlayer *streams[SFX_STREAM_PLAYERS];
+	// The voice on each stream, -1 when the stream is free.
+	int stream_voices[SFX_STREAM_PLAYERS];
+	// Sources and streams whose voice moved since the last update, FlushSfxMoves sends them to the mixer together.
+	unsigned char source_moved[MAX_SFX_SOUNDS];
+	unsigned char stream_moved[SFX_STREAM_PLAYERS];
 
 } SfxPlayer;
 /**
@@ -82,17 +211,48 @@ typedef enum BufferFillFlags {
 static int PreBakeBgmAl(StreamPlayer *player, const char *filename);
 
 /**
- * @brief  The bgm player that we use, currently only one bgm player can exist.
+ * @brief The players, voices and caches of one engine.
  */
-static StreamPlayer *bgm_player;
+typedef struct AlEngine {
+	StreamPlayer *bgm_player;
+	StreamPlayer *background_bgm_player;
+	// Plays the stems of one song together, their gains set on their own.
+	StreamPlayer *stem_player;
+	SfxPlayer *sfx_player;
+	// Voices quieter than this after distance fading and occlusion are culled, virtual until they can be heard.
+	float cull_gain;
+	// Sfx longer than this are streamed, negative never streams.
+	float sfx_stream_seconds;
+	// If the mixer is pushing source events to us, so we don't need to poll every source each update.
+	int source_events_enabled;
+	// Counts calls to UpdateAl, so sfx triggers in the same update can be coalesced.
+	unsigned int update_count;
+	gsSfxFinishedCallback sfx_finished_callback;
+	void *sfx_finished_userdata;
+	PcmCache pcm_cache;
+	// If decoded sfx are given to the mixer as IMA ADPCM, so it keeps them compressed.
+	int compress_sfx;
+	// The loopback device when headless, mixed only when RenderAl is called.
+	ALCdevice *headless_device;
+	// The device sample rate, the rate the sound clock counts at.
+	ALCint device_frequency;
+	// The listener position, at and up, sent to the mixer with the emitter moves when listener_moved is set.
+	ALfloat listener[9];
+	int listener_moved;
+	// What each bus was last set to, so virtual voices are held on paused buses and culled on quiet ones like real ones are.
+	float bus_volumes[GS_MAX_BUSES];
+	unsigned char bus_muted[GS_MAX_BUSES];
+	unsigned char bus_paused[GS_MAX_BUSES];
+	gsBus bus_parents[GS_MAX_BUSES];
+} AlEngine;
 /**
- * @brief  The bgm player that we use, currently only one bgm player can exist.
+ * @brief What calls see without a engine, like before sound is initialized or after sfx outlive it.
  */
-static StreamPlayer *background_bgm_player;
+static AlEngine no_engine;
 /**
- * @brief The sfx player, currently only one sfx player can exist
+ * @brief Gets the state of the engine calls on this thread work on.
  */
-static SfxPlayer *sfx_player;
+static AlEngine *CurrentAlEngine(void);
 /**
  * @brief Constructor for a BgmPlayer
  *
@@ -105,6 +265,10 @@ static StreamPlayer *NewPlayer(void);
  * @return A ready to use sfx player.
  */
 static SfxPlayer *NewSfxPlayer(void);
+/**
+ * @brief Constructor for the stem player, a stream player with room for every stem.
+ */
+static StreamPlayer *NewStemPlayer(void);
 // static int PreBakeBgmAl(StreamPlayer *player, const char *filename, double *loop_begin, double *loop_end, float volume);
 /**
  * @brief Preloads all of the buffers in a player
@@ -167,10 +331,11 @@ static void ClosePlayerFile(StreamPlayer *player);
  * @brief Sets the source to playing, which starts to play the queued buffers.
  *
  * @param player The bgm player to start.
+ * @param start_frame The device frame to start on, 0 starts right away.
  *
  * @return
  */
-static int StartPlayer(StreamPlayer *player);
+static int StartPlayer(StreamPlayer *player, Uint64 start_frame);
 /**
  * @brief Updates the passed in player, this is needed as it processes the stream and reads bytes and loads buffers.
  *
@@ -194,15 +359,229 @@ static int StopBgm(StreamPlayer *player);
  *
  * @return 1 0n successful, 0 on failure.
  */
-static int PauseBgm(void);
+static int PauseBgm(StreamPlayer *player);
 /**
- * @brief Checks to see if any playing sfx buffers are finished, and then reloads them into the free queue if so.
+ * @brief Checks every real sfx source to see if it is finished, and then releases its voice if so.  Only used when mixer events are unavailable or were dropped.
  *
  * @param player The sfx player to check.
  *
  * @return 1 if successful, 0 if not.
  */
 static int UpdateSfxPlayer(SfxPlayer *player);
+/**
+ * @brief Finishes virtual voices that ran past their end, and gives sources to the virtual voices that should be heard.
+ *
+ * @param player The sfx player to update.
+ */
+static void UpdateVirtualVoices(SfxPlayer *player);
+/**
+ * @brief Drains the finished/processed events that the mixer pushed since the last update, and handles only the sources that had something happen.
+ *
+ * @return 1 if all events were handled, 0 if the mixer dropped events and everything needs to be polled.
+ */
+static int DrainSourceEvents(void);
+/**
+ * @brief Handles a sfx source the mixer reported as stopped.
+ *
+ * @param player The sfx player the source might belong to
+ * @param source The AL source name from the event
+ */
+static void HandleSfxSourceStopped(SfxPlayer *player, ALuint source);
+/**
+ * @brief Finds the index of a AL source in the sfx player.
+ *
+ * @param player The sfx player to search
+ * @param source The AL source name
+ *
+ * @return The index into the sources, or -1 if it isn't a sfx source.
+ */
+static int SfxSourceIndex(SfxPlayer *player, ALuint source);
+/**
+ * @brief Releases a finished voice and fires the finished callback.
+ *
+ * @param player The sfx player to release from
+ * @param voice_num The voice that finished.
+ */
+static void FinishSfxVoice(SfxPlayer *player, int voice_num);
+/**
+ * @brief Stops a voice and frees its source and slot, which makes the voice handle stale.
+ *
+ * @param player The player to release from
+ * @param voice_num The voice to release.
+ */
+static void ReleaseSfxVoice(SfxPlayer *player, int voice_num);
+/**
+ * @brief Gets the voice number for a handle.
+ *
+ * @param voice The voice handle
+ *
+ * @return The voice number, or -1 if the voice is stale.
+ */
+static int VoiceIndex(gsVoice voice);
+/**
+ * @brief Checks if a voice should get a source before another one.
+ *
+ * @return 1 if voice a is higher priority, or the same priority and louder.
+ */
+static int VoiceOutranks(SfxVoice *a, SfxVoice *b);
+/**
+ * @brief Gets a source for a voice, taking one from a weaker real voice if they are all used.
+ *
+ * @param player The sfx player
+ * @param voice_num The voice that wants a source
+ *
+ * @return The source number, or -1 if every real voice outranks it.
+ */
+static int AcquireSfxSource(SfxPlayer *player, int voice_num);
+/**
+ * @brief Sets up a voice to start mixing on a source, from where it would be if it was always playing.  It starts on the next FlushSfxStarts.
+ *
+ * @param player The sfx player
+ * @param voice_num The voice to make real
+ * @param source_num The free source to play it on
+ */
+static void RealizeSfxVoice(SfxPlayer *player, int voice_num, int source_num);
+/**
+ * @brief Takes the source away from a real voice, it keeps time until it is made real again.  A voice whose source already stopped is finished instead.
+ *
+ * @param player The sfx player
+ * @param voice_num The real voice to make virtual
+ */
+static void VirtualizeSfxVoice(SfxPlayer *player, int voice_num);
+/**
+ * @brief Gets the sample frame a virtual voice would be playing now.  Time is kept in device frames rendered, so it
+ * matches what the mixer plays even when it renders faster than real time, like in a replay.
+ *
+ * @param voice The virtual voice
+ * @param clock The device clock
+ *
+ * @return The sample frame, wrapped for looping voices.  Negative while it waits to start.
+ */
+static Sint64 VirtualVoiceOffset(SfxVoice *voice, Uint64 clock);
+/**
+ * @brief Removes a voice from the virtual list in O(1).
+ */
+static void RemoveVirtualVoice(SfxPlayer *player, int voice_num);
+/**
+ * @brief Starts every source set up since the last flush, with one call into the mixer.
+ *
+ * @param player The sfx player to flush.
+ */
+static void FlushSfxStarts(SfxPlayer *player);
+/**
+ * @brief Gets the source position for a pan value.
+ *
+ * @param pan -1 is full left, 1 is full right.
+ * @param position The position to fill.
+ */
+static void SfxPanPosition(float pan, ALfloat *position);
+/**
+ * @brief Fills in where a voice plays from, its position, distance attenuation and bus, in a source start.
+ */
+static void PlaceSfxVoice(const SfxVoice *voice, ALsourceStartSG *start);
+/**
+ * @brief Gets the bus a voice plays through, gsBus_Sfx unless its sfx picked another.
+ */
+static gsBus SfxVoiceBus(const SfxVoice *voice);
+/**
+ * @brief Gets a bus's volume times every bus above it, the way the mixer works it out.
+ *
+ * @return The gain, 0 if it or a bus above it is muted.
+ */
+static float BusGain(gsBus bus);
+/**
+ * @brief Gets if a bus or any bus above it is paused.
+ */
+static int BusPaused(gsBus bus);
+/**
+ * @brief Holds or restarts the time of virtual voices whose buses were paused or unpaused, and culls real voices that
+ * their buses turned down.  Called after any bus change.
+ */
+static void UpdateBusVoices(SfxPlayer *player);
+/**
+ * @brief Culls every real voice that can't be heard anymore.
+ */
+static void CullRealSfxVoices(SfxPlayer *player);
+/**
+ * @brief Sends the listener and the moved voices on real sources to the mixer, in one call.
+ */
+static void FlushSfxMoves(SfxPlayer *player);
+/**
+ * @brief Gets how loud a voice is where the listener is, with the mixer's linear distance fade.
+ *
+ * @return The gain, 0 if it is occluded or past its max distance.
+ */
+static float SfxVoiceAudibleGain(const SfxVoice *voice);
+/**
+ * @brief Updates a voice's audible gain, and culls it if it is real and can't be heard anymore.  It keeps its place in the sound.
+ *
+ * @return 1 if it was culled.
+ */
+static int CullSfxVoice(SfxPlayer *player, int voice_num);
+/**
+ * @brief Starts a streamed sfx voice on a free stream player.
+ *
+ * @param player The sfx player
+ * @param voice_num The voice to start, its settings must be filled.
+ *
+ * @return 1 if it started, 0 if every stream player is busy or the file couldn't be opened.
+ */
+static int StartSfxStream(SfxPlayer *player, int voice_num);
+/**
+ * @brief Refills a streamed sfx's buffers, and restarts it if it was starved.
+ *
+ * @param player The sfx player
+ * @param stream_num The stream to update.
+ *
+ * @return 1 if it is still playing, 0 if it finished.
+ */
+static int UpdateSfxStream(SfxPlayer *player, int stream_num);
+/**
+ * @brief Finds the stream player for a AL source.
+ *
+ * @return The stream number, or -1 if it isn't a sfx stream source.
+ */
+static int SfxStreamIndex(SfxPlayer *player, ALuint source);
+/**
+ * @brief Gets the AL source a voice is heard on.
+ *
+ * @return The source, or 0 if the voice is virtual.
+ */
+static ALuint SfxVoiceSource(SfxPlayer *player, SfxVoice *voice);
+/**
+ * @brief Gets the device frame the next mix starts at.
+ */
+static Uint64 DeviceClock(void);
+/**
+ * @brief Checks if a voice's scheduled stop has come.
+ */
+static int SfxVoiceStopPassed(SfxVoice *voice, Uint64 clock);
+/**
+ * @brief Gets a voice's gain where its fade is now, or its gain if it isn't fading.
+ */
+static float SfxVoiceGain(const SfxVoice *voice);
+/**
+ * @brief Gets how many device frames are left in a voice's fade, 0 if it isn't fading.
+ */
+static Uint64 SfxVoiceFadeLeft(const SfxVoice *voice);
+/**
+ * @brief Checks the limits and sets up a new voice for a sfx.
+ *
+ * @param request What to play and how.
+ *
+ * @return The voice, or 0 if it was limited or there were no free voices.
+ */
+static gsVoice TriggerSfx(const gsPlayRequest *request);
+/**
+ * @brief Applies the sfx coalesce, retrigger and instance limits to a trigger.
+ *
+ * @param sfx The sfx being triggered.
+ * @param volume The volume it was triggered with.
+ * @param voice Set to the voice that absorbed the trigger if it was coalesced.
+ *
+ * @return 1 if a new voice should be played, 0 if it was coalesced or limited.
+ */
+static int CheckSfxLimits(gsSfx *sfx, float volume, gsVoice *voice);
 /**
  * @brief Restart the stream from the loop point.
  *
@@ -211,51 +590,240 @@ static int UpdateSfxPlayer(SfxPlayer *player);
  * @return
  */
 static int RestartStream(StreamPlayer *player);
+/**
+ * @brief Prebakes a bgm player, and indexes its file so it can seek.
+ */
+static int PreBakeSeekableBgm(StreamPlayer *player, const char *filename);
+/**
+ * @brief Gets the frame the player's decoder is at.
+ */
+static ogg_int64_t PlayerDecodeFrame(StreamPlayer *player);
+/**
+ * @brief Moves the decoder to a frame, using the page index to go straight to the page before it and decoding the rest.
+ *
+ * @return 1 if it moved, 0 if the file couldn't seek.
+ */
+static int SeekPlayerFile(StreamPlayer *player, ogg_int64_t frame);
+/**
+ * @brief Moves a player to a frame, and refills its buffers from there.  Keeps it playing or paused if it was.
+ *
+ * @return 1 if it moved, 0 if the file couldn't seek, which stops the player.
+ */
+static int SeekPlayer(StreamPlayer *player, ogg_int64_t frame);
+/**
+ * @brief Moves a ogg file to a frame, going straight to the page before it with the index and decoding the rest into scratch.
+ *
+ * @return The frame it got to, -1 if it couldn't seek.
+ */
+static ogg_int64_t SeekOggFile(OggVorbis_File *file, OggPageIndex *index, ogg_int64_t frame, int frame_size, short *scratch);
+/**
+ * @brief Gets the seconds a player is at in its song, -1 if nothing is loaded.
+ */
+static double TellPlayer(StreamPlayer *player);
+/**
+ * @brief Opens every stem on the stem player, they must all be the same rate and channels.
+ *
+ * @return 1 if they all opened, 0 if one couldn't, with none left open.
+ */
+static int OpenStemFiles(StreamPlayer *player, const char *const *filenames, int count);
+static void CloseStemFiles(StemFiles *stems);
+/**
+ * @brief Reads the same number of bytes the first stem just read from every other stem, and interleaves them all into the stem block.  Stems that end early are padded with silence.
+ */
+static void LoadStemData(StreamPlayer *player, long bytes);
+/**
+ * @brief Gives a buffer the bytes LoadBufferData read, as a stem buffer on the stem player.
+ */
+static void PlayerBufferData(StreamPlayer *player, ALuint buffer, long bytes);
 /**
  * @brief Loads a filename into a Loaded Sfx file for playing later.
  *
  * @param player The player to load with
  * @param filename The filename of the file to load.
+ * @param stream If the sfx should be streamed no matter how long it is.
  *
  * @return A Sg_Loaded_Sfx struct with the loaded file and info for playing later.
  */
-static Sg_Loaded_Sfx *LoadSfxFile(const char *filename);
+static Sg_Loaded_Sfx *LoadSfxFile(const char *filename, int stream, gsArena *arena);
+/**
+ * @brief Opens a sfx's compressed data for decoding.
+ *
+ * @param memory Read position in the data, must outlive the vorbis file.
+ *
+ * @return 1 if it opened, 0 if the data isn't vorbis.
+ */
+static int OpenSfxOgg(Sg_Loaded_Sfx *loaded_sfx, OggMemory *memory, OggVorbis_File *vbfile);
+static size_t OggMemoryRead(void *ptr, size_t size, size_t nmemb, void *datasource);
+static int OggMemorySeek(void *datasource, ogg_int64_t offset, int whence);
+static long OggMemoryTell(void *datasource);
+/**
+ * @brief Decodes a sfx and uploads it to its AL buffer, making it the newest in the cache.  There must be room for it.
+ *
+ * @return 1 if it was decoded, 0 if the data or upload failed.
+ */
+static int DecodeSfx(Sg_Loaded_Sfx *loaded_sfx);
+/**
+ * @brief Decodes a vorbis sfx's compressed data.
+ *
+ * @param bytes Set to the size of the decoded data.
+ *
+ * @return The 16 bit samples, free them when done.  NULL if it couldn't be opened.
+ */
+static short *DecodeVorbisSfx(Sg_Loaded_Sfx *loaded_sfx, int *bytes);
+/**
+ * @brief Gets a wav sfx's samples in a format the mixer takes.  16 bit and float samples are used in place, 24 bit is converted to float.
+ *
+ * @param format Set to the AL format of the samples.
+ * @param converted Set to the conversion if one was needed, free it when done.
+ *
+ * @return The samples, NULL if the conversion couldn't be allocated.
+ */
+static const void *WavSfxSamples(Sg_Loaded_Sfx *loaded_sfx, ALenum *format, void **converted);
+/**
+ * @brief Converts float samples to 16 bit for encoding.
+ *
+ * @return The converted samples, free them when done.
+ */
+static short *FloatToPcm16(const void *samples, size_t count);
+/**
+ * @brief Makes sure a sfx is decoded before it plays, decoding it again if it was evicted.
+ *
+ * @return 1 if it is decoded, 0 if it can't fit in the budget or failed to decode.
+ */
+static int MakeSfxResident(Sg_Loaded_Sfx *loaded_sfx);
+/**
+ * @brief Evicts the least recently played sfx that aren't playing, until there is room for this many more bytes.
+ *
+ * @return 1 if there is room, 0 if there isn't even after evicting everything that can be.
+ */
+static int ReservePcm(size_t bytes);
+/**
+ * @brief Deletes a sfx's decoded buffer, it keeps its compressed data.
+ */
+static void EvictSfxPcm(Sg_Loaded_Sfx *loaded_sfx);
+/**
+ * @brief Moves a decoded sfx to the newest end of the cache.
+ */
+static void TouchSfxPcm(Sg_Loaded_Sfx *loaded_sfx);
+static void UnlinkSfxPcm(Sg_Loaded_Sfx *loaded_sfx);
 /**
  * @brief Plays a Sound effect from an already loaded sound file.
  *
  * @param player The player to play with
- * @param sfx_file The already loaded file with the info to play.
- * @param volume The volume to play with, between 0 and 1.
+ * @param request The sfx, with its file already loaded, and how to play it.
  *
- * @return  1 on success, 0 on failure.
+ * @return The voice it is playing on, or 0 if every voice is in use.
  */
-static int PlaySfxFile(SfxPlayer *player, Sg_Loaded_Sfx *loaded_sfx, float volume);
+static gsVoice PlaySfxFile(SfxPlayer *player, const gsPlayRequest *request);
 /**
  * @brief Cleans up a SFX player and releases memory
  *
  * @param player The SFX player to destroy
  */
 static void DeleteSfxPlayer(SfxPlayer *player);
+
 /**
- * @brief Unqueues a specific sfx buffer, and then puts it back into the free buffers.
+ * @brief Converts a channel count into the ALC channel layout token.
  *
- * @param player The player to release from
- * @param source_num The buffer/source number that we are processing.
+ * @param channels The number of output channels
+ *
+ * @return The layout token, or 0 if there is no layout for that many channels.
  */
-static void UnqueueSfxBuffer(SfxPlayer *player, ALint source_num);
+static ALCint ChannelLayoutForCount(int channels);
+
+static ALCint ChannelLayoutForCount(int channels) {
+	switch (channels) {
+		case 1:
+			return ALC_MONO_SOFT;
+		case 2:
+			return ALC_STEREO_SOFT;
+		case 4:
+			return ALC_QUAD_SOFT;
+		case 6:
+			return ALC_5POINT1_SOFT;
+		case 7:
+			return ALC_6POINT1_SOFT;
+		case 8:
+			return ALC_7POINT1_SOFT;
+		default:
+			return 0;
+	}
+}
 
-int InitializeAl(void) {
-	if (InitAL() != 0)
+int InitializeAl(const gsSoundConfig *config) {
+	// Room for five key/value pairs and the terminator.
+	ALCint attributes[11];
+	int num_attributes = 0;
+#ifdef GN_SOUND_FIXED_RATE
+	// Built to never resample, so the device runs at the one rate the mixer takes.
+	if (config && config->sample_rate > 0 && config->sample_rate != GN_SOUND_FIXED_RATE)
+		fprintf(stderr, "Built for %d hz only, not mixing at %d hz\n", GN_SOUND_FIXED_RATE, config->sample_rate);
+	attributes[num_attributes++] = ALC_FREQUENCY;
+	attributes[num_attributes++] = GN_SOUND_FIXED_RATE;
+#endif
+	if (config) {
+#ifndef GN_SOUND_FIXED_RATE
+		if (config->sample_rate > 0) {
+			attributes[num_attributes++] = ALC_FREQUENCY;
+			attributes[num_attributes++] = config->sample_rate;
+		}
+#endif
+		if (config->period_frames > 0) {
+			attributes[num_attributes++] = ALC_PERIOD_SIZE_SG;
+			attributes[num_attributes++] = config->period_frames;
+		}
+		if (config->channels > 0) {
+			ALCint layout = ChannelLayoutForCount(config->channels);
+			if (layout) {
+				attributes[num_attributes++] = ALC_FORMAT_CHANNELS_SOFT;
+				attributes[num_attributes++] = layout;
+			} else {
+				fprintf(stderr, "Unsupported output channel count %d, using stereo\n", config->channels);
+			}
+		}
+		if (config->mix_threads > 0) {
+			attributes[num_attributes++] = ALC_MIX_THREADS_SG;
+			attributes[num_attributes++] = config->mix_threads;
+		}
+	}
+	int headless = config && config->headless;
+	if (headless) {
+		attributes[num_attributes++] = ALC_FORMAT_TYPE_SOFT;
+		attributes[num_attributes++] = ALC_FLOAT_SOFT;
+	}
+	attributes[num_attributes] = 0;
+	if ((headless ? InitLoopbackAL(attributes) : InitAL(attributes)) != 0)
 		return 0;
-	bgm_player = NewPlayer();
-	background_bgm_player = NewPlayer();
-	sfx_player = NewSfxPlayer();
+	static const ALfloat default_listener[9] = {0, 0, 0, 0, 0, -1, 0, 1, 0};
+	AlEngine *engine = SoundCalloc(1, sizeof(*engine));
+	CurrentEngine()->al = engine;
+	memcpy(engine->listener, default_listener, sizeof(engine->listener));
+	for (int i = 0; i < GS_MAX_BUSES; ++i)
+		engine->bus_volumes[i] = 1.0f;
+	engine->headless_device = headless ? alcGetContextsDevice(alcGetCurrentContext()) : NULL;
+	engine->sfx_stream_seconds = (config && config->sfx_stream_seconds) ? config->sfx_stream_seconds : SFX_STREAM_SECONDS;
+	engine->pcm_cache.budget = config ? config->pcm_budget_bytes : 0;
+	engine->cull_gain = (config && config->cull_gain > 0) ? config->cull_gain : SFX_CULL_GAIN;
+	engine->compress_sfx = config && config->compress_sfx && alIsExtensionPresent("AL_EXT_IMA4");
+	// Panned sfx sit on the unit circle at their reference distance so only positional ones fade, and they fade out to nothing at their max distance.
+	alDistanceModel(AL_LINEAR_DISTANCE_CLAMPED);
+	alcGetIntegerv(alcGetContextsDevice(alcGetCurrentContext()), ALC_FREQUENCY, 1, &engine->device_frequency);
+	engine->source_events_enabled = alIsExtensionPresent("AL_SG_source_events");
+	if (engine->source_events_enabled)
+		alEnable(AL_SOURCE_EVENTS_SG);
+	engine->bgm_player = NewPlayer();
+	engine->background_bgm_player = NewPlayer();
+	engine->stem_player = NewStemPlayer();
+	engine->sfx_player = NewSfxPlayer();
+	alSourcei(engine->bgm_player->source, AL_BUS_SG, gsBus_Music);
+	alSourcei(engine->background_bgm_player->source, AL_BUS_SG, gsBus_Music);
+	alSourcei(engine->stem_player->source, AL_BUS_SG, gsBus_Music);
 	return 1;
 }
 
 static StreamPlayer *NewPlayer(void) {
 	StreamPlayer *player;
-	player = calloc(1, sizeof(*player));
+	player = SoundCalloc(1, sizeof(*player));
 	assert(player != NULL);
 	alGenBuffers(BGM_NUM_BUFFERS, player->buffers);
 	ALenum result;
@@ -274,128 +842,700 @@ static StreamPlayer *NewPlayer(void) {
 	result = alGetError();
 	assert(result == AL_NO_ERROR && "Could not set source rolloff");
 	size_t data_read_size = (size_t)(BGM_BUFFER_SAMPLES);
-	player->membuf = malloc(data_read_size);
+	player->membuf = SoundMalloc(data_read_size);
 	player->loops = 255;
 	return player;
 }
 
+static StreamPlayer *NewStemPlayer(void) {
+	StreamPlayer *player = NewPlayer();
+	player->stems = SoundCalloc(1, sizeof(*player->stems));
+	assert(player->stems != NULL);
+	player->stems->scratch = SoundMalloc(BGM_BUFFER_SAMPLES);
+	player->stems->block = SoundMalloc((size_t)BGM_BUFFER_SAMPLES * GS_MAX_STEMS);
+	return player;
+}
+
 static SfxPlayer *NewSfxPlayer(void) {
 	SfxPlayer *sfx_player;
-	sfx_player = calloc(1, sizeof(*sfx_player));
-	sfx_player->free_buffers_stack = CreateStack(MAX_SFX_SOUNDS);
-	sfx_player->playing_buffers_vector = CreateVector();
-	alGenBuffers(MAX_SFX_SOUNDS, sfx_player->buffers);
-	assert(alGetError() == AL_NO_ERROR && "Could not create buffers");
+	sfx_player = SoundCalloc(1, sizeof(*sfx_player));
+	sfx_player->free_sources_stack = CreateStack(MAX_SFX_SOUNDS);
+	sfx_player->voice_slots = CreateSlotMap(MAX_SFX_VOICES);
 	alGenSources(MAX_SFX_SOUNDS, sfx_player->sources);
 	assert(alGetError() == AL_NO_ERROR && "Could not create source");
-	for (size_t i = 0; i < 10; ++i) {
+	for (size_t i = 0; i < MAX_SFX_SOUNDS; ++i) {
 		alSource3f(sfx_player->sources[i], AL_POSITION, 0, 0, -1);
 		alSourcei(sfx_player->sources[i], AL_SOURCE_RELATIVE, AL_TRUE);
 		alSourcei(sfx_player->sources[i], AL_ROLLOFF_FACTOR, 0);
 		assert(alGetError() == AL_NO_ERROR && "Could not set source parameters");
-		PushStack(sfx_player->free_buffers_stack, i);
+		sfx_player->source_voices[i] = -1;
+		sfx_player->source_pending[i] = -1;
+		PushStack(sfx_player->free_sources_stack, i);
+	}
+	for (size_t i = 0; i < SFX_STREAM_PLAYERS; ++i) {
+		sfx_player->streams[i] = NewPlayer();
+		sfx_player->stream_voices[i] = -1;
 	}
 	return sfx_player;
 }
 
-int PlaySfxAl(Sg_Loaded_Sfx *sound_file, float volume) {
-	PlaySfxFile(sfx_player, sound_file, volume);
-	return 1;
+gsVoice PlaySfxAl(gsSfx *sfx, float volume, int looping) {
+	AlEngine *engine = CurrentAlEngine();
+	gsPlayRequest request = {sfx, volume, 1.0f, 0, looping, 0, {0}, 0};
+	gsVoice voice = TriggerSfx(&request);
+	FlushSfxStarts(engine->sfx_player);
+	return voice;
 }
 
-int PlayBgmAl(float volume) {
-	alSourcef(bgm_player->source, AL_GAIN, volume);
-	if (!StartPlayer(bgm_player)) {
-		ClosePlayerFile(bgm_player);
-		return 0;
+int PlaySfxBatchAl(const gsPlayRequest *requests, int count, gsVoice *voices) {
+	AlEngine *engine = CurrentAlEngine();
+	int played = 0;
+	for (int i = 0; i < count; ++i) {
+		gsVoice voice = TriggerSfx(&requests[i]);
+		if (voice)
+			++played;
+		if (voices)
+			voices[i] = voice;
 	}
-	music_ended = 0;
-	return 1;
+	FlushSfxStarts(engine->sfx_player);
+	return played;
 }
 
-int PlayBgmBackgroundAl(float volume) {
-	alSourcef(background_bgm_player->source, AL_GAIN, volume);
-	if (!StartPlayer(background_bgm_player)) {
-		ClosePlayerFile(background_bgm_player);
+static gsVoice TriggerSfx(const gsPlayRequest *request) {
+	AlEngine *engine = CurrentAlEngine();
+	gsSfx *sfx = request->sfx;
+	if (!sfx || !sfx->loaded_sfx)
 		return 0;
+	gsVoice voice = 0;
+	if (!CheckSfxLimits(sfx, request->volume, &voice))
+		return voice;
+	Sg_Loaded_Sfx *loaded_sfx = sfx->loaded_sfx;
+	if (!loaded_sfx->streamed && !MakeSfxResident(loaded_sfx))
+		return 0;
+	voice = PlaySfxFile(engine->sfx_player, request);
+	if (!voice)
+		return 0;
+	++loaded_sfx->instances;
+	loaded_sfx->last_trigger = DeviceClock();
+	loaded_sfx->last_voice = voice;
+	loaded_sfx->last_voice_update = engine->update_count;
+	return voice;
+}
+
+static int CheckSfxLimits(gsSfx *sfx, float volume, gsVoice *voice) {
+	AlEngine *engine = CurrentAlEngine();
+	Sg_Loaded_Sfx *loaded_sfx = sfx->loaded_sfx;
+	if (sfx->coalesce && loaded_sfx->last_voice_update == engine->update_count) {
+		int voice_num = VoiceIndex(loaded_sfx->last_voice);
+		if (voice_num != -1) {
+			// Stack onto the voice already started this update, instead of phasing against it.
+			float gain = engine->sfx_player->voices[voice_num].gain + volume;
+			SetVoiceGainAl(loaded_sfx->last_voice, gain > 1.0f ? 1.0f : gain);
+			*voice = loaded_sfx->last_voice;
+			return 0;
+		}
+	}
+	if (sfx->min_retrigger_seconds > 0 && loaded_sfx->last_voice) {
+		Uint64 interval = (Uint64)(sfx->min_retrigger_seconds * engine->device_frequency);
+		if (DeviceClock() - loaded_sfx->last_trigger < interval)
+			return 0;
 	}
-	music_ended = 0;
+	if (sfx->max_instances > 0 && loaded_sfx->instances >= sfx->max_instances)
+		return 0;
 	return 1;
 }
 
-int PreBakeBgm(const char *filename) {
-	return PreBakeBgmAl(bgm_player, filename);
+void StopSfxAl(gsSfx *sfx) {
+	AlEngine *engine = CurrentAlEngine();
+	for (int i = 0; i < MAX_SFX_VOICES; ++i) {
+		if (engine->sfx_player->voices[i].sfx == sfx)
+			ReleaseSfxVoice(engine->sfx_player, i);
+	}
 }
 
-int PreBakeBackgroundBgm(const char *filename) {
-	return PreBakeBgmAl(background_bgm_player, filename);
+static int VoiceIndex(gsVoice voice) {
+	AlEngine *engine = CurrentAlEngine();
+	return SlotMapIndex(engine->sfx_player->voice_slots, voice);
 }
 
-static void setLoopPoints(StreamPlayer *player, double *loopBegin, double *loopEnd) {
-	// Retrieve the vorbis comments
-	vorbis_comment *vc = ov_comment(&player->vbfile, -1);
-	if (!vc) {
-		fprintf(stderr, "Error retrieving vorbis comments\n");
-		return;
-	}
-	const char *start = "LOOPSTART=";
-	const char *end = "LOOPEND=";
-	for (int i = 0; i < vc->comments; ++i) {
-		char *comment = vc->user_comments[i];
-		if (strncasecmp(comment, start, strlen(start)) == 0) {
-			float startTime = atof(comment + strlen(start));
-			*loopBegin = startTime;
-		} else if (strncasecmp(comment, end, strlen(end)) == 0) {
-			float endTime = atof(comment + strlen(end));
-			*loopEnd = endTime;
-		}
-	}
+int StopVoiceAl(gsVoice voice) {
+	AlEngine *engine = CurrentAlEngine();
+	int voice_num = VoiceIndex(voice);
+	if (voice_num == -1)
+		return 0;
+	ReleaseSfxVoice(engine->sfx_player, voice_num);
+	return 1;
 }
 
-static int PreBakeBgmAl(StreamPlayer *player, const char *filename) {
-	if (!OpenPlayerFile(player, filename))
+int StopVoiceScheduledAl(gsVoice voice, uint64_t frame) {
+	AlEngine *engine = CurrentAlEngine();
+	int voice_num = VoiceIndex(voice);
+	if (voice_num == -1)
 		return 0;
-	alSourceRewind(player->source);
-	alSourcei(player->source, AL_BUFFER, 0);
-	PreBakeBuffers(player);
+	SfxVoice *sfx_voice = &engine->sfx_player->voices[voice_num];
+	sfx_voice->stop_frame = frame;
+	sfx_voice->stop_scheduled = 1;
+	// A voice waiting in a start gets its stop when the start is flushed, and a virtual one is finished in UpdateVirtualVoices.
+	if (sfx_voice->source_num != -1 && engine->sfx_player->source_pending[sfx_voice->source_num] != -1)
+		return 1;
+	ALuint source = SfxVoiceSource(engine->sfx_player, sfx_voice);
+	if (source)
+		alSourceStopAtSG(source, frame);
 	return 1;
 }
 
-static int PreBakeBuffers(StreamPlayer *player) {
-	ALsizei i;
-	BufferFillFlags buf_flags;
-	for (i = 0; i < BGM_NUM_BUFFERS; i++) {
-		long bytes_read = LoadBufferData(player, &buf_flags);
-		alBufferData(player->buffers[i], player->format, player->membuf, (ALsizei)bytes_read,
-					 player->vbinfo->rate);
-	}
-	if (alGetError() != AL_NO_ERROR) {
-		fprintf(stderr, "Error buffering for playback\n");
-		return 0;
-	}
-	alSourceQueueBuffers(player->source, i, player->buffers);
-	if (alGetError() != AL_NO_ERROR) {
-		fprintf(stderr, "Error queuing buffers for playback\n");
+int SetVoiceGainAl(gsVoice voice, float volume) {
+	AlEngine *engine = CurrentAlEngine();
+	int voice_num = VoiceIndex(voice);
+	if (voice_num == -1)
 		return 0;
+	SfxVoice *sfx_voice = &engine->sfx_player->voices[voice_num];
+	sfx_voice->gain = volume;
+	sfx_voice->fade_frames = 0;
+	if (sfx_voice->stream_num != -1) {
+		alSourcef(SfxVoiceSource(engine->sfx_player, sfx_voice), AL_GAIN, sfx_voice->occluded ? 0 : volume);
+		return 1;
 	}
+	// Too quiet to hear, so let something else use the source.  It becomes real again in UpdateVirtualVoices if it gets louder.
+	if (CullSfxVoice(engine->sfx_player, voice_num) || sfx_voice->source_num == -1)
+		return 1;
+	int pending = engine->sfx_player->source_pending[sfx_voice->source_num];
+	if (pending != -1)
+		engine->sfx_player->pending_starts[pending].gain = volume;
+	else
+		alSourcef(engine->sfx_player->sources[sfx_voice->source_num], AL_GAIN, volume);
 	return 1;
 }
 
-static int StartPlayer(StreamPlayer *player) {
-	alSourcePlay(player->source);
-	if (alGetError() != AL_NO_ERROR) {
-		fprintf(stderr, "Error starting playback\n");
+int FadeVoiceAl(gsVoice voice, float volume, float seconds, int stop) {
+	AlEngine *engine = CurrentAlEngine();
+	int voice_num = VoiceIndex(voice);
+	if (voice_num == -1)
 		return 0;
+	if (volume < 0)
+		volume = 0;
+	Uint64 frames = seconds > 0 ? (Uint64)(seconds * engine->device_frequency) : 0;
+	if (!frames)
+		return stop ? StopVoiceAl(voice) : SetVoiceGainAl(voice, volume);
+	SfxVoice *sfx_voice = &engine->sfx_player->voices[voice_num];
+	Uint64 clock = DeviceClock();
+	// Picks up from where a earlier fade got to.
+	sfx_voice->fade_from = SfxVoiceGain(sfx_voice);
+	sfx_voice->fade_start = clock;
+	sfx_voice->fade_frames = frames;
+	sfx_voice->gain = volume;
+	if (stop && !(sfx_voice->stop_scheduled && sfx_voice->stop_frame <= clock + frames))
+		StopVoiceScheduledAl(voice, clock + frames);
+	if (sfx_voice->stream_num != -1) {
+		alSourceFadeSG(SfxVoiceSource(engine->sfx_player, sfx_voice), sfx_voice->occluded ? 0 : volume, (ALsizei)frames, AL_FALSE);
+		return 1;
 	}
+	// Fading in from silence starts virtual, UpdateVirtualVoices realizes it once the fade makes it loud enough.
+	if (CullSfxVoice(engine->sfx_player, voice_num) || sfx_voice->source_num == -1)
+		return 1;
+	// A voice waiting in a start gets its fade when the start is flushed.
+	int pending = engine->sfx_player->source_pending[sfx_voice->source_num];
+	if (pending != -1)
+		engine->sfx_player->pending_starts[pending].gain = sfx_voice->fade_from;
+	else
+		alSourceFadeSG(engine->sfx_player->sources[sfx_voice->source_num], volume, (ALsizei)frames, AL_FALSE);
 	return 1;
 }
 
-static int OpenPlayerFile(StreamPlayer *player, const char *filename) {
-	if (player->file_loaded)
-		ClosePlayerFile(player);
-	int result = ov_fopen(filename, &player->vbfile);
-	if (result != 0) {
-		fprintf(stderr, "Could not open audio in %s: %d\n", filename, result);
+int SetVoicePitchAl(gsVoice voice, float pitch) {
+#ifdef GN_SOUND_NO_PITCH
+	// Built without pitch, the mixer wouldn't apply it.
+	(void)voice;
+	(void)pitch;
+	return 0;
+#else
+	AlEngine *engine = CurrentAlEngine();
+	int voice_num = VoiceIndex(voice);
+	if (voice_num == -1 || pitch <= 0)
+		return 0;
+	SfxVoice *sfx_voice = &engine->sfx_player->voices[voice_num];
+	sfx_voice->pitch = pitch;
+	ALuint source = SfxVoiceSource(engine->sfx_player, sfx_voice);
+	if (source)
+		alSourcef(source, AL_PITCH, pitch);
+	return 1;
+#endif
+}
+
+int SetVoicePanAl(gsVoice voice, float pan) {
+	AlEngine *engine = CurrentAlEngine();
+	int voice_num = VoiceIndex(voice);
+	if (voice_num == -1)
+		return 0;
+	SfxVoice *sfx_voice = &engine->sfx_player->voices[voice_num];
+	if (sfx_voice->positional)
+		return 0;
+	sfx_voice->pan = pan < -1.0f ? -1.0f : pan > 1.0f ? 1.0f : pan;
+	ALuint source = SfxVoiceSource(engine->sfx_player, sfx_voice);
+	if (source) {
+		ALfloat position[3];
+		SfxPanPosition(sfx_voice->pan, position);
+		alSourcefv(source, AL_POSITION, position);
+	}
+	return 1;
+}
+
+static void SfxPanPosition(float pan, ALfloat *position) {
+	// Keep the source on a unit circle in front of the listener, so only the direction changes and not the distance.
+	position[0] = pan;
+	position[1] = 0;
+	position[2] = -sqrtf(1.0f - pan * pan);
+}
+
+static gsBus SfxVoiceBus(const SfxVoice *voice) {
+	gsBus bus = voice->sfx->bus;
+	return bus > gsBus_Master && bus < GS_MAX_BUSES ? bus : gsBus_Sfx;
+}
+
+static void PlaceSfxVoice(const SfxVoice *voice, ALsourceStartSG *start) {
+	start->bus = (ALuint)SfxVoiceBus(voice);
+	if (!voice->positional) {
+		SfxPanPosition(voice->pan, start->position);
+		start->relative = AL_TRUE;
+		start->reference_distance = 1.0f;
+		start->max_distance = FLT_MAX;
+		// Rolloff has to be on for the mixer to pan it, on the unit circle it never fades.
+		start->rolloff_factor = 1.0f;
+		return;
+	}
+	const gsSfx *sfx = voice->sfx;
+	memcpy(start->position, voice->position, sizeof(start->position));
+	start->relative = AL_FALSE;
+	start->reference_distance = sfx->min_distance > 0 ? sfx->min_distance : 0;
+	// Fading to silent over a huge distance is the same as not fading, and keeps the linear model from dividing by zero.
+	start->max_distance = sfx->max_distance > start->reference_distance ? sfx->max_distance : FLT_MAX;
+	start->rolloff_factor = 1.0f;
+}
+
+int SetEmitterPositionsAl(const gsVoice *voices, const float *positions, int count) {
+	AlEngine *engine = CurrentAlEngine();
+	int moved = 0;
+	for (int i = 0; i < count; ++i) {
+		int voice_num = VoiceIndex(voices[i]);
+		if (voice_num == -1)
+			continue;
+		SfxVoice *sfx_voice = &engine->sfx_player->voices[voice_num];
+		if (!sfx_voice->positional)
+			continue;
+		memcpy(sfx_voice->position, &positions[i * 3], sizeof(sfx_voice->position));
+		++moved;
+		// Culled here rather than in the mixer, so voices out of range never take a source.  Virtual voices pick up their position when they get one.
+		if (CullSfxVoice(engine->sfx_player, voice_num))
+			continue;
+		if (sfx_voice->stream_num != -1) {
+			engine->sfx_player->stream_moved[sfx_voice->stream_num] = 1;
+		} else if (sfx_voice->source_num != -1) {
+			int pending = engine->sfx_player->source_pending[sfx_voice->source_num];
+			if (pending != -1)
+				memcpy(engine->sfx_player->pending_starts[pending].position, sfx_voice->position, sizeof(sfx_voice->position));
+			else
+				engine->sfx_player->source_moved[sfx_voice->source_num] = 1;
+		}
+	}
+	return moved;
+}
+
+void SetListenerAl(const gsListener *new_listener) {
+	AlEngine *engine = CurrentAlEngine();
+	static const float default_forward[3] = {0, 0, -1};
+	static const float default_up[3] = {0, 1, 0};
+	const float *forward = new_listener->forward;
+	const float *up = new_listener->up;
+	if (!forward[0] && !forward[1] && !forward[2])
+		forward = default_forward;
+	if (!up[0] && !up[1] && !up[2])
+		up = default_up;
+	memcpy(&engine->listener[0], new_listener->position, sizeof(float) * 3);
+	memcpy(&engine->listener[3], forward, sizeof(float) * 3);
+	memcpy(&engine->listener[6], up, sizeof(float) * 3);
+	engine->listener_moved = 1;
+}
+
+int SetVoiceOccludedAl(gsVoice voice, int occluded) {
+	AlEngine *engine = CurrentAlEngine();
+	int voice_num = VoiceIndex(voice);
+	if (voice_num == -1)
+		return 0;
+	SfxVoice *sfx_voice = &engine->sfx_player->voices[voice_num];
+	sfx_voice->occluded = occluded != 0;
+	// Streams are never virtual, they go silent instead.
+	if (sfx_voice->stream_num != -1)
+		alSourcef(SfxVoiceSource(engine->sfx_player, sfx_voice), AL_GAIN, sfx_voice->occluded ? 0 : sfx_voice->gain);
+	else
+		CullSfxVoice(engine->sfx_player, voice_num);
+	return 1;
+}
+
+static float SfxVoiceAudibleGain(const SfxVoice *voice) {
+	AlEngine *engine = CurrentAlEngine();
+	if (voice->occluded)
+		return 0;
+	float gain = SfxVoiceGain(voice) * BusGain(SfxVoiceBus(voice));
+	// The mixer only places mono sfx, the rest are heard at full volume wherever they are.
+	if (!voice->positional || voice->sfx->loaded_sfx->format != AL_FORMAT_MONO16)
+		return gain;
+	ALsourceStartSG placement;
+	PlaceSfxVoice(voice, &placement);
+	if (placement.max_distance == FLT_MAX)
+		return gain;
+	float dx = voice->position[0] - engine->listener[0];
+	float dy = voice->position[1] - engine->listener[1];
+	float dz = voice->position[2] - engine->listener[2];
+	float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+	if (distance <= placement.reference_distance)
+		return gain;
+	if (distance >= placement.max_distance)
+		return 0;
+	return gain * (1.0f - (distance - placement.reference_distance) / (placement.max_distance - placement.reference_distance));
+}
+
+static int CullSfxVoice(SfxPlayer *player, int voice_num) {
+	AlEngine *engine = CurrentAlEngine();
+	SfxVoice *sfx_voice = &player->voices[voice_num];
+	sfx_voice->audible_gain = SfxVoiceAudibleGain(sfx_voice);
+	if (sfx_voice->source_num == -1 || sfx_voice->audible_gain >= engine->cull_gain)
+		return 0;
+	VirtualizeSfxVoice(player, voice_num);
+	++engine->pcm_cache.stats.voice_culls;
+	return 1;
+}
+
+static void CullRealSfxVoices(SfxPlayer *player) {
+	for (int i = 0; i < MAX_SFX_SOUNDS; ++i) {
+		if (player->source_voices[i] != -1)
+			CullSfxVoice(player, player->source_voices[i]);
+	}
+}
+
+static void FlushSfxMoves(SfxPlayer *player) {
+	AlEngine *engine = CurrentAlEngine();
+	ALuint sources[MAX_SFX_SOUNDS + SFX_STREAM_PLAYERS];
+	ALfloat positions[(MAX_SFX_SOUNDS + SFX_STREAM_PLAYERS) * 3];
+	int count = 0;
+	// The voice may have changed since the move, only send positional ones, from where they are now.
+	for (int i = 0; i < MAX_SFX_SOUNDS; ++i) {
+		if (!player->source_moved[i])
+			continue;
+		player->source_moved[i] = 0;
+		int voice_num = player->source_voices[i];
+		if (voice_num == -1 || !player->voices[voice_num].positional)
+			continue;
+		sources[count] = player->sources[i];
+		memcpy(&positions[count++ * 3], player->voices[voice_num].position, sizeof(ALfloat) * 3);
+	}
+	for (int i = 0; i < SFX_STREAM_PLAYERS; ++i) {
+		if (!player->stream_moved[i])
+			continue;
+		player->stream_moved[i] = 0;
+		int voice_num = player->stream_voices[i];
+		if (voice_num == -1 || !player->voices[voice_num].positional)
+			continue;
+		sources[count] = player->streams[i]->source;
+		memcpy(&positions[count++ * 3], player->voices[voice_num].position, sizeof(ALfloat) * 3);
+	}
+	if (!count && !engine->listener_moved)
+		return;
+	alUpdatePositionsSG(engine->listener_moved ? engine->listener : NULL, sources, positions, count);
+	engine->listener_moved = 0;
+}
+
+int VoiceIsPlayingAl(gsVoice voice) {
+	AlEngine *engine = CurrentAlEngine();
+	int voice_num = VoiceIndex(voice);
+	if (voice_num == -1)
+		return 0;
+	SfxVoice *sfx_voice = &engine->sfx_player->voices[voice_num];
+	ALuint source = SfxVoiceSource(engine->sfx_player, sfx_voice);
+	// Virtual voices are still playing, they just aren't mixed.
+	if (!source)
+		return 1;
+	// The voice stays valid until the next update notices it finished, so ask the source too.  Starved streams are restarted, so only ended ones are done.
+	ALint state;
+	alGetSourcei(source, AL_SOURCE_STATE, &state);
+	if (sfx_voice->stream_num != -1)
+		return state != AL_STOPPED || !engine->sfx_player->streams[sfx_voice->stream_num]->ended;
+	return state == AL_PLAYING || state == AL_PAUSED;
+}
+
+int VoiceIsVirtualAl(gsVoice voice) {
+	AlEngine *engine = CurrentAlEngine();
+	int voice_num = VoiceIndex(voice);
+	if (voice_num == -1)
+		return 0;
+	return !SfxVoiceSource(engine->sfx_player, &engine->sfx_player->voices[voice_num]);
+}
+
+void SetSfxFinishedCallbackAl(gsSfxFinishedCallback callback, void *userdata) {
+	AlEngine *engine = CurrentAlEngine();
+	engine->sfx_finished_callback = callback;
+	engine->sfx_finished_userdata = userdata;
+}
+
+int PlayBgmAl(float volume) {
+	AlEngine *engine = CurrentAlEngine();
+	alSourcef(engine->bgm_player->source, AL_GAIN, volume);
+	if (!StartPlayer(engine->bgm_player, 0)) {
+		ClosePlayerFile(engine->bgm_player);
+		return 0;
+	}
+	engine->bgm_player->ended = 0;
+	return 1;
+}
+
+int PlayBgmScheduledAl(float volume, uint64_t frame) {
+	AlEngine *engine = CurrentAlEngine();
+	alSourcef(engine->bgm_player->source, AL_GAIN, volume);
+	if (!StartPlayer(engine->bgm_player, frame)) {
+		ClosePlayerFile(engine->bgm_player);
+		return 0;
+	}
+	engine->bgm_player->ended = 0;
+	return 1;
+}
+
+uint64_t GetSoundClockAl(void) {
+	return DeviceClock();
+}
+
+int GetSoundSampleRateAl(void) {
+	AlEngine *engine = CurrentAlEngine();
+	return engine->device_frequency;
+}
+
+static Uint64 DeviceClock(void) {
+	return alcGetClockSG(alcGetContextsDevice(alcGetCurrentContext()));
+}
+
+int PlayBgmBackgroundAl(float volume) {
+	AlEngine *engine = CurrentAlEngine();
+	alSourcef(engine->background_bgm_player->source, AL_GAIN, volume);
+	if (!StartPlayer(engine->background_bgm_player, 0)) {
+		ClosePlayerFile(engine->background_bgm_player);
+		return 0;
+	}
+	engine->background_bgm_player->ended = 0;
+	return 1;
+}
+
+int PreBakeBgm(const char *filename) {
+	AlEngine *engine = CurrentAlEngine();
+	return PreBakeSeekableBgm(engine->bgm_player, filename);
+}
+
+int PreBakeBackgroundBgm(const char *filename) {
+	AlEngine *engine = CurrentAlEngine();
+	return PreBakeSeekableBgm(engine->background_bgm_player, filename);
+}
+
+static int PreBakeSeekableBgm(StreamPlayer *player, const char *filename) {
+	if (!PreBakeBgmAl(player, filename))
+		return 0;
+	// Without an index seeks fall back to vorbis bisecting, so it isn't an error.
+	BuildOggPageIndex(filename, &player->page_index);
+	return 1;
+}
+
+double BgmTellAl(int background) {
+	AlEngine *engine = CurrentAlEngine();
+	return TellPlayer(background ? engine->background_bgm_player : engine->bgm_player);
+}
+
+static double TellPlayer(StreamPlayer *player) {
+	if (!player->file_loaded)
+		return -1;
+	ALint offset = 0;
+	alGetSourcei(player->source, AL_SAMPLE_OFFSET, &offset);
+	return (double)(player->buffer_starts[player->oldest_buffer] + offset) / player->vbinfo->rate;
+}
+
+int BgmSeekAl(int background, double seconds) {
+	AlEngine *engine = CurrentAlEngine();
+	StreamPlayer *player = background ? engine->background_bgm_player : engine->bgm_player;
+	if (!player->file_loaded)
+		return 0;
+	return SeekPlayer(player, (ogg_int64_t)(seconds * player->vbinfo->rate));
+}
+
+int FadeBgmAl(int background, float volume, float seconds, int stop) {
+	AlEngine *engine = CurrentAlEngine();
+	StreamPlayer *player = background ? engine->background_bgm_player : engine->bgm_player;
+	if (!player->file_loaded)
+		return 0;
+	ALsizei frames = seconds > 0 ? (ALsizei)(seconds * engine->device_frequency) : 0;
+	if (stop && !frames)
+		return StopBgm(player);
+	// The mixer stops it on the last frame of the fade, and the update closes it after.
+	player->fade_stop = stop ? 1 : 0;
+	alSourceFadeSG(player->source, volume < 0 ? 0 : volume, frames, stop ? AL_TRUE : AL_FALSE);
+	return 1;
+}
+
+static ogg_int64_t PlayerDecodeFrame(StreamPlayer *player) {
+	return player->total_bytes_read_this_loop / (player->vbinfo->channels * sizeof(short));
+}
+
+static int SeekPlayer(StreamPlayer *player, ogg_int64_t frame) {
+	ogg_int64_t loop_end_frame = player->loop_point_end / (player->vbinfo->channels * sizeof(short));
+	if (frame < 0)
+		frame = 0;
+	// Past the loop end would never hit the loop point, so wrap it like the loop would.
+	if (frame >= loop_end_frame)
+		frame = player->loop_point_begin;
+	ALint state;
+	alGetSourcei(player->source, AL_SOURCE_STATE, &state);
+	// Stopping the source jumps its fade to the end, so remember where it was to pick it back up after.
+	ALfloat fade_gain;
+	ALint fade_frames;
+	alGetSourcef(player->source, AL_FADE_GAIN_SG, &fade_gain);
+	alGetSourcei(player->source, AL_FADE_FRAMES_SG, &fade_frames);
+	alSourceStop(player->source);
+	alSourcei(player->source, AL_BUFFER, 0);
+	player->ended = 0;
+	// The old buffers are gone, so a player that can't be refilled is stopped rather than left with nothing queued.
+	if (!SeekPlayerFile(player, frame) || !PreBakeBuffers(player)) {
+		StopBgm(player);
+		return 0;
+	}
+	if (fade_frames) {
+		ALfloat gain;
+		alGetSourcef(player->source, AL_GAIN, &gain);
+		alSourcef(player->source, AL_GAIN, fade_gain);
+		alSourceFadeSG(player->source, gain, fade_frames, player->fade_stop ? AL_TRUE : AL_FALSE);
+	}
+	// Pausing a stopped source does nothing, so a paused one is played first.  It is scheduled for a frame that never
+	// comes so the mixer can't play any of it before the pause.
+	if (state == AL_PAUSED) {
+		alSourcePlayAtSG(player->source, ~(ALuint64SG)0);
+		alSourcePause(player->source);
+	} else if (state == AL_PLAYING) {
+		alSourcePlay(player->source);
+	}
+	return 1;
+}
+
+static int SeekPlayerFile(StreamPlayer *player, ogg_int64_t frame) {
+	int frame_size = player->vbinfo->channels * sizeof(short);
+	ogg_int64_t position = SeekOggFile(&player->vbfile, &player->page_index, frame, frame_size, player->membuf);
+	if (position < 0)
+		return 0;
+	player->total_bytes_read_this_loop = position * frame_size;
+	StemFiles *stems = player->stems;
+	for (int i = 0; stems && i < stems->count; ++i) {
+		// A stem shorter than the position is left at its end, so it pads with silence instead of drifting.
+		if (SeekOggFile(&stems->files[i], &stems->page_indexes[i], position, frame_size, stems->scratch) < 0)
+			ov_raw_seek(&stems->files[i], ov_raw_total(&stems->files[i], -1));
+	}
+	return 1;
+}
+
+static ogg_int64_t SeekOggFile(OggVorbis_File *file, OggPageIndex *index, ogg_int64_t frame, int frame_size, short *scratch) {
+	int page = FindOggPage(index, frame);
+	// Vorbis can land a little after a page start, so step back until it is before the frame.
+	for (; page >= 0; --page) {
+		if (ov_raw_seek(file, index->offsets[page]) != 0) {
+			page = -1;
+			break;
+		}
+		if (ov_pcm_tell(file) <= frame)
+			break;
+	}
+	// Close to the start, or not indexed.
+	if (page < 0 && ov_pcm_seek(file, frame) != 0)
+		return -1;
+	// Decode the rest of the way, this is less than a page.
+	ogg_int64_t position = ov_pcm_tell(file);
+	while (position < frame) {
+		ogg_int64_t request_size = (frame - position) * frame_size;
+		int bytes_read = ov_read(file, (char *)scratch, request_size < BGM_BUFFER_SAMPLES ? (int)request_size : BGM_BUFFER_SAMPLES, 0, sizeof(short), 1, 0);
+		if (bytes_read <= 0)
+			break;
+		position += bytes_read / frame_size;
+	}
+	return position;
+}
+
+static void setLoopPoints(StreamPlayer *player, double *loopBegin, double *loopEnd) {
+	// Retrieve the vorbis comments
+	vorbis_comment *vc = ov_comment(&player->vbfile, -1);
+	if (!vc) {
+		fprintf(stderr, "Error retrieving vorbis comments\n");
+		return;
+	}
+	const char *start = "LOOPSTART=";
+	const char *end = "LOOPEND=";
+	for (int i = 0; i < vc->comments; ++i) {
+		char *comment = vc->user_comments[i];
+		if (strncasecmp(comment, start, strlen(start)) == 0) {
+			float startTime = atof(comment + strlen(start));
+			*loopBegin = startTime;
+		} else if (strncasecmp(comment, end, strlen(end)) == 0) {
+			float endTime = atof(comment + strlen(end));
+			*loopEnd = endTime;
+		}
+	}
+}
+
+static int PreBakeBgmAl(StreamPlayer *player, const char *filename) {
+	PROFILE_BEGIN("OpenPlayerFile", 0);
+	int opened = OpenPlayerFile(player, filename);
+	PROFILE_END();
+	if (!opened)
+		return 0;
+	alSourceRewind(player->source);
+	alSourcei(player->source, AL_BUFFER, 0);
+	PreBakeBuffers(player);
+	return 1;
+}
+
+static int PreBakeBuffers(StreamPlayer *player) {
+	ALsizei i;
+	BufferFillFlags buf_flags;
+	player->oldest_buffer = 0;
+	for (i = 0; i < BGM_NUM_BUFFERS; i++) {
+		player->buffer_starts[i] = PlayerDecodeFrame(player);
+		long bytes_read = LoadBufferData(player, &buf_flags);
+		PlayerBufferData(player, player->buffers[i], bytes_read);
+	}
+	if (alGetError() != AL_NO_ERROR) {
+		fprintf(stderr, "Error buffering for playback\n");
+		return 0;
+	}
+	alSourceQueueBuffers(player->source, i, player->buffers);
+	if (alGetError() != AL_NO_ERROR) {
+		fprintf(stderr, "Error queuing buffers for playback\n");
+		return 0;
+	}
+	return 1;
+}
+
+static int StartPlayer(StreamPlayer *player, Uint64 start_frame) {
+	// Starts at the volume it was played with, not partway through a earlier fade.
+	ALfloat gain;
+	alGetSourcef(player->source, AL_GAIN, &gain);
+	alSourceFadeSG(player->source, gain, 0, AL_FALSE);
+	player->fade_stop = 0;
+	if (start_frame)
+		alSourcePlayAtSG(player->source, start_frame);
+	else
+		alSourcePlay(player->source);
+	if (alGetError() != AL_NO_ERROR) {
+		fprintf(stderr, "Error starting playback\n");
+		return 0;
+	}
+	return 1;
+}
+
+static int OpenPlayerFile(StreamPlayer *player, const char *filename) {
+	if (player->file_loaded)
+		ClosePlayerFile(player);
+	int result = ov_fopen(filename, &player->vbfile);
+	if (result != 0) {
+		fprintf(stderr, "Could not open audio in %s: %d\n", filename, result);
 		return 0;
 	}
 	player->file_loaded = 1;
@@ -437,13 +1577,16 @@ static void GetLoopPoints(StreamPlayer *player) {
 }
 
 int StopBgmAl(void) {
-	return StopBgm(bgm_player);
+	AlEngine *engine = CurrentAlEngine();
+	return StopBgm(engine->bgm_player);
 }
 int StopBackgroundBgmAl(void) {
-	return StopBgm(background_bgm_player);
+	AlEngine *engine = CurrentAlEngine();
+	return StopBgm(engine->background_bgm_player);
 }
 
 static int StopBgm(StreamPlayer *player) {
+	player->fade_stop = 0;
 	alSourceStop(player->source);
 	alSourcei(player->source, AL_BUFFER, 0);
 	ClosePlayerFile(player);
@@ -455,100 +1598,1019 @@ static int StopBgm(StreamPlayer *player) {
 }
 
 int PauseBgmAl(void) {
-	return PauseBgm();
+	AlEngine *engine = CurrentAlEngine();
+	return PauseBgm(engine->bgm_player);
 }
 
-static int PauseBgm(void) {
+static int PauseBgm(StreamPlayer *player) {
 	ALint state;
-	alGetSourcei(bgm_player->source, AL_SOURCE_STATE, &state);
+	alGetSourcei(player->source, AL_SOURCE_STATE, &state);
 	if (state != AL_PLAYING)
 		return 0;
-	alSourcePause(bgm_player->source);
+	alSourcePause(player->source);
 	return 1;
 }
 
 int UnpauseBgmAl(void) {
+	AlEngine *engine = CurrentAlEngine();
 	ALint state;
-	alGetSourcei(bgm_player->source, AL_SOURCE_STATE, &state);
+	alGetSourcei(engine->bgm_player->source, AL_SOURCE_STATE, &state);
 	if (state == AL_PAUSED)
-		alSourcePause(bgm_player->source);
-	alSourcePlay(bgm_player->source);
+		alSourcePause(engine->bgm_player->source);
+	alSourcePlay(engine->bgm_player->source);
 	return 0;
 }
 
-Sg_Loaded_Sfx *LoadSfxFileAl(const char *filename) {
-	return LoadSfxFile(filename);
+int PreBakeStemsAl(const char *const *filenames, int count) {
+	AlEngine *engine = CurrentAlEngine();
+	StreamPlayer *player = engine->stem_player;
+	StemFiles *stems = player->stems;
+	if (count < 1 || count > GS_MAX_STEMS) {
+		fprintf(stderr, "Stems need 1 to %d files, got %d\n", GS_MAX_STEMS, count);
+		return 0;
+	}
+	alSourceStop(player->source);
+	alSourcei(player->source, AL_BUFFER, 0);
+	PROFILE_BEGIN("OpenPlayerFile", count);
+	int opened = OpenStemFiles(player, filenames, count);
+	PROFILE_END();
+	if (!opened)
+		return 0;
+	// Without an index seeks fall back to vorbis bisecting, so it isn't an error.
+	BuildOggPageIndex(filenames[0], &player->page_index);
+	for (int i = 0; i < stems->count; ++i)
+		BuildOggPageIndex(filenames[i + 1], &stems->page_indexes[i]);
+	alSourcei(player->source, AL_STEMS_SG, count);
+	for (int i = 0; i < GS_MAX_STEMS; ++i)
+		stems->gains[i] = 1.0f;
+	alSourceStemGainsSG(player->source, stems->gains, GS_MAX_STEMS, 0);
+	alSourceRewind(player->source);
+	return PreBakeBuffers(player);
 }
 
-static Sg_Loaded_Sfx *LoadSfxFile(const char *filename) {
-	// TODO Close a sfx_player
-	vorbis_info *vbinfo;
-	OggVorbis_File vbfile;
-	Sg_Loaded_Sfx *loaded_sfx;
-	loaded_sfx = calloc(1, sizeof(*loaded_sfx));
+static int OpenStemFiles(StreamPlayer *player, const char *const *filenames, int count) {
+	if (!OpenPlayerFile(player, filenames[0]))
+		return 0;
+	StemFiles *stems = player->stems;
+	int channels = player->vbinfo->channels;
+	if (count * channels > AL_MAX_STEM_CHANNELS_SG) {
+		fprintf(stderr, "%d stems of %d channels is more than the %d channels the mixer can fold\n", count, channels, AL_MAX_STEM_CHANNELS_SG);
+		ClosePlayerFile(player);
+		return 0;
+	}
+	for (int i = 1; i < count; ++i) {
+		OggVorbis_File *file = &stems->files[i - 1];
+		int result = ov_fopen(filenames[i], file);
+		if (result != 0) {
+			fprintf(stderr, "Could not open audio in %s: %d\n", filenames[i], result);
+			ClosePlayerFile(player);
+			return 0;
+		}
+		++stems->count;
+		vorbis_info *info = ov_info(file, -1);
+		if (info->channels != channels || info->rate != player->vbinfo->rate) {
+			fprintf(stderr, "Stem %s doesn't match %s, stems need the same rate and channels\n", filenames[i], filenames[0]);
+			ClosePlayerFile(player);
+			return 0;
+		}
+	}
+	return 1;
+}
 
-	int result = ov_fopen(filename, &vbfile);
-	if (result != 0) {
-		fprintf(stderr, "Could not open audio in %s: %d\n", filename, result);
+int PlayStemsAl(float volume) {
+	AlEngine *engine = CurrentAlEngine();
+	if (!engine->stem_player->file_loaded)
+		return 0;
+	alSourcef(engine->stem_player->source, AL_GAIN, volume);
+	if (!StartPlayer(engine->stem_player, 0)) {
+		ClosePlayerFile(engine->stem_player);
+		return 0;
+	}
+	engine->stem_player->ended = 0;
+	return 1;
+}
+
+int StopStemsAl(void) {
+	AlEngine *engine = CurrentAlEngine();
+	return StopBgm(engine->stem_player);
+}
+
+int PauseStemsAl(void) {
+	AlEngine *engine = CurrentAlEngine();
+	return PauseBgm(engine->stem_player);
+}
+
+int UnpauseStemsAl(void) {
+	AlEngine *engine = CurrentAlEngine();
+	ALint state;
+	alGetSourcei(engine->stem_player->source, AL_SOURCE_STATE, &state);
+	if (state != AL_PAUSED)
+		return 0;
+	alSourcePlay(engine->stem_player->source);
+	return 1;
+}
+
+int SetStemGainAl(int stem, float gain, float seconds) {
+	AlEngine *engine = CurrentAlEngine();
+	StemFiles *stems = engine->stem_player->stems;
+	if (!engine->stem_player->file_loaded || stem < 0 || stem > stems->count)
 		return 0;
+	stems->gains[stem] = gain < 0 ? 0 : gain;
+	// The mixer ramps in device frames, since that is where the stems are folded.
+	alSourceStemGainsSG(engine->stem_player->source, stems->gains, stem + 1, seconds > 0 ? (ALsizei)(seconds * engine->device_frequency) : 0);
+	return 1;
+}
+
+double StemsTellAl(void) {
+	AlEngine *engine = CurrentAlEngine();
+	return TellPlayer(engine->stem_player);
+}
+
+int StemsSeekAl(double seconds) {
+	AlEngine *engine = CurrentAlEngine();
+	if (!engine->stem_player->file_loaded)
+		return 0;
+	return SeekPlayer(engine->stem_player, (ogg_int64_t)(seconds * engine->stem_player->vbinfo->rate));
+}
+
+int SetBusVolumeAl(gsBus bus, float volume) {
+	AlEngine *engine = CurrentAlEngine();
+	if (bus < gsBus_Master || bus >= GS_MAX_BUSES)
+		return 0;
+	engine->bus_volumes[bus] = volume < 0 ? 0 : volume;
+	alBusfSG((ALuint)bus, AL_GAIN, engine->bus_volumes[bus]);
+	UpdateBusVoices(engine->sfx_player);
+	return 1;
+}
+
+int SetBusMutedAl(gsBus bus, int muted) {
+	AlEngine *engine = CurrentAlEngine();
+	if (bus < gsBus_Master || bus >= GS_MAX_BUSES)
+		return 0;
+	engine->bus_muted[bus] = muted != 0;
+	alBusiSG((ALuint)bus, AL_BUS_MUTED_SG, muted);
+	UpdateBusVoices(engine->sfx_player);
+	return 1;
+}
+
+int SetBusPausedAl(gsBus bus, int paused) {
+	AlEngine *engine = CurrentAlEngine();
+	if (bus < gsBus_Master || bus >= GS_MAX_BUSES)
+		return 0;
+	engine->bus_paused[bus] = paused != 0;
+	alBusiSG((ALuint)bus, AL_BUS_PAUSED_SG, paused);
+	UpdateBusVoices(engine->sfx_player);
+	return 1;
+}
+
+int SetBusParentAl(gsBus bus, gsBus parent) {
+	AlEngine *engine = CurrentAlEngine();
+	// Parents coming first is what lets the mixer work out every bus in one pass.
+	if (bus <= gsBus_Master || bus >= GS_MAX_BUSES || parent < gsBus_Master || parent >= bus)
+		return 0;
+	engine->bus_parents[bus] = parent;
+	alBusiSG((ALuint)bus, AL_BUS_PARENT_SG, (ALint)parent);
+	UpdateBusVoices(engine->sfx_player);
+	return 1;
+}
+
+static float BusGain(gsBus bus) {
+	AlEngine *engine = CurrentAlEngine();
+	float gain = 1.0f;
+	for (;;) {
+		if (engine->bus_muted[bus])
+			return 0;
+		gain *= engine->bus_volumes[bus];
+		if (bus == gsBus_Master)
+			return gain;
+		bus = engine->bus_parents[bus];
+	}
+}
+
+static int BusPaused(gsBus bus) {
+	AlEngine *engine = CurrentAlEngine();
+	for (;;) {
+		if (engine->bus_paused[bus])
+			return 1;
+		if (bus == gsBus_Master)
+			return 0;
+		bus = engine->bus_parents[bus];
+	}
+}
+
+static void UpdateBusVoices(SfxPlayer *player) {
+	if (!player)
+		return;
+	Uint64 clock = DeviceClock();
+	for (int i = 0; i < player->num_virtual_voices; ++i) {
+		SfxVoice *sfx_voice = &player->voices[player->virtual_voices[i]];
+		int paused = BusPaused(SfxVoiceBus(sfx_voice));
+		if (paused == sfx_voice->bus_paused)
+			continue;
+		// Where it is as of now, held or not.  A start still to come stays on the device clock like the mixer's.
+		Sint64 offset = VirtualVoiceOffset(sfx_voice, clock);
+		if (paused && !sfx_voice->start_frame)
+			sfx_voice->virtual_offset = offset;
+		sfx_voice->virtual_since = clock;
+		sfx_voice->bus_paused = paused;
+	}
+	CullRealSfxVoices(player);
+}
+
+Sg_Loaded_Sfx *LoadSfxFileAl(const char *filename, int stream, gsArena *arena) {
+	PROFILE_BEGIN("LoadSfxFile", stream);
+	Sg_Loaded_Sfx *loaded_sfx = LoadSfxFile(filename, stream, arena);
+	PROFILE_END();
+	return loaded_sfx;
+}
+
+static Sg_Loaded_Sfx *LoadSfxFile(const char *filename, int stream, gsArena *arena) {
+	AlEngine *engine = CurrentAlEngine();
+	OggMemory memory;
+	OggVorbis_File vbfile;
+	int channels;
+	Sg_Loaded_Sfx *loaded_sfx = AssetMalloc(arena, sizeof(*loaded_sfx));
+	memset(loaded_sfx, 0, sizeof(*loaded_sfx));
+	loaded_sfx->encoded_data = MapSoundFile(filename, &loaded_sfx->encoded_size, &loaded_sfx->mapped, arena);
+	if (!loaded_sfx->encoded_data) {
+		fprintf(stderr, "Could not open audio in %s: %s\n", filename, SDL_GetError());
+		AssetFree(loaded_sfx);
+		return NULL;
+	}
+	if (IsWav(loaded_sfx->encoded_data, loaded_sfx->encoded_size)) {
+		// Nothing to decode, the samples are used straight from the file.
+		if (!ParseWav(loaded_sfx->encoded_data, loaded_sfx->encoded_size, &loaded_sfx->wav)) {
+			fprintf(stderr, "Unsupported wav format in %s\n", filename);
+			UnmapSoundFile(loaded_sfx->encoded_data, loaded_sfx->encoded_size, loaded_sfx->mapped);
+			AssetFree(loaded_sfx);
+			return NULL;
+		}
+		channels = loaded_sfx->wav.channels;
+		loaded_sfx->sample_rate = loaded_sfx->wav.sample_rate;
+		loaded_sfx->frames = loaded_sfx->wav.frames;
+	} else if (OpenSfxOgg(loaded_sfx, &memory, &vbfile)) {
+		vorbis_info *vbinfo = ov_info(&vbfile, -1);
+		channels = vbinfo->channels;
+		loaded_sfx->sample_rate = vbinfo->rate;
+		loaded_sfx->frames = ov_pcm_total(&vbfile, -1);
+		ov_clear(&vbfile);
+	} else {
+		fprintf(stderr, "Could not open audio in %s, it isn't vorbis or wav\n", filename);
+		UnmapSoundFile(loaded_sfx->encoded_data, loaded_sfx->encoded_size, loaded_sfx->mapped);
+		AssetFree(loaded_sfx);
+		return NULL;
 	}
-	vbinfo = ov_info(&vbfile, -1);
-	if (vbinfo->channels == 1) {
+	if (channels == 1) {
 		loaded_sfx->format = AL_FORMAT_MONO16;
 	} else {
 		loaded_sfx->format = AL_FORMAT_STEREO16;
 	}
-	if (!loaded_sfx->format) {
-		fprintf(stderr, "Unsupported channel count: %d\n", vbinfo->channels);
-		ov_clear(&vbfile);
+	loaded_sfx->size = loaded_sfx->frames * channels * sizeof(short);
+	loaded_sfx->pcm_bytes = engine->compress_sfx ? ImaAdpcmSize(loaded_sfx->frames, channels) : loaded_sfx->frames * channels * sizeof(float);
+	if (!loaded_sfx->wav.samples && (stream || (engine->sfx_stream_seconds >= 0 && loaded_sfx->frames > engine->sfx_stream_seconds * loaded_sfx->sample_rate))) {
+		// Too long to keep decoded, it is opened again and streamed every time it plays.
+		UnmapSoundFile(loaded_sfx->encoded_data, loaded_sfx->encoded_size, loaded_sfx->mapped);
+		loaded_sfx->encoded_data = NULL;
+		loaded_sfx->encoded_size = 0;
+		size_t name_length = strlen(filename) + 1;
+		loaded_sfx->filename = AssetMalloc(arena, name_length);
+		memcpy(loaded_sfx->filename, filename, name_length);
+		loaded_sfx->streamed = 1;
+		return loaded_sfx;
+	}
+	engine->pcm_cache.stats.encoded_bytes += loaded_sfx->encoded_size;
+	// Decode now if it fits, otherwise the first play decodes it.
+	if (ReservePcm(loaded_sfx->pcm_bytes) && !DecodeSfx(loaded_sfx)) {
+		fprintf(stderr, "Could not buffer sfx %s\n", filename);
+		CloseSfxFileAl(loaded_sfx);
+		return NULL;
+	}
+	return loaded_sfx;
+}
+
+static int OpenSfxOgg(Sg_Loaded_Sfx *loaded_sfx, OggMemory *memory, OggVorbis_File *vbfile) {
+	ov_callbacks callbacks = {OggMemoryRead, OggMemorySeek, NULL, OggMemoryTell};
+	memory->data = loaded_sfx->encoded_data;
+	memory->size = loaded_sfx->encoded_size;
+	memory->position = 0;
+	return ov_open_callbacks(memory, vbfile, NULL, 0, callbacks) == 0;
+}
+
+static size_t OggMemoryRead(void *ptr, size_t size, size_t nmemb, void *datasource) {
+	OggMemory *memory = datasource;
+	if (!size)
+		return 0;
+	size_t count = (memory->size - memory->position) / size;
+	if (count > nmemb)
+		count = nmemb;
+	memcpy(ptr, memory->data + memory->position, count * size);
+	memory->position += count * size;
+	return count;
+}
+
+static int OggMemorySeek(void *datasource, ogg_int64_t offset, int whence) {
+	OggMemory *memory = datasource;
+	ogg_int64_t position;
+	switch (whence) {
+		case SEEK_SET:
+			position = offset;
+			break;
+		case SEEK_CUR:
+			position = (ogg_int64_t)memory->position + offset;
+			break;
+		case SEEK_END:
+			position = (ogg_int64_t)memory->size + offset;
+			break;
+		default:
+			return -1;
+	}
+	if (position < 0 || position > (ogg_int64_t)memory->size)
+		return -1;
+	memory->position = (size_t)position;
+	return 0;
+}
+
+static long OggMemoryTell(void *datasource) {
+	return (long)((OggMemory *)datasource)->position;
+}
+
+static int DecodeSfx(Sg_Loaded_Sfx *loaded_sfx) {
+	AlEngine *engine = CurrentAlEngine();
+	int channels = loaded_sfx->format == AL_FORMAT_MONO16 ? 1 : 2;
+	ALenum format = loaded_sfx->format;
+	const void *samples;
+	void *converted = NULL;
+	int bytes;
+	PROFILE_BEGIN("DecodeSfx", loaded_sfx->pcm_bytes);
+	if (loaded_sfx->wav.samples) {
+		samples = WavSfxSamples(loaded_sfx, &format, &converted);
+		bytes = loaded_sfx->wav.frames * channels * (format == loaded_sfx->format ? sizeof(short) : sizeof(float));
+	} else {
+		samples = converted = DecodeVorbisSfx(loaded_sfx, &bytes);
+	}
+	PROFILE_END();
+	if (!samples)
+		return 0;
+	unsigned char *encoded = NULL;
+	size_t encoded_size = 0;
+	size_t encoded_frames = 0;
+	if (engine->compress_sfx) {
+		int is_float = format != loaded_sfx->format;
+		const short *pcm16 = is_float ? FloatToPcm16(samples, bytes / sizeof(float)) : samples;
+		encoded_frames = bytes / (channels * (is_float ? sizeof(float) : sizeof(short)));
+		if (pcm16)
+			encoded = EncodeImaAdpcm(pcm16, encoded_frames, channels, &encoded_size);
+		if (is_float)
+			SoundFree((short *)pcm16);
+	}
+	// Every voice of this sfx plays the same buffer.  The mixer keeps its own converted copy, so ours isn't needed after.
+	alGenBuffers(1, &loaded_sfx->buffer);
+	if (encoded) {
+		alBufferData(loaded_sfx->buffer, channels == 1 ? AL_FORMAT_MONO_IMA4 : AL_FORMAT_STEREO_IMA4, encoded, encoded_size, loaded_sfx->sample_rate);
+		// The last block is padded to a whole block, trim it so loops don't have a gap and the length matches the file.
+		alBufferi(loaded_sfx->buffer, AL_BUFFER_FRAMES_SG, (ALint)encoded_frames);
+	} else
+		alBufferData(loaded_sfx->buffer, format, samples, bytes, loaded_sfx->sample_rate);
+	SoundFree(encoded);
+	SoundFree(converted);
+	if (alGetError() != AL_NO_ERROR) {
+		alDeleteBuffers(1, &loaded_sfx->buffer);
+		loaded_sfx->buffer = 0;
 		return 0;
 	}
-	loaded_sfx->sample_rate = vbinfo->rate;
+	engine->pcm_cache.stats.pcm_bytes += loaded_sfx->pcm_bytes;
+	TouchSfxPcm(loaded_sfx);
+	return 1;
+}
 
-	// Get the size of the file in pcm.
-	loaded_sfx->size = ov_pcm_total(&vbfile, -1) * vbinfo->channels * sizeof(short);
-	loaded_sfx->sound_data = malloc(loaded_sfx->size);
+static short *DecodeVorbisSfx(Sg_Loaded_Sfx *loaded_sfx, int *bytes) {
+	OggMemory memory;
+	OggVorbis_File vbfile;
+	if (!OpenSfxOgg(loaded_sfx, &memory, &vbfile))
+		return NULL;
+	char *sound_data = SoundMalloc(loaded_sfx->size);
 	int total_buffer_bytes_read = 0;
-	int fully_loaded = 0;
-	while (!fully_loaded) {
-		int bytes_read = ov_read(&vbfile, (char *)loaded_sfx->sound_data + total_buffer_bytes_read, VORBIS_REQUEST_SIZE, 0, sizeof(short), 1, 0);
+	while (total_buffer_bytes_read < loaded_sfx->size) {
+		int request_size = loaded_sfx->size - total_buffer_bytes_read;
+		if (request_size > VORBIS_REQUEST_SIZE)
+			request_size = VORBIS_REQUEST_SIZE;
+		long bytes_read = ov_read(&vbfile, sound_data + total_buffer_bytes_read, request_size, 0, sizeof(short), 1, 0);
+		if (bytes_read <= 0)
+			break;
 		total_buffer_bytes_read += bytes_read;
-		if (bytes_read == 0)
-			fully_loaded = 1;
 	}
 	ov_clear(&vbfile);
-	return loaded_sfx;
+	*bytes = total_buffer_bytes_read;
+	return (short *)sound_data;
+}
+
+static const void *WavSfxSamples(Sg_Loaded_Sfx *loaded_sfx, ALenum *format, void **converted) {
+	WavInfo *wav = &loaded_sfx->wav;
+	*converted = NULL;
+	if (wav->bits == 16) {
+		*format = wav->channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+		return wav->samples;
+	}
+	*format = wav->channels == 1 ? AL_FORMAT_MONO_FLOAT32 : AL_FORMAT_STEREO_FLOAT32;
+	if (wav->is_float)
+		return wav->samples;
+	// The mixer has no 24 bit format, so widen it to float.
+	size_t count = wav->frames * wav->channels;
+	float *samples = SoundMalloc(count * sizeof(float));
+	if (!samples)
+		return NULL;
+	for (size_t i = 0; i < count; ++i) {
+		const unsigned char *sample = wav->samples + i * 3;
+		int32_t value = (int32_t)((uint32_t)sample[0] << 8 | (uint32_t)sample[1] << 16 | (uint32_t)sample[2] << 24) >> 8;
+		samples[i] = value * (1.0f / 8388608.0f);
+	}
+	*converted = samples;
+	return samples;
+}
+
+static short *FloatToPcm16(const void *samples, size_t count) {
+	short *pcm16 = SoundMalloc(count * sizeof(short));
+	if (!pcm16)
+		return NULL;
+	for (size_t i = 0; i < count; ++i) {
+		float sample;
+		// Mapped wav samples aren't always aligned for floats.
+		memcpy(&sample, (const char *)samples + i * sizeof(float), sizeof(float));
+		sample = sample > 1.0f ? 1.0f : sample < -1.0f ? -1.0f : sample;
+		pcm16[i] = (short)(sample * 32767.0f);
+	}
+	return pcm16;
+}
+
+static int MakeSfxResident(Sg_Loaded_Sfx *loaded_sfx) {
+	AlEngine *engine = CurrentAlEngine();
+	if (loaded_sfx->buffer) {
+		++engine->pcm_cache.stats.pcm_hits;
+		TouchSfxPcm(loaded_sfx);
+		return 1;
+	}
+	++engine->pcm_cache.stats.pcm_misses;
+	if (!ReservePcm(loaded_sfx->pcm_bytes) || !DecodeSfx(loaded_sfx)) {
+		++engine->pcm_cache.stats.pcm_failures;
+		return 0;
+	}
+	return 1;
+}
+
+static int ReservePcm(size_t bytes) {
+	AlEngine *engine = CurrentAlEngine();
+	if (!engine->pcm_cache.budget)
+		return 1;
+	Sg_Loaded_Sfx *loaded_sfx = engine->pcm_cache.oldest;
+	while (loaded_sfx && engine->pcm_cache.stats.pcm_bytes + bytes > engine->pcm_cache.budget) {
+		Sg_Loaded_Sfx *newer = loaded_sfx->newer;
+		// Playing voices, real or virtual, still need their buffer.
+		if (!loaded_sfx->instances)
+			EvictSfxPcm(loaded_sfx);
+		loaded_sfx = newer;
+	}
+	return engine->pcm_cache.stats.pcm_bytes + bytes <= engine->pcm_cache.budget;
+}
+
+static void EvictSfxPcm(Sg_Loaded_Sfx *loaded_sfx) {
+	AlEngine *engine = CurrentAlEngine();
+	UnlinkSfxPcm(loaded_sfx);
+	alDeleteBuffers(1, &loaded_sfx->buffer);
+	loaded_sfx->buffer = 0;
+	engine->pcm_cache.stats.pcm_bytes -= loaded_sfx->pcm_bytes;
+	++engine->pcm_cache.stats.pcm_evictions;
+}
+
+static void TouchSfxPcm(Sg_Loaded_Sfx *loaded_sfx) {
+	AlEngine *engine = CurrentAlEngine();
+	UnlinkSfxPcm(loaded_sfx);
+	loaded_sfx->older = engine->pcm_cache.newest;
+	if (engine->pcm_cache.newest)
+		engine->pcm_cache.newest->newer = loaded_sfx;
+	else
+		engine->pcm_cache.oldest = loaded_sfx;
+	engine->pcm_cache.newest = loaded_sfx;
+}
+
+static void UnlinkSfxPcm(Sg_Loaded_Sfx *loaded_sfx) {
+	AlEngine *engine = CurrentAlEngine();
+	if (loaded_sfx->newer)
+		loaded_sfx->newer->older = loaded_sfx->older;
+	else if (engine->pcm_cache.newest == loaded_sfx)
+		engine->pcm_cache.newest = loaded_sfx->older;
+	if (loaded_sfx->older)
+		loaded_sfx->older->newer = loaded_sfx->newer;
+	else if (engine->pcm_cache.oldest == loaded_sfx)
+		engine->pcm_cache.oldest = loaded_sfx->newer;
+	loaded_sfx->newer = loaded_sfx->older = NULL;
+}
+
+void SetPcmBudgetAl(size_t bytes) {
+	AlEngine *engine = CurrentAlEngine();
+	engine->pcm_cache.budget = bytes;
+	ReservePcm(0);
+}
+
+void GetSoundStatsAl(gsSoundStats *stats) {
+	AlEngine *engine = CurrentAlEngine();
+	*stats = engine->pcm_cache.stats;
+	stats->pcm_budget = engine->pcm_cache.budget;
+}
+
+int GetCallbackTimingAl(gsCallbackTiming *timing, int reset) {
+	ALCcontext *context = alcGetCurrentContext();
+	ALCcallbackTimingSG device_timing;
+	if (!context || !alcGetCallbackTimingSG(alcGetContextsDevice(context), &device_timing, reset ? ALC_TRUE : ALC_FALSE))
+		return 0;
+	memset(timing, 0, sizeof(*timing));
+	timing->callbacks = device_timing.callbacks;
+	timing->overruns = device_timing.overruns;
+	timing->deadline_ms = device_timing.deadline_usec / 1000.0f;
+	timing->max_ms = device_timing.max_usec / 1000.0f;
+	if (device_timing.deadline_usec)
+		timing->max_load = (float)device_timing.max_usec / device_timing.deadline_usec;
+	// Walks the buckets up to the ones holding the 50th and 99th percentile mix, and reports their upper edge.
+	unsigned long counted = 0;
+	unsigned long p50 = (device_timing.callbacks + 1) / 2;
+	unsigned long p99 = device_timing.callbacks - device_timing.callbacks / 100;
+	for (int i = 0; i < ALC_TIMING_BUCKETS_SG && counted < p99; ++i) {
+		counted += device_timing.buckets[i];
+		float load = (float)(i + 1) / ALC_TIMING_BUCKETS_PER_DEADLINE_SG;
+		if (counted >= p50 && !timing->p50_load)
+			timing->p50_load = load;
+		if (counted >= p99)
+			timing->p99_load = load;
+	}
+	timing->p50_ms = timing->p50_load * timing->deadline_ms;
+	timing->p99_ms = timing->p99_load * timing->deadline_ms;
+	return 1;
 }
 
 int CloseSfxFileAl(Sg_Loaded_Sfx *loaded_sfx) {
+	AlEngine *engine = CurrentAlEngine();
 	if (!loaded_sfx)
 		return 1;
-	free(loaded_sfx->sound_data);
+	if (loaded_sfx->buffer) {
+		UnlinkSfxPcm(loaded_sfx);
+		alDeleteBuffers(1, &loaded_sfx->buffer);
+		engine->pcm_cache.stats.pcm_bytes -= loaded_sfx->pcm_bytes;
+	}
+	if (loaded_sfx->encoded_data) {
+		engine->pcm_cache.stats.encoded_bytes -= loaded_sfx->encoded_size;
+		UnmapSoundFile(loaded_sfx->encoded_data, loaded_sfx->encoded_size, loaded_sfx->mapped);
+	}
+	AssetFree(loaded_sfx->filename);
+	SoundFree(loaded_sfx->sound_data);
 	loaded_sfx->sound_data = NULL;
-	free(loaded_sfx);
+	AssetFree(loaded_sfx);
 	loaded_sfx = NULL;
 	return (loaded_sfx == NULL) ? 1 : 0;
 }
 
-static int PlaySfxFile(SfxPlayer *player, Sg_Loaded_Sfx *sfx_file, float volume) {
-	if (player->free_buffers_stack->size == 0) {
+static gsVoice PlaySfxFile(SfxPlayer *player, const gsPlayRequest *request) {
+	AlEngine *engine = CurrentAlEngine();
+	gsVoice voice = SlotMapInsert(player->voice_slots);
+	if (!voice) {
+		return 0;
+	}
+	int voice_num = SlotMapIndex(player->voice_slots, voice);
+	SfxVoice *sfx_voice = &player->voices[voice_num];
+	sfx_voice->sfx = request->sfx;
+	sfx_voice->gain = request->volume;
+	sfx_voice->pitch = request->pitch > 0 ? request->pitch : 1.0f;
+	sfx_voice->pan = request->pan < -1.0f ? -1.0f : request->pan > 1.0f ? 1.0f : request->pan;
+	sfx_voice->priority = request->sfx->priority;
+	sfx_voice->looping = request->looping;
+#ifdef GN_SOUND_NO_3D
+	// Built without 3D, the mixer can't place it so it isn't faded or culled by distance either.
+	sfx_voice->positional = 0;
+#else
+	sfx_voice->positional = request->positional;
+#endif
+	memcpy(sfx_voice->position, request->position, sizeof(sfx_voice->position));
+	sfx_voice->occluded = 0;
+	sfx_voice->fade_frames = 0;
+	sfx_voice->audible_gain = SfxVoiceAudibleGain(sfx_voice);
+	sfx_voice->source_num = -1;
+	sfx_voice->stream_num = -1;
+	sfx_voice->virtual_num = -1;
+	sfx_voice->virtual_offset = 0;
+	sfx_voice->virtual_since = DeviceClock();
+	sfx_voice->bus_paused = BusPaused(SfxVoiceBus(sfx_voice));
+	sfx_voice->start_frame = request->start_frame;
+	sfx_voice->stop_scheduled = 0;
+	if (request->sfx->loaded_sfx->streamed) {
+		if (StartSfxStream(player, voice_num))
+			return voice;
+		sfx_voice->sfx = NULL;
+		SlotMapRemove(player->voice_slots, voice);
+		return 0;
+	}
+	int source_num = sfx_voice->audible_gain >= engine->cull_gain ? AcquireSfxSource(player, voice_num) : -1;
+	if (source_num != -1) {
+		RealizeSfxVoice(player, voice_num, source_num);
+	} else {
+		sfx_voice->virtual_num = player->num_virtual_voices;
+		player->virtual_voices[player->num_virtual_voices++] = voice_num;
+	}
+	return voice;
+}
+
+static int StartSfxStream(SfxPlayer *player, int voice_num) {
+	int stream_num = -1;
+	for (int i = 0; i < SFX_STREAM_PLAYERS; ++i) {
+		if (player->stream_voices[i] == -1) {
+			stream_num = i;
+			break;
+		}
+	}
+	if (stream_num == -1)
+		return 0;
+	SfxVoice *sfx_voice = &player->voices[voice_num];
+	StreamPlayer *stream = player->streams[stream_num];
+	if (!PreBakeBgmAl(stream, sfx_voice->sfx->loaded_sfx->filename))
+		return 0;
+	ALsourceStartSG placement;
+	PlaceSfxVoice(sfx_voice, &placement);
+	alSourcef(stream->source, AL_GAIN, sfx_voice->gain);
+	alSourcef(stream->source, AL_PITCH, sfx_voice->pitch);
+	alSourcefv(stream->source, AL_POSITION, placement.position);
+	alSourcei(stream->source, AL_SOURCE_RELATIVE, placement.relative);
+	alSourcef(stream->source, AL_REFERENCE_DISTANCE, placement.reference_distance);
+	alSourcef(stream->source, AL_MAX_DISTANCE, placement.max_distance);
+	alSourcef(stream->source, AL_ROLLOFF_FACTOR, placement.rolloff_factor);
+	alSourcei(stream->source, AL_BUS_SG, (ALint)placement.bus);
+	stream->loops = sfx_voice->looping ? 255 : 0;
+	stream->ended = 0;
+	if (!StartPlayer(stream, sfx_voice->start_frame)) {
+		StopBgm(stream);
+		return 0;
+	}
+	if (sfx_voice->stop_scheduled)
+		alSourceStopAtSG(stream->source, sfx_voice->stop_frame);
+	// Streams are never virtual, so there is nothing left to keep time against.
+	sfx_voice->start_frame = 0;
+	sfx_voice->stream_num = stream_num;
+	player->stream_voices[stream_num] = voice_num;
+	return 1;
+}
+
+static int UpdateSfxStream(SfxPlayer *player, int stream_num) {
+	StreamPlayer *stream = player->streams[stream_num];
+	ALint processed_buffers, state;
+	alGetSourcei(stream->source, AL_SOURCE_STATE, &state);
+	alGetSourcei(stream->source, AL_BUFFERS_PROCESSED, &processed_buffers);
+	// Stopped on its scheduled frame, so there is nothing to refill.
+	int voice_num = player->stream_voices[stream_num];
+	if (state == AL_STOPPED && voice_num != -1 && SfxVoiceStopPassed(&player->voices[voice_num], DeviceClock()))
 		return 0;
+	// Once it ended, let the queued buffers play out instead of filling them with nothing.
+	while (!stream->ended && processed_buffers > 0) {
+		HandleProcessedBuffer(stream);
+		--processed_buffers;
 	}
-	int buffer_num = PopStack(player->free_buffers_stack);
-	alSourceRewind(sfx_player->sources[buffer_num]);
-	alSourcei(sfx_player->sources[buffer_num], AL_BUFFER, 0);
-	alSourcef(sfx_player->sources[buffer_num], AL_GAIN, volume);
-	alBufferData(sfx_player->buffers[buffer_num], sfx_file->format, sfx_file->sound_data, sfx_file->size, sfx_file->sample_rate);
-	alSourceQueueBuffers(sfx_player->sources[buffer_num], 1, &sfx_player->buffers[buffer_num]);
-	alSourcePlay(sfx_player->sources[buffer_num]);
-	VectorPushBack(player->playing_buffers_vector, buffer_num);
+	if (state != AL_STOPPED)
+		return 1;
+	if (stream->ended)
+		return 0;
+	// Starved, the update came too late to refill it.
+	alSourcePlay(stream->source);
 	return 1;
 }
 
+static int SfxVoiceStopPassed(SfxVoice *voice, Uint64 clock) {
+	return voice->stop_scheduled && clock >= voice->stop_frame;
+}
+
+static float SfxVoiceGain(const SfxVoice *voice) {
+	Uint64 left = SfxVoiceFadeLeft(voice);
+	if (!left)
+		return voice->gain;
+	return voice->gain + (voice->fade_from - voice->gain) * ((float)left / (float)voice->fade_frames);
+}
+
+static Uint64 SfxVoiceFadeLeft(const SfxVoice *voice) {
+	if (!voice->fade_frames)
+		return 0;
+	Uint64 clock = DeviceClock();
+	Uint64 end = voice->fade_start + voice->fade_frames;
+	return clock < end ? end - clock : 0;
+}
+
+static int SfxStreamIndex(SfxPlayer *player, ALuint source) {
+	for (int i = 0; i < SFX_STREAM_PLAYERS; ++i) {
+		if (player->streams[i]->source == source)
+			return i;
+	}
+	return -1;
+}
+
+static ALuint SfxVoiceSource(SfxPlayer *player, SfxVoice *voice) {
+	if (voice->stream_num != -1)
+		return player->streams[voice->stream_num]->source;
+	if (voice->source_num != -1)
+		return player->sources[voice->source_num];
+	return 0;
+}
+
+static int VoiceOutranks(SfxVoice *a, SfxVoice *b) {
+	if (a->priority != b->priority)
+		return a->priority > b->priority;
+	return a->audible_gain > b->audible_gain;
+}
+
+static int AcquireSfxSource(SfxPlayer *player, int voice_num) {
+	if (player->free_sources_stack->size)
+		return PopStack(player->free_sources_stack);
+	int weakest = -1;
+	for (int i = 0; i < MAX_SFX_SOUNDS; ++i) {
+		int real_num = player->source_voices[i];
+		if (weakest == -1 || VoiceOutranks(&player->voices[player->source_voices[weakest]], &player->voices[real_num]))
+			weakest = i;
+	}
+	if (!VoiceOutranks(&player->voices[voice_num], &player->voices[player->source_voices[weakest]]))
+		return -1;
+	VirtualizeSfxVoice(player, player->source_voices[weakest]);
+	return PopStack(player->free_sources_stack);
+}
+
+static void RealizeSfxVoice(SfxPlayer *player, int voice_num, int source_num) {
+	SfxVoice *sfx_voice = &player->voices[voice_num];
+	Sint64 offset = 0;
+	if (sfx_voice->virtual_num != -1) {
+		offset = VirtualVoiceOffset(sfx_voice, DeviceClock());
+		RemoveVirtualVoice(player, voice_num);
+	}
+	// Picks back up where it would be if it had been mixed the whole time.  A one shot past its end just stops on the next mix.
+	if (offset > sfx_voice->sfx->loaded_sfx->frames)
+		offset = sfx_voice->sfx->loaded_sfx->frames;
+	// Still waiting to start, the mixer holds it until its start frame.
+	if (offset < 0)
+		offset = 0;
+	// Reuse the start if this source was already set up this flush, so there is only ever one per source.
+	int pending = player->source_pending[source_num];
+	if (pending == -1) {
+		pending = player->num_pending_starts++;
+		player->source_pending[source_num] = pending;
+	}
+	ALsourceStartSG *start = &player->pending_starts[pending];
+	start->source = player->sources[source_num];
+	start->buffer = sfx_voice->sfx->loaded_sfx->buffer;
+	start->gain = SfxVoiceGain(sfx_voice);
+	start->pitch = sfx_voice->pitch;
+	PlaceSfxVoice(sfx_voice, start);
+	start->looping = sfx_voice->looping ? AL_TRUE : AL_FALSE;
+	start->sample_offset = (ALint)offset;
+	start->start_frame = sfx_voice->start_frame;
+	sfx_voice->source_num = source_num;
+	player->source_voices[source_num] = voice_num;
+}
+
+static void FlushSfxStarts(SfxPlayer *player) {
+	if (!player->num_pending_starts)
+		return;
+	// Starts that were virtualized again before the flush have no source.
+	int count = 0;
+	for (int i = 0; i < player->num_pending_starts; ++i) {
+		if (player->pending_starts[i].source)
+			player->pending_starts[count++] = player->pending_starts[i];
+	}
+	alSourceStartBatchSG(player->pending_starts, count);
+	player->num_pending_starts = 0;
+	for (int i = 0; i < MAX_SFX_SOUNDS; ++i) {
+		int voice_num = player->source_voices[i];
+		if (player->source_pending[i] != -1 && voice_num != -1) {
+			SfxVoice *sfx_voice = &player->voices[voice_num];
+			// Playing a source cancels its stop, so scheduled stops go in after the start.
+			if (sfx_voice->stop_scheduled)
+				alSourceStopAtSG(player->sources[i], sfx_voice->stop_frame);
+			// It started where its fade is, so the rest of the fade carries on from there.
+			Uint64 fade_left = SfxVoiceFadeLeft(sfx_voice);
+			if (fade_left)
+				alSourceFadeSG(player->sources[i], sfx_voice->gain, (ALsizei)fade_left, AL_FALSE);
+		}
+		player->source_pending[i] = -1;
+	}
+}
+
+static void VirtualizeSfxVoice(SfxPlayer *player, int voice_num) {
+	SfxVoice *sfx_voice = &player->voices[voice_num];
+	ALuint source = player->sources[sfx_voice->source_num];
+	int pending = player->source_pending[sfx_voice->source_num];
+	if (pending == -1) {
+		ALint state;
+		alGetSourcei(source, AL_SOURCE_STATE, &state);
+		// It played to its end or its stop and the update hasn't seen it yet, virtualizing it would start it over.
+		if (state == AL_STOPPED) {
+			FinishSfxVoice(player, voice_num);
+			return;
+		}
+	}
+	ALint offset = 0;
+	if (pending != -1) {
+		// Never started, so there is nothing to stop.  Drop the start but keep its place for the next voice on this source.
+		offset = player->pending_starts[pending].sample_offset;
+		player->pending_starts[pending].source = 0;
+	} else {
+		alGetSourcei(source, AL_SAMPLE_OFFSET, &offset);
+		alSourceStop(source);
+		alSourcei(source, AL_BUFFER, 0);
+		// Once the mixer started it, the offset is where it is.
+		if (sfx_voice->start_frame && DeviceClock() >= sfx_voice->start_frame)
+			sfx_voice->start_frame = 0;
+	}
+	player->source_voices[sfx_voice->source_num] = -1;
+	PushStack(player->free_sources_stack, sfx_voice->source_num);
+	sfx_voice->source_num = -1;
+	sfx_voice->virtual_offset = offset;
+	sfx_voice->virtual_since = DeviceClock();
+	// A source on a paused bus is held by the mixer, so offset is already where it is held.
+	sfx_voice->bus_paused = BusPaused(SfxVoiceBus(sfx_voice));
+	sfx_voice->virtual_num = player->num_virtual_voices;
+	player->virtual_voices[player->num_virtual_voices++] = voice_num;
+}
+
+static Sint64 VirtualVoiceOffset(SfxVoice *voice, Uint64 clock) {
+	AlEngine *engine = CurrentAlEngine();
+	Sg_Loaded_Sfx *loaded_sfx = voice->sfx->loaded_sfx;
+	if (engine->device_frequency <= 0)
+		return voice->virtual_offset;
+	if (voice->start_frame) {
+		if (clock < voice->start_frame)
+			return -(Sint64)((double)(voice->start_frame - clock) * loaded_sfx->sample_rate / engine->device_frequency);
+		// Started while virtual, so count from its start frame.
+		voice->virtual_offset = 0;
+		voice->virtual_since = voice->start_frame;
+		voice->start_frame = 0;
+	}
+	if (voice->bus_paused)
+		return voice->virtual_offset;
+	// The mixer's pitch doesn't change the playback rate, so time moves at the file's rate.
+	Sint64 offset = voice->virtual_offset + (Sint64)((double)(clock - voice->virtual_since) * loaded_sfx->sample_rate / engine->device_frequency);
+	if (voice->looping && loaded_sfx->frames > 0)
+		offset %= loaded_sfx->frames;
+	return offset;
+}
+
+static void RemoveVirtualVoice(SfxPlayer *player, int voice_num) {
+	SfxVoice *sfx_voice = &player->voices[voice_num];
+	int last = player->virtual_voices[--player->num_virtual_voices];
+	player->virtual_voices[sfx_voice->virtual_num] = last;
+	player->voices[last].virtual_num = sfx_voice->virtual_num;
+	sfx_voice->virtual_num = -1;
+}
+
+static void UpdateVirtualVoices(SfxPlayer *player) {
+	AlEngine *engine = CurrentAlEngine();
+	if (!player->num_virtual_voices)
+		return;
+	Uint64 clock = DeviceClock();
+	int best = -1;
+	// Backwards, since finishing a voice moves the last one into its place.
+	for (int i = player->num_virtual_voices - 1; i >= 0; --i) {
+		int voice_num = player->virtual_voices[i];
+		SfxVoice *sfx_voice = &player->voices[voice_num];
+		if (SfxVoiceStopPassed(sfx_voice, clock) || (!sfx_voice->looping && VirtualVoiceOffset(sfx_voice, clock) >= sfx_voice->sfx->loaded_sfx->frames)) {
+			FinishSfxVoice(player, voice_num);
+			continue;
+		}
+		// The listener may have moved, so distances are checked again.
+		sfx_voice->audible_gain = SfxVoiceAudibleGain(sfx_voice);
+		// Voices on paused buses would only sit still on a source, they get one once their bus plays again.
+		if (!sfx_voice->bus_paused && sfx_voice->audible_gain >= engine->cull_gain && (best == -1 || VoiceOutranks(sfx_voice, &player->voices[best])))
+			best = voice_num;
+	}
+	// Hand out sources to the loudest/highest priority voices, until a real voice outranks the best virtual one.
+	for (int promoted = 0; best != -1 && promoted < MAX_SFX_SOUNDS; ++promoted) {
+		int source_num = AcquireSfxSource(player, best);
+		if (source_num == -1)
+			break;
+		RealizeSfxVoice(player, best, source_num);
+		best = -1;
+		for (int i = 0; i < player->num_virtual_voices; ++i) {
+			SfxVoice *sfx_voice = &player->voices[player->virtual_voices[i]];
+			if (!sfx_voice->bus_paused && sfx_voice->audible_gain >= engine->cull_gain && (best == -1 || VoiceOutranks(sfx_voice, &player->voices[best])))
+				best = player->virtual_voices[i];
+		}
+	}
+	FlushSfxStarts(player);
+}
+
 void UpdateAl(void) {
-	UpdatePlayer(bgm_player);
-	UpdatePlayer(background_bgm_player);
-	UpdateSfxPlayer(sfx_player);
+	AlEngine *engine = CurrentAlEngine();
+	PROFILE_BEGIN("UpdateSound", engine->update_count);
+	++engine->update_count;
+	if (!engine->source_events_enabled || !DrainSourceEvents()) {
+		// Events aren't available or some were dropped, so check everything this time.
+		UpdatePlayer(engine->bgm_player);
+		UpdatePlayer(engine->background_bgm_player);
+		UpdatePlayer(engine->stem_player);
+		UpdateSfxPlayer(engine->sfx_player);
+	}
+	if (engine->listener_moved) {
+		// Every real voice is a different distance away now, cull the ones that went out of range before they are moved.
+		CullRealSfxVoices(engine->sfx_player);
+	}
+	FlushSfxMoves(engine->sfx_player);
+	UpdateVirtualVoices(engine->sfx_player);
+	PROFILE_END();
+}
+
+static int DrainSourceEvents(void) {
+	AlEngine *engine = CurrentAlEngine();
+	ALeventSG events[SOURCE_EVENT_BATCH];
+	ALboolean overflowed = AL_FALSE;
+	int update_bgm = 0, update_background_bgm = 0, update_stems = 0;
+	int update_streams[SFX_STREAM_PLAYERS] = {0};
+	ALsizei count;
+	do {
+		ALboolean batch_overflowed = AL_FALSE;
+		count = alGetEventsSG(events, SOURCE_EVENT_BATCH, &batch_overflowed);
+		overflowed |= batch_overflowed;
+		for (ALsizei i = 0; i < count; ++i) {
+			ALuint source = events[i].source;
+			int stream_num;
+			if (source == engine->bgm_player->source) {
+				update_bgm = 1;
+			} else if (source == engine->background_bgm_player->source) {
+				update_background_bgm = 1;
+			} else if (source == engine->stem_player->source) {
+				update_stems = 1;
+			} else if ((stream_num = SfxStreamIndex(engine->sfx_player, source)) != -1) {
+				update_streams[stream_num] = 1;
+			} else if (events[i].type == AL_EVENT_SOURCE_STOPPED_SG) {
+				HandleSfxSourceStopped(engine->sfx_player, source);
+			}
+		}
+	} while (count == SOURCE_EVENT_BATCH);
+	if (overflowed)
+		return 0;
+	if (update_bgm)
+		UpdatePlayer(engine->bgm_player);
+	if (update_background_bgm)
+		UpdatePlayer(engine->background_bgm_player);
+	if (update_stems)
+		UpdatePlayer(engine->stem_player);
+	for (int i = 0; i < SFX_STREAM_PLAYERS; ++i) {
+		int voice_num = engine->sfx_player->stream_voices[i];
+		if (update_streams[i] && voice_num != -1 && !UpdateSfxStream(engine->sfx_player, i))
+			FinishSfxVoice(engine->sfx_player, voice_num);
+	}
+	return 1;
+}
+
+static int SfxSourceIndex(SfxPlayer *player, ALuint source) {
+	// Sources are generated together, so they are usually sequential names.
+	int guess = (int)source - (int)player->sources[0];
+	if (guess >= 0 && guess < MAX_SFX_SOUNDS && player->sources[guess] == source)
+		return guess;
+	for (int i = 0; i < MAX_SFX_SOUNDS; ++i) {
+		if (player->sources[i] == source)
+			return i;
+	}
+	return -1;
+}
+
+static void HandleSfxSourceStopped(SfxPlayer *player, ALuint source) {
+	int source_num = SfxSourceIndex(player, source);
+	if (source_num < 0 || player->source_voices[source_num] == -1)
+		return;
+	// The source could have been stopped and reused since the mixer queued this, so make sure it is still stopped.
+	ALint state;
+	alGetSourcei(source, AL_SOURCE_STATE, &state);
+	if (state != AL_STOPPED)
+		return;
+	FinishSfxVoice(player, player->source_voices[source_num]);
+}
+
+static void FinishSfxVoice(SfxPlayer *player, int voice_num) {
+	AlEngine *engine = CurrentAlEngine();
+	gsSfx *sfx = player->voices[voice_num].sfx;
+	gsVoice voice = SlotMapHandleAt(player->voice_slots, voice_num);
+	ReleaseSfxVoice(player, voice_num);
+	if (engine->sfx_finished_callback)
+		engine->sfx_finished_callback(sfx, voice, engine->sfx_finished_userdata);
+}
+
+static void ReleaseSfxVoice(SfxPlayer *player, int voice_num) {
+	SfxVoice *sfx_voice = &player->voices[voice_num];
+	if (sfx_voice->stream_num != -1) {
+		StopBgm(player->streams[sfx_voice->stream_num]);
+		player->stream_voices[sfx_voice->stream_num] = -1;
+		sfx_voice->stream_num = -1;
+	} else if (sfx_voice->source_num != -1) {
+		ALuint source = player->sources[sfx_voice->source_num];
+		alSourceStop(source);
+		alSourcei(source, AL_BUFFER, 0);
+		player->source_voices[sfx_voice->source_num] = -1;
+		PushStack(player->free_sources_stack, sfx_voice->source_num);
+		sfx_voice->source_num = -1;
+	} else if (sfx_voice->virtual_num != -1) {
+		RemoveVirtualVoice(player, voice_num);
+	}
+	--sfx_voice->sfx->loaded_sfx->instances;
+	sfx_voice->sfx = NULL;
+	SlotMapRemove(player->voice_slots, SlotMapHandleAt(player->voice_slots, voice_num));
 }
 
 static int UpdatePlayer(StreamPlayer *player) {
@@ -560,6 +2622,11 @@ static int UpdatePlayer(StreamPlayer *player) {
 		return 0;
 	}
 	ALint queued;
+	// Stopped by its fade, so it is done even with buffers left.
+	if (state == AL_STOPPED && player->fade_stop) {
+		StopBgm(player);
+		return 0;
+	}
 	if (state == AL_STOPPED) {
 		/* If no buffers are queued, playback is finished or starved */
 		alGetSourcei(player->source, AL_BUFFERS_QUEUED, &queued);
@@ -574,7 +2641,7 @@ static int UpdatePlayer(StreamPlayer *player) {
 		--processed_buffers;
 	}
 
-	if (state != AL_PLAYING && state != AL_PAUSED && !music_ended) {
+	if (state != AL_PLAYING && state != AL_PAUSED && !player->ended) {
 		// printf("We are not playing OR paused, we are %d\n", state);
 		alSourcePlay(player->source);
 		if (alGetError() != AL_NO_ERROR) {
@@ -587,40 +2654,35 @@ static int UpdatePlayer(StreamPlayer *player) {
 }
 
 static int UpdateSfxPlayer(SfxPlayer *player) {
-	ALint processed_buffers;
-	int processed_buffer_nums[MAX_SFX_SOUNDS];
-	int buffs_processed = 0;
-	for (size_t i = 0; i < player->playing_buffers_vector->size; ++i) {
-		ALuint buf_num = player->playing_buffers_vector->data[i];
-		alGetSourcei(player->sources[buf_num], AL_BUFFERS_PROCESSED, &processed_buffers);
+	ALint state;
+	for (int i = 0; i < MAX_SFX_SOUNDS; ++i) {
+		if (player->source_voices[i] == -1)
+			continue;
+		alGetSourcei(player->sources[i], AL_SOURCE_STATE, &state);
 		if (alGetError() != AL_NO_ERROR) {
 			fprintf(stderr, "Error checking source state\n");
 			return 0;
 		}
-		while (processed_buffers > 0) {
-			UnqueueSfxBuffer(player, buf_num);
-			processed_buffer_nums[buffs_processed++] = buf_num;
-			--processed_buffers;
-		}
+		if (state == AL_STOPPED)
+			FinishSfxVoice(player, player->source_voices[i]);
 	}
-	for (size_t i = 0; i < buffs_processed; ++i) {
-		VectorRemoveItem(player->playing_buffers_vector, processed_buffer_nums[i]);
+	for (int i = 0; i < SFX_STREAM_PLAYERS; ++i) {
+		int voice_num = player->stream_voices[i];
+		if (voice_num != -1 && !UpdateSfxStream(player, i))
+			FinishSfxVoice(player, voice_num);
 	}
 	return 1;
 }
 
-static void UnqueueSfxBuffer(SfxPlayer *player, ALint source_num) {
-	alSourceUnqueueBuffers(player->sources[source_num], 1, &player->buffers[source_num]);
-	PushStack(player->free_buffers_stack, source_num);
-}
-
 static int HandleProcessedBuffer(StreamPlayer *player) {
 	ALuint bufid;
 	alSourceUnqueueBuffers(player->source, 1, &bufid);
 	BufferFillFlags buf_flags = 0;
+	// Buffers are requeued in the order they finish, so the oldest slot is reused for the newest.
+	player->buffer_starts[player->oldest_buffer] = PlayerDecodeFrame(player);
+	player->oldest_buffer = (player->oldest_buffer + 1) % BGM_NUM_BUFFERS;
 	long bytes_read = LoadBufferData(player, &buf_flags);
-	alBufferData(bufid, player->format, player->membuf, (ALsizei)bytes_read,
-				 player->vbinfo->rate);
+	PlayerBufferData(player, bufid, bytes_read);
 	alSourceQueueBuffers(player->source, 1, &bufid);
 	if (alGetError() != AL_NO_ERROR) {
 		fprintf(stderr, "Error buffering data\n");
@@ -631,13 +2693,14 @@ static int HandleProcessedBuffer(StreamPlayer *player) {
 			RestartStream(player);
 			player->loops = player->loops == 255 ? 255 : --player->loops;
 		} else {
-			music_ended = 1;
+			player->ended = 1;
 		}
 	}
 	return 1;
 }
 
 static long LoadBufferData(StreamPlayer *player, BufferFillFlags *buff_flags) {
+	PROFILE_BEGIN("LoadBufferData", player->source);
 	// Set the buffer flags to 0, as it is normal
 	*buff_flags = 0;
 	// Set the bytes read to 0, since we didn't read any bytes yet
@@ -674,55 +2737,129 @@ static long LoadBufferData(StreamPlayer *player, BufferFillFlags *buff_flags) {
 	}
 	// Add the bytes read to the current bytes read for the entire loop, used for tracking the current loading point.
 	player->total_bytes_read_this_loop += total_buffer_bytes_read;
-
+	if (player->stems && player->stems->count)
+		LoadStemData(player, total_buffer_bytes_read);
+	PROFILE_END();
 	return total_buffer_bytes_read;
 }
 
+static void LoadStemData(StreamPlayer *player, long bytes) {
+	StemFiles *stems = player->stems;
+	int frame_size = player->vbinfo->channels * sizeof(short);
+	int stride = frame_size * (stems->count + 1);
+	long frames = bytes / frame_size;
+	// The first stem is already in membuf.
+	for (long frame = 0; frame < frames; ++frame)
+		memcpy((char *)stems->block + frame * stride, (char *)player->membuf + frame * frame_size, frame_size);
+	for (int i = 0; i < stems->count; ++i) {
+		// Every stem is at the same frame, so reading exactly as much keeps them locked together.
+		long total_bytes_read = 0;
+		while (total_bytes_read < bytes) {
+			int request_size = bytes - total_bytes_read < VORBIS_REQUEST_SIZE ? (int)(bytes - total_bytes_read) : VORBIS_REQUEST_SIZE;
+			int bytes_read = ov_read(&stems->files[i], (char *)stems->scratch + total_bytes_read, request_size, 0, sizeof(short), 1, 0);
+			if (bytes_read <= 0)
+				break;
+			total_bytes_read += bytes_read;
+		}
+		memset((char *)stems->scratch + total_bytes_read, 0, bytes - total_bytes_read);
+		char *stem_start = (char *)stems->block + (i + 1) * frame_size;
+		for (long frame = 0; frame < frames; ++frame)
+			memcpy(stem_start + frame * stride, (char *)stems->scratch + frame * frame_size, frame_size);
+	}
+}
+
+static void PlayerBufferData(StreamPlayer *player, ALuint buffer, long bytes) {
+	StemFiles *stems = player->stems;
+	if (stems && stems->count)
+		alBufferStemsSG(buffer, player->format, stems->count + 1, stems->block, (ALsizei)(bytes * (stems->count + 1)), player->vbinfo->rate);
+	else
+		alBufferData(buffer, player->format, player->membuf, (ALsizei)bytes, player->vbinfo->rate);
+}
+
 static int RestartStream(StreamPlayer *player) {
 	ov_pcm_seek_lap(&player->vbfile, player->loop_point_begin);
 	player->total_bytes_read_this_loop = ov_pcm_tell(&player->vbfile) * player->vbinfo->channels * sizeof(short);
+	StemFiles *stems = player->stems;
+	for (int i = 0; stems && i < stems->count; ++i)
+		ov_pcm_seek_lap(&stems->files[i], player->loop_point_begin);
 	return 0;
 }
 
+int RenderAl(float *samples, int frames) {
+	AlEngine *engine = CurrentAlEngine();
+	if (!engine->headless_device)
+		return 0;
+	alcRenderSamplesSOFT(engine->headless_device, samples, frames);
+	return 1;
+}
+
 int CloseAl(void) {
-	DeletePlayer(bgm_player);
-	DeletePlayer(background_bgm_player);
-	DeleteSfxPlayer(sfx_player);
-	bgm_player = NULL;
+	AlEngine *engine = CurrentAlEngine();
+	DeletePlayer(engine->bgm_player);
+	DeletePlayer(engine->background_bgm_player);
+	DeletePlayer(engine->stem_player);
+	DeleteSfxPlayer(engine->sfx_player);
 	CloseAL();
+	SoundFree(engine);
+	CurrentEngine()->al = NULL;
 	return 0;
 }
 
+static AlEngine *CurrentAlEngine(void) {
+	gsEngine *owner = CurrentEngine();
+	return owner && owner->al ? owner->al : &no_engine;
+}
+
 static void DeletePlayer(StreamPlayer *player) {
 	ClosePlayerFile(player);
-	free(player->membuf);
+	SoundFree(player->membuf);
 	player->membuf = NULL;
+	if (player->stems) {
+		SoundFree(player->stems->scratch);
+		SoundFree(player->stems->block);
+		SoundFree(player->stems);
+	}
 	alDeleteSources(1, &player->source);
 	alDeleteBuffers(BGM_NUM_BUFFERS, player->buffers);
 	if (alGetError() != AL_NO_ERROR)
 		fprintf(stderr, "Failed to delete object IDs\n");
 
 	memset(player, 0, sizeof(*player));
-	free(player);
+	SoundFree(player);
 }
 
 static void ClosePlayerFile(StreamPlayer *player) {
 	ov_clear(&player->vbfile);
+	FreeOggPageIndex(&player->page_index);
+	if (player->stems)
+		CloseStemFiles(player->stems);
 	player->total_bytes_read_this_loop = 0;
 	player->file_loaded = 0;
 }
 
+static void CloseStemFiles(StemFiles *stems) {
+	for (int i = 0; i < stems->count; ++i) {
+		ov_clear(&stems->files[i]);
+		FreeOggPageIndex(&stems->page_indexes[i]);
+	}
+	stems->count = 0;
+}
+
 static void DeleteSfxPlayer(SfxPlayer *sfx_player) {
+	for (int i = 0; i < SFX_STREAM_PLAYERS; ++i)
+		DeletePlayer(sfx_player->streams[i]);
 	alDeleteSources(MAX_SFX_SOUNDS, sfx_player->sources);
-	alDeleteBuffers(MAX_SFX_SOUNDS, sfx_player->buffers);
-	DestroyStack(sfx_player->free_buffers_stack);
-	DestroyVector(sfx_player->playing_buffers_vector);
+	DestroyStack(sfx_player->free_sources_stack);
+	DestroySlotMap(sfx_player->voice_slots);
+	SoundFree(sfx_player);
 }
 
 void SetPlayerLoops(int loops) {
-	bgm_player->loops = loops;
+	AlEngine *engine = CurrentAlEngine();
+	engine->bgm_player->loops = loops;
 }
 
 void SetBackgroundPlayerLoops(int loops) {
-	background_bgm_player->loops = loops;
+	AlEngine *engine = CurrentAlEngine();
+	engine->background_bgm_player->loops = loops;
 }
@@ -1,19 +1,50 @@
 #pragma once
+#include <SupergoonSound/include/sound.h>
+#include <SupergoonSound/sound/soundfile.h>
 
 typedef struct Sg_Loaded_Sfx {
+	// Size of the decoded 16 bit data.
 	int size;
 	int format;
 	long sample_rate;
+	// Length in sample frames.
+	long frames;
 	short *sound_data;
+	// The compressed file, kept so it can be decoded again after being evicted.  NULL when streamed.
+	unsigned char *encoded_data;
+	size_t encoded_size;
+	// If encoded_data is a mapping of the file instead of a copy.
+	int mapped;
+	// Where the samples are when it is a wav, samples is NULL for vorbis.
+	WavInfo wav;
+	// The AL buffer the data was uploaded to, shared by every voice playing this sfx.  0 when streamed or evicted.
+	unsigned int buffer;
+	// Bytes the mixer holds while it is decoded, it keeps it as float.
+	size_t pcm_bytes;
+	// Neighbours in the decoded sfx list, ordered by when they were last played.
+	struct Sg_Loaded_Sfx *newer;
+	struct Sg_Loaded_Sfx *older;
+	// Streamed sfx aren't decoded at load, each voice streams the file.
+	int streamed;
+	char *filename;
+	// Voices currently playing this sfx, real or virtual.
+	int instances;
+	// Device frame of the last trigger that started a voice, only set once last_voice is.
+	Uint64 last_trigger;
+	// The last voice started, and the update it was started in, for coalescing.
+	gsVoice last_voice;
+	unsigned int last_voice_update;
 
 } Sg_Loaded_Sfx;
 
 /**
  * @brief Initialize the openAl backend
  *
+ * @param config The device settings to open with, or NULL for the defaults.
+ *
  * @return 1 if successful, 0 if not.
  */
-int InitializeAl(void);
+int InitializeAl(const gsSoundConfig *config);
 /**
  * @brief Play a streaming BGM.
  *
@@ -24,12 +55,52 @@ int InitializeAl(void);
  * @return 1 on Success, 0 on failure.
  */
 int PlayBgmAl(float volume);
+/**
+ * @brief Plays the bgm starting on a device frame, it is silent until then.
+ *
+ * @return 1 on Success, 0 on failure.
+ */
+int PlayBgmScheduledAl(float volume, uint64_t frame);
+/**
+ * @brief Gets the device frame the next mix starts at, counted from when the device opened.
+ */
+uint64_t GetSoundClockAl(void);
+/**
+ * @brief Gets the rate the sound clock counts at.
+ */
+int GetSoundSampleRateAl(void);
 int PlayBgmBackgroundAl(float volume);
 
 int PreBakeBgm(const char *filename);
 int PreBakeBackgroundBgm(const char *filename);
 int StopBgmAl(void);
 int StopBackgroundBgmAl(void);
+/**
+ * @brief Gets where a bgm player is in its song.
+ *
+ * @param background If it is the background player.
+ *
+ * @return The position in seconds, -1 if nothing is loaded.
+ */
+double BgmTellAl(int background);
+/**
+ * @brief Moves a bgm player to a position in its song.
+ *
+ * @param background If it is the background player.
+ * @param seconds The position, past the loop end wraps to the loop begin.
+ *
+ * @return 1 if it moved, 0 if nothing is loaded or it couldn't seek, which stops it.
+ */
+int BgmSeekAl(int background, double seconds);
+/**
+ * @brief Fades the gain of a bgm player, ramped in the mixer.
+ *
+ * @param background If it is the background player.
+ * @param stop If it stops when the fade ends.
+ *
+ * @return 1 if it is fading, 0 if nothing is loaded.
+ */
+int FadeBgmAl(int background, float volume, float seconds, int stop);
 /**
  * @brief Pauses the playing bgm_player.
  *
@@ -43,13 +114,60 @@ int PauseBgmAl(void);
  */
 int UnpauseBgmAl(void);
 /**
- * @brief Loads a buffer full of the full sfx file, and returns it's information.
+ * @brief Opens the stems of a song on the stem player and fills its buffers, stopping what it was playing.
+ *
+ * @param filenames The stems, they must all be the same rate and channels.
+ * @param count How many stems, up to GS_MAX_STEMS and as many channels as the mixer can fold.
+ *
+ * @return 1 if they all opened, 0 if not.
+ */
+int PreBakeStemsAl(const char *const *filenames, int count);
+int PlayStemsAl(float volume);
+int StopStemsAl(void);
+int PauseStemsAl(void);
+int UnpauseStemsAl(void);
+/**
+ * @brief Ramps a stem's gain in the mixer, the other stems keep theirs.
+ *
+ * @return 1 if it was set, 0 if no stems are loaded or there is no such stem.
+ */
+int SetStemGainAl(int stem, float gain, float seconds);
+/**
+ * @brief Gets where the stem player is in its song.
+ *
+ * @return The position in seconds, -1 if nothing is loaded.
+ */
+double StemsTellAl(void);
+/**
+ * @brief Moves every stem to a position in the song together.
+ *
+ * @return 1 if it moved, 0 if nothing is loaded or it couldn't seek, which stops it.
+ */
+int StemsSeekAl(double seconds);
+/**
+ * @brief Sets the mixer's gain for a bus.
+ *
+ * @return 1 if it was set, 0 if there is no such bus.
+ */
+int SetBusVolumeAl(gsBus bus, float volume);
+int SetBusMutedAl(gsBus bus, int muted);
+int SetBusPausedAl(gsBus bus, int paused);
+/**
+ * @brief Moves a bus under a parent that comes before it.
+ *
+ * @return 1 if it moved, 0 if either bus doesn't exist, bus is the master bus, or parent doesn't come before it.
+ */
+int SetBusParentAl(gsBus bus, gsBus parent);
+/**
+ * @brief Loads a buffer full of the full sfx file, and returns it's information.  Wav files are used as is, vorbis files are decoded.  Long vorbis files are only opened to check them, and are streamed when played.
  *
  * @param filename The name to load
+ * @param stream If it should be streamed no matter how long it is, only vorbis files can stream.
+ * @param arena The arena the sfx is in, its file is kept there too.  NULL to use the allocator.
  *
  * @return A Sg_loaded_Sfx, that has the sound_data within it.
  */
-Sg_Loaded_Sfx *LoadSfxFileAl(const char *filename);
+Sg_Loaded_Sfx *LoadSfxFileAl(const char *filename, int stream, gsArena *arena);
 /**
  * @brief Properly unloads a loaded sfx files memory.
  *
@@ -58,11 +176,131 @@ Sg_Loaded_Sfx *LoadSfxFileAl(const char *filename);
  * @return 1 if successful, 0 if failed.
  */
 int CloseSfxFileAl(Sg_Loaded_Sfx *loaded_sfx);
-int PlaySfxAl(Sg_Loaded_Sfx *sound_file, float volume);
+/**
+ * @brief Plays a loaded sfx on a new voice.  It is virtual if there is no source for it.
+ *
+ * @param sfx The sfx to play, must already be loaded.
+ * @param volume The volume to play with, between 0 and 1.
+ * @param looping If it should loop until stopped.
+ *
+ * @return The voice it is playing on, 0 if it isn't loaded or there are no free voices.
+ */
+gsVoice PlaySfxAl(gsSfx *sfx, float volume, int looping);
+/**
+ * @brief Plays many loaded sfx, and starts all of the real ones with a single call into the mixer.
+ *
+ * @param requests The sfx to play, they must already be loaded.
+ * @param count The number of requests.
+ * @param voices Filled with the voice for each request, 0 for ones that didn't play.  Can be NULL.
+ *
+ * @return The number of requests that got a voice.
+ */
+int PlaySfxBatchAl(const gsPlayRequest *requests, int count, gsVoice *voices);
+/**
+ * @brief Stops a playing voice, without firing the finished callback.
+ *
+ * @return 1 if it was stopped, 0 if the voice is stale.
+ */
+int StopVoiceAl(gsVoice voice);
+/**
+ * @brief Stops a voice on a device frame, without firing the finished callback.
+ *
+ * @return 1 if it was scheduled, 0 if the voice is stale.
+ */
+int StopVoiceScheduledAl(gsVoice voice, uint64_t frame);
+/**
+ * @brief Sets the gain of a playing voice.
+ *
+ * @return 1 if it was set, 0 if the voice is stale.
+ */
+int SetVoiceGainAl(gsVoice voice, float volume);
+/**
+ * @brief Fades the gain of a playing voice, ramped in the mixer.
+ *
+ * @param stop If it stops when the fade ends.
+ *
+ * @return 1 if it is fading, 0 if the voice is stale.
+ */
+int FadeVoiceAl(gsVoice voice, float volume, float seconds, int stop);
+/**
+ * @brief Sets the pitch of a playing voice, 1 is normal.
+ *
+ * @return 1 if it was set, 0 if the voice is stale or the pitch isn't above 0.
+ */
+int SetVoicePitchAl(gsVoice voice, float pitch);
+/**
+ * @brief Pans a playing voice, -1 is full left and 1 is full right.
+ *
+ * @return 1 if it was set, 0 if the voice is stale or positional.
+ */
+int SetVoicePanAl(gsVoice voice, float pan);
+/**
+ * @brief Moves positional voices, the real ones are sent to the mixer on the next update.
+ *
+ * @return The number of voices moved.
+ */
+int SetEmitterPositionsAl(const gsVoice *voices, const float *positions, int count);
+/**
+ * @brief Sets if a voice is occluded, occluded voices are culled.
+ *
+ * @return 1 if it was set, 0 if the voice is stale.
+ */
+int SetVoiceOccludedAl(gsVoice voice, int occluded);
+/**
+ * @brief Moves the listener, it is sent to the mixer on the next update.
+ */
+void SetListenerAl(const gsListener *listener);
+/**
+ * @brief Checks if a voice is still playing.
+ *
+ * @return 1 if it is playing or paused, 0 if it finished or the voice is stale.
+ */
+int VoiceIsPlayingAl(gsVoice voice);
+/**
+ * @brief Checks if a voice is virtual, playing without a source.
+ *
+ * @return 1 if it is virtual, 0 if it is real or stale.
+ */
+int VoiceIsVirtualAl(gsVoice voice);
+/**
+ * @brief Stops every source that is playing this sfx, without firing the finished callback.
+ *
+ * @param sfx The sfx to stop.
+ */
+void StopSfxAl(gsSfx *sfx);
+/**
+ * @brief Sets the function that is called when a sfx finishes playing.
+ *
+ * @param callback The function to call, or NULL to clear it.
+ * @param userdata Passed back to the callback.
+ */
+void SetSfxFinishedCallbackAl(gsSfxFinishedCallback callback, void *userdata);
+/**
+ * @brief Sets the most bytes of decoded sfx to keep, and evicts sfx that aren't playing until it fits.
+ *
+ * @param bytes The budget, 0 is no limit.
+ */
+void SetPcmBudgetAl(size_t bytes);
+/**
+ * @brief Fills in the memory use and cache counts.
+ */
+void GetSoundStatsAl(gsSoundStats *stats);
+/**
+ * @brief Fills in the mixer's callback timing from the device histogram.
+ *
+ * @return 1 if it was filled, 0 if there is no device.
+ */
+int GetCallbackTimingAl(gsCallbackTiming *timing, int reset);
 /**
  * @brief Updates the openal sound system.
  */
 void UpdateAl(void);
+/**
+ * @brief Mixes the next frames from a headless device.
+ *
+ * @return 1 if it mixed, 0 if sound isn't headless.
+ */
+int RenderAl(float *samples, int frames);
 /**
  * @brief Closes the AL sound system.
  *
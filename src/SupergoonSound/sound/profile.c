@@ -0,0 +1,248 @@
+#include <SupergoonSound/gnpch.h>
+#include <AL/al.h>
+#include <AL/alext.h>
+#include <SupergoonSound/base/allocator.h>
+#include <SupergoonSound/sound/profile.h>
+
+#define PROFILE_RING_SIZE 8192	// Finished spans each thread can hold until the writer drains them, power of two.
+#define PROFILE_MAX_DEPTH 32	// Deepest spans can nest on one thread, deeper ones aren't recorded.
+#define PROFILE_FLUSH_MS 50		// How often the writer drains the rings.
+#define PROFILE_MAX_THREADS 16	// Threads that can record spans, later ones aren't recorded.
+
+typedef struct ProfileSpan {
+	const char *name;
+	unsigned int arg;
+	Uint64 start;
+	Uint64 end;
+} ProfileSpan;
+
+/**
+ * @brief Spans finished on one thread, waiting for the writer.  Only the owning thread writes head, and only the writer writes tail.
+ */
+typedef struct ProfileRing {
+	ProfileSpan spans[PROFILE_RING_SIZE];
+	SDL_atomic_t head;
+	SDL_atomic_t tail;
+	// Spans finished while the ring was full.
+	SDL_atomic_t dropped;
+	// Spans started and not ended yet, only touched by the owning thread.
+	ProfileSpan open[PROFILE_MAX_DEPTH];
+	int depth;
+	SDL_threadID thread;
+	// The thread is named after the first span it records.
+	const char *first_name;
+	// If the writer has named the thread in this profile.
+	int named;
+} ProfileRing;
+
+/**
+ * @brief The rings are all allocated when the profile opens, so recording threads like the mixer's never allocate.
+ */
+typedef struct Profile {
+	FILE *file;
+	Uint64 start;
+	Uint64 frequency;
+	SDL_Thread *writer;
+	SDL_sem *writer_stop;
+	ProfileRing *rings;
+	// Rings handed out to threads so far, can go past PROFILE_MAX_THREADS.
+	SDL_atomic_t claimed_rings;
+} Profile;
+
+static Profile *profile = NULL;
+static SDL_atomic_t profile_enabled;
+/**
+ * @brief Threads inside ProfileBegin or ProfileEnd, so the rings aren't freed under them.
+ */
+static SDL_atomic_t profile_users;
+/**
+ * @brief A thread keeps which ring is its own in thread local storage, which can't be cleared from another thread.  It
+ * is kept with the generation of the profile it was claimed in, so a ring from a closed profile isn't used.
+ */
+static SDL_TLSID profile_ring_tls = 0;
+static unsigned int profile_generation = 0;
+
+/**
+ * @brief Gets the ring for this thread, claiming one the first time.
+ *
+ * @return The ring, NULL if every ring is claimed or it is ending a span without one.
+ */
+static ProfileRing *GetProfileRing(const char *name);
+/**
+ * @brief Drains every ring, runs every PROFILE_FLUSH_MS until the profile is closed.
+ */
+static int ProfileWriter(void *userdata);
+/**
+ * @brief Writes every finished span to the file.
+ */
+static void DrainProfileRings(void);
+static void WriteJsonString(FILE *file, const char *string);
+static void AL_APIENTRY ProfileHookBegin(const char *name, ALuint arg);
+static void AL_APIENTRY ProfileHookEnd(void);
+
+int OpenProfile(const char *filename) {
+	if (profile)
+		CloseProfile();
+	FILE *file = fopen(filename, "w");
+	if (!file) {
+		fprintf(stderr, "Could not open profile file %s\n", filename);
+		return 0;
+	}
+	if (!profile_ring_tls)
+		profile_ring_tls = SDL_TLSCreate();
+	profile = SoundCalloc(1, sizeof(*profile));
+	profile->rings = SoundCalloc(PROFILE_MAX_THREADS, sizeof(*profile->rings));
+	if (!profile->rings) {
+		fclose(file);
+		SoundFree(profile);
+		profile = NULL;
+		return 0;
+	}
+	// Rings claimed in a earlier profile are gone, so every thread claims a new one.
+	++profile_generation;
+	profile->file = file;
+	profile->start = SDL_GetPerformanceCounter();
+	profile->frequency = SDL_GetPerformanceFrequency();
+	fputs("{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"SupergoonSound\"}}", file);
+	SDL_AtomicSet(&profile_enabled, 1);
+	alProfileHooksSG(ProfileHookBegin, ProfileHookEnd);
+	profile->writer_stop = SDL_CreateSemaphore(0);
+	profile->writer = SDL_CreateThread(ProfileWriter, "gsProfile", NULL);
+	return 1;
+}
+
+void CloseProfile(void) {
+	if (!profile)
+		return;
+	alProfileHooksSG(NULL, NULL);
+	SDL_AtomicSet(&profile_enabled, 0);
+	// A thread already past the enabled check finishes with its ring before the rings are freed.
+	while (SDL_AtomicGet(&profile_users))
+		SDL_Delay(0);
+	if (profile->writer) {
+		SDL_SemPost(profile->writer_stop);
+		SDL_WaitThread(profile->writer, NULL);
+	}
+	DrainProfileRings();
+	fputs("\n],\"displayTimeUnit\":\"ms\"}\n", profile->file);
+	fclose(profile->file);
+	SDL_DestroySemaphore(profile->writer_stop);
+	SoundFree(profile->rings);
+	SoundFree(profile);
+	profile = NULL;
+}
+
+void ProfileBegin(const char *name, unsigned int arg) {
+	SDL_AtomicIncRef(&profile_users);
+	ProfileRing *ring = SDL_AtomicGet(&profile_enabled) ? GetProfileRing(name) : NULL;
+	if (ring) {
+		if (ring->depth < PROFILE_MAX_DEPTH) {
+			ProfileSpan *span = &ring->open[ring->depth];
+			span->name = name;
+			span->arg = arg;
+			span->start = SDL_GetPerformanceCounter();
+		}
+		++ring->depth;
+	}
+	SDL_AtomicAdd(&profile_users, -1);
+}
+
+void ProfileEnd(void) {
+	SDL_AtomicIncRef(&profile_users);
+	ProfileRing *ring = SDL_AtomicGet(&profile_enabled) ? GetProfileRing(NULL) : NULL;
+	if (ring && ring->depth && --ring->depth < PROFILE_MAX_DEPTH) {
+		ProfileSpan *span = &ring->open[ring->depth];
+		span->end = SDL_GetPerformanceCounter();
+		unsigned int head = (unsigned int)SDL_AtomicGet(&ring->head);
+		if (head - (unsigned int)SDL_AtomicGet(&ring->tail) >= PROFILE_RING_SIZE) {
+			SDL_AtomicIncRef(&ring->dropped);
+		} else {
+			ring->spans[head & (PROFILE_RING_SIZE - 1)] = *span;
+			// Publishes the span, the writer won't read it before this.
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&ring->head, (int)(head + 1));
+		}
+	}
+	SDL_AtomicAdd(&profile_users, -1);
+}
+
+static ProfileRing *GetProfileRing(const char *name) {
+	// The low byte is the ring number plus one, and the rest is the generation it was claimed in.
+	uintptr_t claim = (uintptr_t)SDL_TLSGet(profile_ring_tls);
+	if (claim && (unsigned int)(claim >> 8) == profile_generation)
+		return &profile->rings[(claim & 0xff) - 1];
+	// A span ending without a ring started before this profile.
+	if (!name)
+		return NULL;
+	int ring_num = SDL_AtomicAdd(&profile->claimed_rings, 1);
+	if (ring_num >= PROFILE_MAX_THREADS)
+		return NULL;
+	ProfileRing *ring = &profile->rings[ring_num];
+	ring->thread = SDL_ThreadID();
+	ring->first_name = name;
+	SDL_TLSSet(profile_ring_tls, (void *)(((uintptr_t)profile_generation << 8) | (uintptr_t)(ring_num + 1)), NULL);
+	return ring;
+}
+
+static int ProfileWriter(void *userdata) {
+	(void)userdata;
+	while (SDL_SemWaitTimeout(profile->writer_stop, PROFILE_FLUSH_MS) == SDL_MUTEX_TIMEDOUT)
+		DrainProfileRings();
+	return 0;
+}
+
+static void DrainProfileRings(void) {
+	FILE *file = profile->file;
+	double us_per_tick = 1000000.0 / profile->frequency;
+	int claimed = SDL_AtomicGet(&profile->claimed_rings);
+	for (int i = 0; i < claimed && i < PROFILE_MAX_THREADS; ++i) {
+		ProfileRing *ring = &profile->rings[i];
+		unsigned int head = (unsigned int)SDL_AtomicGet(&ring->head);
+		// Don't read the spans or who the thread is until after seeing them published.
+		SDL_MemoryBarrierAcquire();
+		unsigned long thread = (unsigned long)ring->thread;
+		unsigned int tail = (unsigned int)SDL_AtomicGet(&ring->tail);
+		if (head != tail && !ring->named) {
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"", thread);
+			WriteJsonString(file, ring->first_name);
+			fputs(" thread\"}}", file);
+			ring->named = 1;
+		}
+		for (; tail != head; ++tail) {
+			const ProfileSpan *span = &ring->spans[tail & (PROFILE_RING_SIZE - 1)];
+			fputs(",\n{\"name\":\"", file);
+			WriteJsonString(file, span->name);
+			fprintf(file, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%lu,\"args\":{\"arg\":%u}}",
+					(span->start - profile->start) * us_per_tick, (span->end - span->start) * us_per_tick, thread, span->arg);
+		}
+		// Finish reading the spans before the thread can write over them.
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSet(&ring->tail, (int)tail);
+		int dropped = SDL_AtomicSet(&ring->dropped, 0);
+		if (dropped) {
+			// Marks where the gap is, so a quiet stretch isn't mistaken for a idle thread.
+			fprintf(file, ",\n{\"name\":\"Dropped spans\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu,\"args\":{\"count\":%d}}",
+					(SDL_GetPerformanceCounter() - profile->start) * us_per_tick, thread, dropped);
+		}
+	}
+}
+
+static void WriteJsonString(FILE *file, const char *string) {
+	for (; *string; ++string) {
+		unsigned char c = (unsigned char)*string;
+		if (c == '"' || c == '\\')
+			fprintf(file, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(file, "\\u%04x", c);
+		else
+			fputc(c, file);
+	}
+}
+
+static void AL_APIENTRY ProfileHookBegin(const char *name, ALuint arg) {
+	ProfileBegin(name, arg);
+}
+
+static void AL_APIENTRY ProfileHookEnd(void) {
+	ProfileEnd();
+}
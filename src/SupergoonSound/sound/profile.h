@@ -0,0 +1,46 @@
+/**
+ * @file profile.h
+ * @brief Timing spans for the instrumented build, written as Chrome trace event json.
+ * @author Kevin Blanchard
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * Built with GN_SOUND_PROFILE, each thread records spans into its own ring with no locking, and a writer thread drains
+ * the rings to the file every so often.  The rings are allocated when the profile opens and freed when it closes, so
+ * only the first 16 threads to record are on the timeline.  The mixer's spans come from mojoAL through AL_SG_profile, and the game can add
+ * its own with gsProfileBegin, so audio callbacks, sound updates and frames are on one timeline.  The file opens in
+ * chrome://tracing or the Perfetto UI.  Without GN_SOUND_PROFILE the markers compile to nothing.
+ */
+#pragma once
+
+#ifdef GN_SOUND_PROFILE
+#define PROFILE_BEGIN(name, arg) ProfileBegin(name, arg)
+#define PROFILE_END() ProfileEnd()
+#else
+#define PROFILE_BEGIN(name, arg)
+#define PROFILE_END()
+#endif
+
+/**
+ * @brief Starts writing spans to a file and hooks the mixer.
+ *
+ * @param filename The json file to write, it is replaced.
+ *
+ * @return 1 if it is writing, 0 if the file couldn't be opened.
+ */
+int OpenProfile(const char *filename);
+/**
+ * @brief Unhooks the mixer, writes everything left and finishes the file.  Does nothing if not profiling.
+ */
+void CloseProfile(void);
+/**
+ * @brief Starts a span on this thread, spans nest.
+ *
+ * @param name Shown on the timeline, it must stay valid until the profile is closed.
+ * @param arg Shown with the span, what it means depends on the span.
+ */
+void ProfileBegin(const char *name, unsigned int arg);
+/**
+ * @brief Ends the last span started on this thread.
+ */
+void ProfileEnd(void);
@@ -1,26 +1,337 @@
 #include <SupergoonSound/gnpch.h>
+#include <AL/alext.h>
+#include <SupergoonSound/base/allocator.h>
 #include <SupergoonSound/include/sound.h>
 #include <SupergoonSound/sound/alhelpers.h>
+#include <SupergoonSound/sound/arena.h>
+#include <SupergoonSound/sound/commands.h>
+#include <SupergoonSound/sound/engine.h>
 #include <SupergoonSound/sound/openal.h>
+#include <SupergoonSound/sound/profile.h>
+#include <SupergoonSound/sound/trace.h>
+
+#define SOUND_COMMAND_QUEUE_SIZE 1024  // Most calls that can be waiting to be applied, power of two.
+#define SOUND_THREAD_UPDATE_MS 5		// How long the sound thread sleeps between updates when nothing is queued.
+#define SOUND_COMMAND_PLAY_BATCH 64		// Queued sfx plays are started together, up to this many at once.
+
+/**
+ * @brief Checks if this call has to be queued instead of ran.
+ *
+ * @return 1 if the calling thread doesn't own the sound state.
+ */
+static int ShouldQueueCommand(void);
+/**
+ * @brief Queues a command for the owning thread.
+ *
+ * @return 1 if it was queued, 0 if the queue is full.
+ */
+static int QueueCommand(const SoundCommand *command);
+/**
+ * @brief Applies every queued command, starting runs of queued sfx plays together.
+ */
+static void ApplySoundCommands(void);
+/**
+ * @brief Runs a single queued command.
+ */
+static void ApplySoundCommand(const SoundCommand *command);
+/**
+ * @brief The sound thread, applies commands as they come and updates sound.
+ *
+ * @param userdata The engine it runs.
+ */
+static int SoundThread(void *userdata);
+/**
+ * @brief Unloads every sfx, bgm and stems made in a arena, then resets or destroys it.
+ */
+static void ReleaseArena(gsArena *arena, int destroy);
+/**
+ * @brief Queues a ReleaseArena for the owning thread and waits until it is done.
+ *
+ * @return 1 if it was released, 0 if the queue is full.
+ */
+static int QueueReleaseArena(gsArena *arena, int destroy);
+/**
+ * @brief Hands the mixer's allocations to our allocator.
+ */
+static void *AL_APIENTRY AlMallocHook(size_t size, void *userdata);
+static void *AL_APIENTRY AlReallocHook(void *ptr, size_t size, void *userdata);
+static void AL_APIENTRY AlFreeHook(void *ptr, void *userdata);
 
 int gsInitializeSound(void) {
-	return InitializeAl();
+	return gsInitializeSoundEx(NULL);
+}
+
+int gsInitializeSoundEx(const gsSoundConfig *config) {
+	gsEngine *engine = gsCreateEngine(config);
+	if (!engine)
+		return 0;
+	SetDefaultEngine(engine);
+	// Other threads fall back to the default engine, so this one does too.
+	BindEngine(NULL);
+	return 1;
+}
+
+gsEngine *gsCreateEngine(const gsSoundConfig *config) {
+	gsEngine *previous = BoundEngine();
+	gsEngine *engine = SoundCalloc(1, sizeof(*engine));
+	if (!engine)
+		return NULL;
+	BindEngine(engine);
+	// Opened first, so the device starting up is on the timeline.
+	if (config && config->profile_filename) {
+#ifdef GN_SOUND_PROFILE
+		engine->profiling = OpenProfile(config->profile_filename);
+#else
+		fprintf(stderr, "Not profiling to %s, build with GOON_SOUND_PROFILE to profile\n", config->profile_filename);
+#endif
+	}
+	if (!InitializeAl(config)) {
+		if (engine->profiling)
+			CloseProfile();
+		BindEngine(previous);
+		SoundFree(engine);
+		return NULL;
+	}
+	// Bound again now that it has a context, so its AL calls go to its device.
+	engine->context = alcGetCurrentContext();
+	BindEngine(engine);
+	// Calls are recorded where they run, so queued calls are recorded once, in the order the sound state saw them.
+	if (config && config->trace_filename)
+		OpenTrace(config->trace_filename, config);
+	engine->command_mode = config ? config->command_mode : gsCommandMode_Direct;
+	if (engine->command_mode == gsCommandMode_Direct)
+		return engine;
+	engine->command_queue = CreateSoundCommandQueue(SOUND_COMMAND_QUEUE_SIZE);
+	engine->owner_thread = SDL_ThreadID();
+	if (engine->command_mode == gsCommandMode_Queued)
+		return engine;
+	engine->state_lock = SDL_CreateMutex();
+	engine->thread_wake = SDL_CreateSemaphore(0);
+	engine->thread_start = SDL_CreateSemaphore(0);
+	SDL_AtomicSet(&engine->thread_quit, 0);
+	engine->thread = SDL_CreateThread(SoundThread, "gsSound", engine);
+	if (!engine->thread) {
+		fprintf(stderr, "Could not create the sound thread: %s\n", SDL_GetError());
+		gsDestroyEngine(engine);
+		BindEngine(previous);
+		return NULL;
+	}
+	engine->owner_thread = SDL_GetThreadID(engine->thread);
+	SDL_SemPost(engine->thread_start);
+	return engine;
+}
+
+void gsSetCurrentEngine(gsEngine *engine) {
+	BindEngine(engine);
+}
+
+gsEngine *gsGetCurrentEngine(void) {
+	return CurrentEngine();
 }
+
+static int ShouldQueueCommand(void) {
+	gsEngine *engine = CurrentEngine();
+	return engine && engine->command_mode != gsCommandMode_Direct && SDL_ThreadID() != engine->owner_thread;
+}
+
+static int QueueCommand(const SoundCommand *command) {
+	gsEngine *engine = CurrentEngine();
+	if (!PushSoundCommand(engine->command_queue, command))
+		return 0;
+	if (engine->thread_wake)
+		SDL_SemPost(engine->thread_wake);
+	return 1;
+}
+
+static int SoundThread(void *userdata) {
+	gsEngine *engine = userdata;
+	BindEngine(engine);
+	// Wait until the id is set, or our own calls would be queued.
+	SDL_SemWait(engine->thread_start);
+	while (!SDL_AtomicGet(&engine->thread_quit)) {
+		SDL_SemWaitTimeout(engine->thread_wake, SOUND_THREAD_UPDATE_MS);
+		SDL_LockMutex(engine->state_lock);
+		ApplySoundCommands();
+		TraceCall(TraceOp_Update);
+		UpdateAl();
+		SDL_UnlockMutex(engine->state_lock);
+	}
+	SDL_LockMutex(engine->state_lock);
+	ApplySoundCommands();
+	SDL_UnlockMutex(engine->state_lock);
+	return 0;
+}
+
+static void ApplySoundCommands(void) {
+	gsEngine *engine = CurrentEngine();
+	gsPlayRequest plays[SOUND_COMMAND_PLAY_BATCH];
+	int num_plays = 0;
+	SoundCommand command;
+	while (PopSoundCommand(engine->command_queue, &command)) {
+		if (command.type == SoundCommand_PlaySfx) {
+			plays[num_plays++] = command.play;
+			if (num_plays == SOUND_COMMAND_PLAY_BATCH) {
+				gsPlaySfxBatch(plays, num_plays, NULL);
+				num_plays = 0;
+			}
+			continue;
+		}
+		// Keep the order, so plays queued before this command start before it runs.
+		if (num_plays) {
+			gsPlaySfxBatch(plays, num_plays, NULL);
+			num_plays = 0;
+		}
+		ApplySoundCommand(&command);
+	}
+	if (num_plays)
+		gsPlaySfxBatch(plays, num_plays, NULL);
+}
+
+static void ApplySoundCommand(const SoundCommand *command) {
+	switch (command->type) {
+		case SoundCommand_PlaySfx:
+			gsPlaySfxBatch(&command->play, 1, NULL);
+			break;
+		case SoundCommand_StopVoice:
+			gsStopVoice(command->voice.voice);
+			break;
+		case SoundCommand_SetVoiceVolume:
+			gsSetVoiceVolume(command->voice.voice, command->voice.value);
+			break;
+		case SoundCommand_SetVoicePitch:
+			gsSetVoicePitch(command->voice.voice, command->voice.value);
+			break;
+		case SoundCommand_SetVoicePan:
+			gsSetVoicePan(command->voice.voice, command->voice.value);
+			break;
+		case SoundCommand_LoadSfx:
+			gsLoadSfx(command->sfx);
+			break;
+		case SoundCommand_UnloadSfx:
+			gsUnloadSfx(command->sfx);
+			break;
+		case SoundCommand_SetSfxLimits:
+			gsSetSfxLimits(command->limits.sfx, command->limits.max_instances, command->limits.min_retrigger_seconds, command->limits.coalesce);
+			break;
+		case SoundCommand_PreLoadBgm:
+			gsPreLoadBgm(command->bgm.bgm, command->bgm.background);
+			break;
+		case SoundCommand_PlayBgm:
+			gsPlayBgm(command->volume);
+			break;
+		case SoundCommand_PlayBackgroundBgm:
+			gsPlayBackgroundBgm(command->volume);
+			break;
+		case SoundCommand_StopBgm:
+			gsStopBgm();
+			break;
+		case SoundCommand_StopBackgroundBgm:
+			gsStopBackgroundBgm();
+			break;
+		case SoundCommand_PauseBgm:
+			gsPauseBgm();
+			break;
+		case SoundCommand_UnPauseBgm:
+			gsUnPauseBgm();
+			break;
+		case SoundCommand_SetPlayerLoops:
+			gsSetPlayerLoops(command->loops);
+			break;
+		case SoundCommand_SetSfxFinishedCallback:
+			gsSetSfxFinishedCallback(command->callback.callback, command->callback.userdata);
+			break;
+		case SoundCommand_SetPcmBudget:
+			gsSetPcmBudget(command->bytes);
+			break;
+		case SoundCommand_BgmSeek:
+			gsBgmSeek(command->seek.background, command->seek.seconds);
+			break;
+		case SoundCommand_SetEmitterPosition:
+			// Moves only reach the mixer on update, so applying them one at a time costs the same as together.
+			gsSetEmitterPositions(&command->emitter.voice, command->emitter.position, 1);
+			break;
+		case SoundCommand_SetListener:
+			gsSetListener(&command->listener);
+			break;
+		case SoundCommand_SetVoiceOccluded:
+			gsSetVoiceOccluded(command->occlusion.voice, command->occlusion.occluded);
+			break;
+		case SoundCommand_ReleaseArena:
+			ReleaseArena(command->arena.arena, command->arena.destroy);
+			SDL_SemPost(command->arena.done);
+			break;
+		case SoundCommand_PreLoadStems:
+			gsPreLoadStems(command->stems);
+			break;
+		case SoundCommand_PlayStems:
+			gsPlayStems(command->volume);
+			break;
+		case SoundCommand_StopStems:
+			gsStopStems();
+			break;
+		case SoundCommand_PauseStems:
+			gsPauseStems();
+			break;
+		case SoundCommand_UnPauseStems:
+			gsUnPauseStems();
+			break;
+		case SoundCommand_SetStemGain:
+			gsSetStemGain(command->stem_gain.stem, command->stem_gain.gain, command->stem_gain.seconds);
+			break;
+		case SoundCommand_StemsSeek:
+			gsStemsSeek(command->seconds);
+			break;
+		case SoundCommand_StopVoiceScheduled:
+			gsStopVoiceScheduled(command->scheduled.voice, command->scheduled.frame);
+			break;
+		case SoundCommand_PlayBgmScheduled:
+			gsPlayBgmScheduled(command->scheduled.volume, command->scheduled.frame);
+			break;
+		case SoundCommand_SetBusVolume:
+			gsSetBusVolume(command->bus.bus, command->bus.volume);
+			break;
+		case SoundCommand_SetBusMuted:
+			gsSetBusMuted(command->bus.bus, command->bus.value);
+			break;
+		case SoundCommand_SetBusPaused:
+			gsSetBusPaused(command->bus.bus, command->bus.value);
+			break;
+		case SoundCommand_SetBusParent:
+			gsSetBusParent(command->bus.bus, (gsBus)command->bus.value);
+			break;
+		case SoundCommand_FadeVoice:
+			gsFadeVoice(command->fade.voice, command->fade.volume, command->fade.seconds, command->fade.stop);
+			break;
+		case SoundCommand_FadeBgm:
+			gsFadeBgm(command->fade.background, command->fade.volume, command->fade.seconds, command->fade.stop);
+			break;
+	}
+}
+
 gsBgm *gsLoadBgm(const char *filename_suffix) {
-	gsBgm *bgm = calloc(1, sizeof(*bgm));
+	gsArena *arena = CurrentArena();
+	gsBgm *bgm = AssetMalloc(arena, sizeof(*bgm));
+	memset(bgm, 0, sizeof(*bgm));
 	// We need to add one here, since strlen and len do not include their null terminator, and we need that in our string and we are going to combine things.
 	size_t name_length = strlen(filename_suffix) + 1;
-	char *full_name = malloc(name_length * sizeof(char));
+	char *full_name = AssetMalloc(arena, name_length * sizeof(char));
 	snprintf(full_name, name_length, "%s", filename_suffix);
 	bgm->bgm_name = full_name;
+	if (arena)
+		ArenaAddAsset(arena, bgm, ArenaAsset_Bgm);
 	return bgm;
 }
 
 void gsUnloadBgm(gsBgm *bgm) {
 	if (!bgm) return;
-	free(bgm->bgm_name);
+	if (TraceEnabled()) {
+		TraceCall(TraceOp_UnloadBgm, TraceBgm(bgm));
+		TraceForgetBgm(bgm);
+	}
+	ArenaRemoveAsset(bgm);
+	AssetFree(bgm->bgm_name);
 	bgm->bgm_name = NULL;
-	free(bgm);
+	AssetFree(bgm);
 	bgm = NULL;
 }
 
@@ -36,77 +347,769 @@ int gsPreLoadBgm(gsBgm *bgm, int background) {
 		fprintf(stderr, "Trying to preload a invalid bgm\n");
 		return false;
 	}
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PreLoadBgm, .bgm = {bgm, background}};
+		return QueueCommand(&command);
+	}
 	if (background) {
 		PreBakeBackgroundBgm(bgm->bgm_name);
 	} else {
 		PreBakeBgm(bgm->bgm_name);
 	}
+	TraceCall(TraceOp_PreLoadBgm, TraceBgm(bgm), background);
 	return true;
 }
 
 gsSfx *gsNewSfx(const char *filename) {
-	gsSfx *sfx = malloc(sizeof(*sfx));
+	gsArena *arena = CurrentArena();
+	gsSfx *sfx = AssetMalloc(arena, sizeof(*sfx));
 	size_t name_length = strlen(filename) + 1;
-	char *full_name = malloc(name_length * sizeof(char));
+	char *full_name = AssetMalloc(arena, name_length * sizeof(char));
 	snprintf(full_name, name_length, "%s", filename);
 	sfx->sfx_name = full_name;
 	sfx->loaded_sfx = NULL;
+	sfx->priority = 0;
+	sfx->max_instances = 0;
+	sfx->min_retrigger_seconds = 0;
+	sfx->coalesce = 0;
+	sfx->stream = 0;
+	sfx->min_distance = 0;
+	sfx->max_distance = 0;
+	sfx->bus = 0;
+	if (arena)
+		ArenaAddAsset(arena, sfx, ArenaAsset_Sfx);
 	return sfx;
 }
 
 int gsPlayBgm(float volume) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PlayBgm, .volume = volume};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_PlayBgm, (double)volume);
 	return PlayBgmAl(volume);
 }
 
+int gsPlayBgmScheduled(float volume, uint64_t frame) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PlayBgmScheduled, .scheduled = {0, volume, frame}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_PlayBgmScheduled, (double)volume, frame);
+	return PlayBgmScheduledAl(volume, frame);
+}
+
+uint64_t gsGetSoundClock(void) {
+	gsEngine *engine = CurrentEngine();
+	if (!ShouldQueueCommand()) {
+		TraceCall(TraceOp_GetSoundClock);
+		return GetSoundClockAl();
+	}
+	if (!engine->state_lock)
+		return 0;
+	SDL_LockMutex(engine->state_lock);
+	TraceCall(TraceOp_GetSoundClock);
+	uint64_t clock = GetSoundClockAl();
+	SDL_UnlockMutex(engine->state_lock);
+	return clock;
+}
+
+int gsGetSoundSampleRate(void) {
+	// Set once when sound is initialized, so it is safe to read from any thread.
+	return GetSoundSampleRateAl();
+}
+
 int gsPlayBackgroundBgm(float volume) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PlayBackgroundBgm, .volume = volume};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_PlayBackgroundBgm, (double)volume);
 	return PlayBgmBackgroundAl(volume);
 }
 
 int gsStopBgm(void) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_StopBgm};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_StopBgm);
 	return StopBgmAl();
 }
 
 int gsStopBackgroundBgm(void) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_StopBackgroundBgm};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_StopBackgroundBgm);
 	return StopBackgroundBgmAl();
 }
 int gsPauseBgm(void) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PauseBgm};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_PauseBgm);
 	return PauseBgmAl();
 }
 int gsUnPauseBgm(void) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_UnPauseBgm};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_UnPauseBgm);
 	return UnpauseBgmAl();
 }
 
-int gsPlaySfxOneShot(gsSfx *sfx, float volume) {
+gsVoice gsPlaySfxOneShot(gsSfx *sfx, float volume) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PlaySfx, .play = {sfx, volume, 1.0f, 0, 0}};
+		QueueCommand(&command);
+		return 0;
+	}
+	if (!sfx->loaded_sfx) {
+		sfx->loaded_sfx = LoadSfxFileAl(sfx->sfx_name, sfx->stream, AssetArena(sfx));
+	}
+	gsVoice voice = PlaySfxAl(sfx, volume, 0);
+	TraceCall(TraceOp_PlaySfxOneShot, TraceSfx(sfx), (double)volume, voice);
+	return voice;
+}
+
+gsVoice gsPlaySfxLooped(gsSfx *sfx, float volume) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PlaySfx, .play = {sfx, volume, 1.0f, 0, 1}};
+		QueueCommand(&command);
+		return 0;
+	}
+	if (!sfx->loaded_sfx) {
+		sfx->loaded_sfx = LoadSfxFileAl(sfx->sfx_name, sfx->stream, AssetArena(sfx));
+	}
+	gsVoice voice = PlaySfxAl(sfx, volume, 1);
+	TraceCall(TraceOp_PlaySfxLooped, TraceSfx(sfx), (double)volume, voice);
+	return voice;
+}
+
+gsVoice gsPlaySfxAt(gsSfx *sfx, float volume, float x, float y, float z) {
+	gsPlayRequest request = {sfx, volume, 1.0f, 0, 0, 1, {x, y, z}, 0};
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PlaySfx, .play = request};
+		QueueCommand(&command);
+		return 0;
+	}
+	if (!sfx->loaded_sfx) {
+		sfx->loaded_sfx = LoadSfxFileAl(sfx->sfx_name, sfx->stream, AssetArena(sfx));
+	}
+	gsVoice voice = 0;
+	PlaySfxBatchAl(&request, 1, &voice);
+	TraceCall(TraceOp_PlaySfxAt, TraceSfx(sfx), (double)volume, 0, (double)x, (double)y, (double)z, voice);
+	return voice;
+}
+
+gsVoice gsPlaySfxLoopedAt(gsSfx *sfx, float volume, float x, float y, float z) {
+	gsPlayRequest request = {sfx, volume, 1.0f, 0, 1, 1, {x, y, z}, 0};
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PlaySfx, .play = request};
+		QueueCommand(&command);
+		return 0;
+	}
 	if (!sfx->loaded_sfx) {
-		sfx->loaded_sfx = LoadSfxFileAl(sfx->sfx_name);
+		sfx->loaded_sfx = LoadSfxFileAl(sfx->sfx_name, sfx->stream, AssetArena(sfx));
+	}
+	gsVoice voice = 0;
+	PlaySfxBatchAl(&request, 1, &voice);
+	TraceCall(TraceOp_PlaySfxAt, TraceSfx(sfx), (double)volume, 1, (double)x, (double)y, (double)z, voice);
+	return voice;
+}
+
+int gsPlaySfxBatch(const gsPlayRequest *requests, int count, gsVoice *voices) {
+	if (ShouldQueueCommand()) {
+		int queued = 0;
+		for (int i = 0; i < count; ++i) {
+			SoundCommand command = {.type = SoundCommand_PlaySfx, .play = requests[i]};
+			queued += QueueCommand(&command);
+			if (voices)
+				voices[i] = 0;
+		}
+		return queued;
+	}
+	for (int i = 0; i < count; ++i) {
+		gsSfx *sfx = requests[i].sfx;
+		if (sfx && !sfx->loaded_sfx) {
+			sfx->loaded_sfx = LoadSfxFileAl(sfx->sfx_name, sfx->stream, AssetArena(sfx));
+		}
+	}
+	if (!TraceEnabled())
+		return PlaySfxBatchAl(requests, count, voices);
+	// The voices are needed for the trace even if the caller doesn't want them.
+	gsVoice *started = voices ? voices : SoundMalloc(count * sizeof(*started));
+	int num_started = PlaySfxBatchAl(requests, count, started);
+	// Any NewSfx or SfxState records go before the batch, so its items are written together.
+	for (int i = 0; i < count; ++i)
+		TraceSfx(requests[i].sfx);
+	TraceCall(TraceOp_PlaySfxBatch, (unsigned int)count);
+	for (int i = 0; i < count; ++i) {
+		const gsPlayRequest *request = &requests[i];
+		TraceCall(TraceOp_PlaySfxBatchItem, TraceSfx(request->sfx), (double)request->volume, (double)request->pitch, (double)request->pan, request->looping, started[i],
+				  request->positional, (double)request->position[0], (double)request->position[1], (double)request->position[2], request->start_frame);
+	}
+	if (started != voices)
+		SoundFree(started);
+	return num_started;
+}
+
+int gsStopVoice(gsVoice voice) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_StopVoice, .voice = {voice, 0}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_StopVoice, voice);
+	return StopVoiceAl(voice);
+}
+
+gsVoice gsPlaySfxScheduled(gsSfx *sfx, float volume, uint64_t frame) {
+	gsPlayRequest request = {sfx, volume, 1.0f, 0, 0, 0, {0}, frame};
+	gsVoice voice = 0;
+	gsPlaySfxBatch(&request, 1, &voice);
+	return voice;
+}
+
+int gsStopVoiceScheduled(gsVoice voice, uint64_t frame) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_StopVoiceScheduled, .scheduled = {voice, 0, frame}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_StopVoiceScheduled, voice, frame);
+	return StopVoiceScheduledAl(voice, frame);
+}
+
+int gsSetVoiceVolume(gsVoice voice, float volume) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetVoiceVolume, .voice = {voice, volume}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_SetVoiceVolume, voice, (double)volume);
+	return SetVoiceGainAl(voice, volume);
+}
+
+int gsFadeVoice(gsVoice voice, float volume, float seconds, int stop) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_FadeVoice, .fade = {voice, 0, volume, seconds, stop}};
+		return QueueCommand(&command);
 	}
-	PlaySfxAl(sfx->loaded_sfx, volume);
+	TraceCall(TraceOp_FadeVoice, voice, (double)volume, (double)seconds, stop);
+	return FadeVoiceAl(voice, volume, seconds, stop);
+}
+
+int gsSetVoicePitch(gsVoice voice, float pitch) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetVoicePitch, .voice = {voice, pitch}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_SetVoicePitch, voice, (double)pitch);
+	return SetVoicePitchAl(voice, pitch);
+}
+
+int gsSetVoicePan(gsVoice voice, float pan) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetVoicePan, .voice = {voice, pan}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_SetVoicePan, voice, (double)pan);
+	return SetVoicePanAl(voice, pan);
+}
+
+int gsSetEmitterPositions(const gsVoice *voices, const float *positions, int count) {
+	if (ShouldQueueCommand()) {
+		int queued = 0;
+		for (int i = 0; i < count; ++i) {
+			SoundCommand command = {.type = SoundCommand_SetEmitterPosition, .emitter = {voices[i], {positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]}}};
+			queued += QueueCommand(&command);
+		}
+		return queued;
+	}
+	if (TraceEnabled()) {
+		TraceCall(TraceOp_SetEmitterPositions, (unsigned int)count);
+		for (int i = 0; i < count; ++i)
+			TraceCall(TraceOp_SetEmitterPositionsItem, voices[i], (double)positions[i * 3], (double)positions[i * 3 + 1], (double)positions[i * 3 + 2]);
+	}
+	return SetEmitterPositionsAl(voices, positions, count);
+}
+
+int gsSetVoiceOccluded(gsVoice voice, int occluded) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetVoiceOccluded, .occlusion = {voice, occluded}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_SetVoiceOccluded, voice, occluded);
+	return SetVoiceOccludedAl(voice, occluded);
+}
+
+void gsSetListener(const gsListener *listener) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetListener, .listener = *listener};
+		QueueCommand(&command);
+		return;
+	}
+	TraceCall(TraceOp_SetListener, (double)listener->position[0], (double)listener->position[1], (double)listener->position[2], (double)listener->forward[0],
+			  (double)listener->forward[1], (double)listener->forward[2], (double)listener->up[0], (double)listener->up[1], (double)listener->up[2]);
+	SetListenerAl(listener);
+}
+
+int gsVoiceIsPlaying(gsVoice voice) {
+	gsEngine *engine = CurrentEngine();
+	if (!ShouldQueueCommand()) {
+		TraceCall(TraceOp_VoiceIsPlaying, voice);
+		return VoiceIsPlayingAl(voice);
+	}
+	if (!engine->state_lock)
+		return 0;
+	SDL_LockMutex(engine->state_lock);
+	TraceCall(TraceOp_VoiceIsPlaying, voice);
+	int playing = VoiceIsPlayingAl(voice);
+	SDL_UnlockMutex(engine->state_lock);
+	return playing;
+}
+
+int gsVoiceIsVirtual(gsVoice voice) {
+	gsEngine *engine = CurrentEngine();
+	if (!ShouldQueueCommand()) {
+		TraceCall(TraceOp_VoiceIsVirtual, voice);
+		return VoiceIsVirtualAl(voice);
+	}
+	if (!engine->state_lock)
+		return 0;
+	SDL_LockMutex(engine->state_lock);
+	TraceCall(TraceOp_VoiceIsVirtual, voice);
+	int is_virtual = VoiceIsVirtualAl(voice);
+	SDL_UnlockMutex(engine->state_lock);
+	return is_virtual;
+}
+
+void gsSetSfxLimits(gsSfx *sfx, int max_instances, float min_retrigger_seconds, int coalesce) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetSfxLimits, .limits = {sfx, max_instances, min_retrigger_seconds, coalesce}};
+		QueueCommand(&command);
+		return;
+	}
+	sfx->max_instances = max_instances;
+	sfx->min_retrigger_seconds = min_retrigger_seconds;
+	sfx->coalesce = coalesce;
+	TraceCall(TraceOp_SetSfxLimits, TraceSfx(sfx), max_instances, (double)min_retrigger_seconds, coalesce);
+}
+
+void gsSetPcmBudget(size_t bytes) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetPcmBudget, .bytes = bytes};
+		QueueCommand(&command);
+		return;
+	}
+	SetPcmBudgetAl(bytes);
+	TraceCall(TraceOp_SetPcmBudget, bytes);
+}
+
+int gsGetSoundStats(gsSoundStats *stats) {
+	gsEngine *engine = CurrentEngine();
+	if (!ShouldQueueCommand()) {
+		TraceCall(TraceOp_GetSoundStats);
+		GetSoundStatsAl(stats);
+		return 1;
+	}
+	if (!engine->state_lock)
+		return 0;
+	SDL_LockMutex(engine->state_lock);
+	TraceCall(TraceOp_GetSoundStats);
+	GetSoundStatsAl(stats);
+	SDL_UnlockMutex(engine->state_lock);
 	return 1;
 }
 
+int gsGetCallbackTiming(gsCallbackTiming *timing, int reset) {
+	// The mixer takes its own lock, so this doesn't need to be queued.
+	return GetCallbackTimingAl(timing, reset);
+}
+
 int gsLoadSfx(gsSfx *sfx) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_LoadSfx, .sfx = sfx};
+		return QueueCommand(&command);
+	}
 	if (!sfx->loaded_sfx) {
-		sfx->loaded_sfx = LoadSfxFileAl(sfx->sfx_name);
+		sfx->loaded_sfx = LoadSfxFileAl(sfx->sfx_name, sfx->stream, AssetArena(sfx));
 	}
-	return (sfx->loaded_sfx != NULL) ? 1 : 0;
+	int loaded = (sfx->loaded_sfx != NULL) ? 1 : 0;
+	TraceCall(TraceOp_LoadSfx, TraceSfx(sfx), loaded);
+	return loaded;
 }
 
 int gsUnloadSfx(gsSfx *sfx) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_UnloadSfx, .sfx = sfx};
+		return QueueCommand(&command);
+	}
+	if (TraceEnabled()) {
+		TraceCall(TraceOp_UnloadSfx, TraceSfx(sfx));
+		TraceForgetSfx(sfx);
+	}
 	if (sfx->loaded_sfx) {
+		StopSfxAl(sfx);
 		CloseSfxFileAl(sfx->loaded_sfx);
 	}
 	if (sfx) {
-		free(sfx->sfx_name);
+		ArenaRemoveAsset(sfx);
+		AssetFree(sfx->sfx_name);
 		sfx->sfx_name = NULL;
-		free(sfx);
+		AssetFree(sfx);
 		sfx = NULL;
 	}
 	return (sfx == NULL) ? 1 : 0;
 }
 
 void gsUpdateSound(void) {
+	gsEngine *engine = CurrentEngine();
+	// The sound thread updates itself.
+	if (!engine || engine->command_mode == gsCommandMode_Thread)
+		return;
+	if (engine->command_mode == gsCommandMode_Queued)
+		ApplySoundCommands();
+	TraceCall(TraceOp_Update);
 	UpdateAl();
 }
+
+void gsProfileBegin(const char *name) {
+	(void)name;
+	PROFILE_BEGIN(name, 0);
+}
+
+void gsProfileEnd(void) {
+	PROFILE_END();
+}
+
+int gsRenderSound(float *samples, int frames) {
+	// The mixer takes its own lock, so this doesn't need to be queued.
+	return RenderAl(samples, frames);
+}
+
+void gsCloseSound(void) {
+	gsDestroyEngine(DefaultEngine());
+}
+
+void gsDestroyEngine(gsEngine *engine) {
+	if (!engine)
+		return;
+	gsEngine *previous = BoundEngine();
+	BindEngine(engine);
+	if (engine->thread) {
+		SDL_AtomicSet(&engine->thread_quit, 1);
+		SDL_SemPost(engine->thread_wake);
+		SDL_WaitThread(engine->thread, NULL);
+		engine->thread = NULL;
+	} else if (engine->command_queue) {
+		ApplySoundCommands();
+	}
+	CloseTrace();
+	CloseAl();
+	// After the device is closed, so the mixer is done with the hooks.
+	if (engine->profiling)
+		CloseProfile();
+	DestroySoundCommandQueue(engine->command_queue);
+	if (engine->thread_wake) {
+		SDL_DestroySemaphore(engine->thread_wake);
+		SDL_DestroySemaphore(engine->thread_start);
+		SDL_DestroyMutex(engine->state_lock);
+	}
+	if (engine == DefaultEngine())
+		SetDefaultEngine(NULL);
+	BindEngine(previous == engine ? NULL : previous);
+	SoundFree(engine);
+}
+
 void gsSetPlayerLoops(int loop) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetPlayerLoops, .loops = loop};
+		QueueCommand(&command);
+		return;
+	}
 	SetPlayerLoops(loop);
+	TraceCall(TraceOp_SetPlayerLoops, loop);
+}
+
+double gsBgmTell(int background) {
+	gsEngine *engine = CurrentEngine();
+	if (!ShouldQueueCommand()) {
+		TraceCall(TraceOp_BgmTell, background);
+		return BgmTellAl(background);
+	}
+	if (!engine->state_lock)
+		return -1;
+	SDL_LockMutex(engine->state_lock);
+	TraceCall(TraceOp_BgmTell, background);
+	double seconds = BgmTellAl(background);
+	SDL_UnlockMutex(engine->state_lock);
+	return seconds;
+}
+
+int gsBgmSeek(int background, double seconds) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_BgmSeek, .seek = {background, seconds}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_BgmSeek, background, seconds);
+	return BgmSeekAl(background, seconds);
+}
+
+int gsFadeBgm(int background, float volume, float seconds, int stop) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_FadeBgm, .fade = {0, background, volume, seconds, stop}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_FadeBgm, background, (double)volume, (double)seconds, stop);
+	return FadeBgmAl(background, volume, seconds, stop);
+}
+
+gsStems *gsLoadStems(const char *const *filenames, int count) {
+	if (count < 1 || count > GS_MAX_STEMS) {
+		fprintf(stderr, "Stems need 1 to %d files, got %d\n", GS_MAX_STEMS, count);
+		return NULL;
+	}
+	gsArena *arena = CurrentArena();
+	gsStems *stems = AssetMalloc(arena, sizeof(*stems));
+	memset(stems, 0, sizeof(*stems));
+	for (int i = 0; i < count; ++i) {
+		size_t name_length = strlen(filenames[i]) + 1;
+		stems->stem_names[i] = AssetMalloc(arena, name_length * sizeof(char));
+		snprintf(stems->stem_names[i], name_length, "%s", filenames[i]);
+	}
+	stems->count = count;
+	if (arena)
+		ArenaAddAsset(arena, stems, ArenaAsset_Stems);
+	return stems;
+}
+
+void gsUnloadStems(gsStems *stems) {
+	if (!stems) return;
+	ArenaRemoveAsset(stems);
+	for (int i = 0; i < stems->count; ++i)
+		AssetFree(stems->stem_names[i]);
+	AssetFree(stems);
+}
+
+int gsPreLoadStems(gsStems *stems) {
+	if (!stems) {
+		fprintf(stderr, "Trying to preload invalid stems\n");
+		return false;
+	}
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PreLoadStems, .stems = stems};
+		return QueueCommand(&command);
+	}
+	if (TraceEnabled()) {
+		TraceCall(TraceOp_PreLoadStems, (unsigned int)stems->count);
+		for (int i = 0; i < stems->count; ++i)
+			TraceCall(TraceOp_PreLoadStemsItem, stems->stem_names[i]);
+	}
+	return PreBakeStemsAl((const char *const *)stems->stem_names, stems->count);
+}
+
+int gsPlayStems(float volume) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PlayStems, .volume = volume};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_PlayStems, (double)volume);
+	return PlayStemsAl(volume);
+}
+
+int gsStopStems(void) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_StopStems};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_StopStems);
+	return StopStemsAl();
+}
+
+int gsPauseStems(void) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_PauseStems};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_PauseStems);
+	return PauseStemsAl();
+}
+
+int gsUnPauseStems(void) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_UnPauseStems};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_UnPauseStems);
+	return UnpauseStemsAl();
+}
+
+int gsSetStemGain(int stem, float gain, float seconds) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetStemGain, .stem_gain = {stem, gain, seconds}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_SetStemGain, stem, (double)gain, (double)seconds);
+	return SetStemGainAl(stem, gain, seconds);
+}
+
+double gsStemsTell(void) {
+	gsEngine *engine = CurrentEngine();
+	if (!ShouldQueueCommand()) {
+		TraceCall(TraceOp_StemsTell);
+		return StemsTellAl();
+	}
+	if (!engine->state_lock)
+		return -1;
+	SDL_LockMutex(engine->state_lock);
+	TraceCall(TraceOp_StemsTell);
+	double seconds = StemsTellAl();
+	SDL_UnlockMutex(engine->state_lock);
+	return seconds;
+}
+
+int gsStemsSeek(double seconds) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_StemsSeek, .seconds = seconds};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_StemsSeek, seconds);
+	return StemsSeekAl(seconds);
+}
+
+int gsSetBusVolume(gsBus bus, float volume) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetBusVolume, .bus = {bus, volume, 0}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_SetBusVolume, (int)bus, (double)volume);
+	return SetBusVolumeAl(bus, volume);
+}
+
+int gsSetBusMuted(gsBus bus, int muted) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetBusMuted, .bus = {bus, 0, muted}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_SetBusMuted, (int)bus, muted);
+	return SetBusMutedAl(bus, muted);
+}
+
+int gsSetBusPaused(gsBus bus, int paused) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetBusPaused, .bus = {bus, 0, paused}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_SetBusPaused, (int)bus, paused);
+	return SetBusPausedAl(bus, paused);
+}
+
+int gsSetBusParent(gsBus bus, gsBus parent) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetBusParent, .bus = {bus, 0, (int)parent}};
+		return QueueCommand(&command);
+	}
+	TraceCall(TraceOp_SetBusParent, (int)bus, (int)parent);
+	return SetBusParentAl(bus, parent);
+}
+
+void gsSetSfxFinishedCallback(gsSfxFinishedCallback callback, void *userdata) {
+	if (ShouldQueueCommand()) {
+		SoundCommand command = {.type = SoundCommand_SetSfxFinishedCallback, .callback = {callback, userdata}};
+		QueueCommand(&command);
+		return;
+	}
+	SetSfxFinishedCallbackAl(callback, userdata);
+}
+
+int gsSetAllocator(const gsAllocator *allocator) {
+	int set = allocator && allocator->malloc && allocator->realloc && allocator->free;
+	// Fails while the device is open, since the mixer's memory would be freed with the wrong allocator.
+	if (!alAllocatorSG(set ? AlMallocHook : NULL, set ? AlReallocHook : NULL, set ? AlFreeHook : NULL, NULL))
+		return 0;
+	if (set)
+		SetSoundAllocator(allocator->malloc, allocator->realloc, allocator->free, allocator->userdata);
+	else
+		SetSoundAllocator(NULL, NULL, NULL, NULL);
+	return 1;
+}
+
+static void *AL_APIENTRY AlMallocHook(size_t size, void *userdata) {
+	(void)userdata;
+	return SoundMalloc(size);
+}
+
+static void *AL_APIENTRY AlReallocHook(void *ptr, size_t size, void *userdata) {
+	(void)userdata;
+	return SoundRealloc(ptr, size);
+}
+
+static void AL_APIENTRY AlFreeHook(void *ptr, void *userdata) {
+	(void)userdata;
+	SoundFree(ptr);
+}
+
+gsArena *gsCreateArena(size_t block_size) {
+	return CreateArena(block_size);
+}
+
+gsArena *gsSetArena(gsArena *arena) {
+	gsArena *previous = CurrentArena();
+	SetCurrentArena(arena);
+	return previous;
+}
+
+int gsResetArena(gsArena *arena) {
+	if (!arena)
+		return 0;
+	if (ShouldQueueCommand())
+		return QueueReleaseArena(arena, 0);
+	ReleaseArena(arena, 0);
+	return 1;
+}
+
+int gsDestroyArena(gsArena *arena) {
+	if (!arena)
+		return 0;
+	if (ShouldQueueCommand())
+		return QueueReleaseArena(arena, 1);
+	ReleaseArena(arena, 1);
+	return 1;
+}
+
+static void ReleaseArena(gsArena *arena, int destroy) {
+	// Unloading forgets the asset, which only clears its entry, so the list can still be walked.
+	for (ArenaAsset *entry = ArenaAssets(arena); entry; entry = entry->next) {
+		if (!entry->asset)
+			continue;
+		switch (entry->kind) {
+			case ArenaAsset_Sfx:
+				gsUnloadSfx(entry->asset);
+				break;
+			case ArenaAsset_Bgm:
+				gsUnloadBgm(entry->asset);
+				break;
+			case ArenaAsset_Stems:
+				gsUnloadStems(entry->asset);
+				break;
+		}
+	}
+	if (destroy)
+		DestroyArena(arena);
+	else
+		ResetArena(arena);
+}
+
+static int QueueReleaseArena(gsArena *arena, int destroy) {
+	// Plays queued before this could use the arena's sfx, so it has to wait its turn, and the caller can't reuse the arena until then.
+	SDL_sem *done = SDL_CreateSemaphore(0);
+	SoundCommand command = {.type = SoundCommand_ReleaseArena, .arena = {arena, destroy, done}};
+	int queued = QueueCommand(&command);
+	if (queued)
+		SDL_SemWait(done);
+	SDL_DestroySemaphore(done);
+	return queued;
 }
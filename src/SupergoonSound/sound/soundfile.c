@@ -0,0 +1,205 @@
+#include <SupergoonSound/gnpch.h>
+#include <SupergoonSound/base/allocator.h>
+#include <SupergoonSound/sound/arena.h>
+#include <SupergoonSound/sound/soundfile.h>
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define SOUND_FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_FLOAT 3
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+#define OGG_PAGE_HEADER_SIZE 27
+
+/**
+ * @brief Reads little endian values, wav is always little endian.
+ */
+static unsigned int ReadLe16(const unsigned char *data);
+static unsigned long ReadLe32(const unsigned char *data);
+/**
+ * @brief Adds a page to the end of an index, growing it if needed.
+ *
+ * @return 1 if it was added, 0 if it couldn't grow.
+ */
+static int AddOggPage(OggPageIndex *index, int64_t granule, int64_t offset);
+
+unsigned char *MapSoundFile(const char *filename, size_t *size, int *mapped, gsArena *arena) {
+	*mapped = 0;
+#ifdef SOUND_FILE_MMAP
+	int fd = open(filename, O_RDONLY);
+	if (fd != -1) {
+		struct stat file_stat;
+		void *data = MAP_FAILED;
+		if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+			data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// The mapping keeps the file open.
+		close(fd);
+		if (data != MAP_FAILED) {
+			*size = file_stat.st_size;
+			*mapped = 1;
+			return data;
+		}
+	}
+#endif
+	// Read ourselves instead of with SDL_LoadFile, so it comes from our allocator.
+	SDL_RWops *file = SDL_RWFromFile(filename, "rb");
+	if (!file)
+		return NULL;
+	Sint64 file_size = SDL_RWsize(file);
+	unsigned char *data = file_size > 0 ? AssetMalloc(arena, (size_t)file_size) : NULL;
+	if (data && SDL_RWread(file, data, 1, (size_t)file_size) != (size_t)file_size) {
+		AssetFree(data);
+		data = NULL;
+	}
+	SDL_RWclose(file);
+	if (data)
+		*size = (size_t)file_size;
+	return data;
+}
+
+void UnmapSoundFile(unsigned char *data, size_t size, int mapped) {
+	if (!data)
+		return;
+#ifdef SOUND_FILE_MMAP
+	if (mapped) {
+		munmap(data, size);
+		return;
+	}
+#else
+	(void)size;
+	(void)mapped;
+#endif
+	AssetFree(data);
+}
+
+int IsWav(const unsigned char *data, size_t size) {
+	return size >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WAVE", 4) == 0;
+}
+
+int ParseWav(const unsigned char *data, size_t size, WavInfo *info) {
+	if (!IsWav(data, size))
+		return 0;
+	int format = 0;
+	size_t block_align = 0;
+	memset(info, 0, sizeof(*info));
+	size_t position = 12;
+	while (position + 8 <= size) {
+		const unsigned char *chunk = data + position;
+		size_t chunk_size = ReadLe32(chunk + 4);
+		size_t available = size - position - 8;
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 && available >= 16) {
+			format = ReadLe16(chunk + 8);
+			info->channels = ReadLe16(chunk + 10);
+			info->sample_rate = ReadLe32(chunk + 12);
+			block_align = ReadLe16(chunk + 20);
+			info->bits = ReadLe16(chunk + 22);
+			// Extensible puts the real format at the start of the sub format guid.
+			if (format == WAV_FORMAT_EXTENSIBLE && chunk_size >= 40 && available >= 40)
+				format = ReadLe16(chunk + 32);
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			info->samples = chunk + 8;
+			// Files cut short still play what they have.
+			info->samples_size = chunk_size < available ? chunk_size : available;
+			break;
+		}
+		// Chunks are padded to an even size.
+		position += 8 + chunk_size + (chunk_size & 1);
+	}
+	if (!info->samples || (info->channels != 1 && info->channels != 2) || !info->sample_rate)
+		return 0;
+	if (format == WAV_FORMAT_PCM && (info->bits == 16 || info->bits == 24)) {
+		info->is_float = 0;
+	} else if (format == WAV_FORMAT_FLOAT && info->bits == 32) {
+		info->is_float = 1;
+	} else {
+		return 0;
+	}
+	size_t frame_size = info->channels * (info->bits / 8);
+	if (block_align != frame_size)
+		return 0;
+	info->frames = info->samples_size / frame_size;
+	info->samples_size = info->frames * frame_size;
+	return 1;
+}
+
+int BuildOggPageIndex(const char *filename, OggPageIndex *index) {
+	FreeOggPageIndex(index);
+	FILE *file = fopen(filename, "rb");
+	if (!file)
+		return 0;
+	unsigned char header[OGG_PAGE_HEADER_SIZE];
+	unsigned char segments[255];
+	uint32_t serial = 0;
+	int64_t offset = 0;
+	while (fread(header, 1, OGG_PAGE_HEADER_SIZE, file) == OGG_PAGE_HEADER_SIZE && memcmp(header, "OggS", 4) == 0) {
+		int num_segments = header[26];
+		if (fread(segments, 1, num_segments, file) != (size_t)num_segments)
+			break;
+		long body_size = 0;
+		for (int i = 0; i < num_segments; ++i)
+			body_size += segments[i];
+		uint32_t page_serial = ReadLe32(header + 14);
+		if (offset == 0)
+			serial = page_serial;
+		// Only the first logical stream is played, and pages that don't finish a packet have no position.
+		int64_t granule = (int64_t)((uint64_t)ReadLe32(header + 6) | (uint64_t)ReadLe32(header + 10) << 32);
+		if (page_serial == serial && granule != -1 && !AddOggPage(index, granule, offset))
+			break;
+		offset += OGG_PAGE_HEADER_SIZE + num_segments + body_size;
+		// Skip the body, only the headers are needed.
+		if (fseek(file, (long)offset, SEEK_SET) != 0)
+			break;
+	}
+	fclose(file);
+	return index->count > 0;
+}
+
+void FreeOggPageIndex(OggPageIndex *index) {
+	SoundFree(index->granules);
+	SoundFree(index->offsets);
+	memset(index, 0, sizeof(*index));
+}
+
+int FindOggPage(const OggPageIndex *index, int64_t frame) {
+	// First page ending at or after the frame, the one before it is where decoding has to start.
+	int low = 0, high = index->count;
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+		if (index->granules[middle] < frame)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low - 1;
+}
+
+static int AddOggPage(OggPageIndex *index, int64_t granule, int64_t offset) {
+	if (index->count == index->capacity) {
+		int capacity = index->capacity ? index->capacity * 2 : 256;
+		int64_t *granules = SoundRealloc(index->granules, capacity * sizeof(*granules));
+		if (!granules)
+			return 0;
+		index->granules = granules;
+		int64_t *offsets = SoundRealloc(index->offsets, capacity * sizeof(*offsets));
+		if (!offsets)
+			return 0;
+		index->offsets = offsets;
+		index->capacity = capacity;
+	}
+	index->granules[index->count] = granule;
+	index->offsets[index->count] = offset;
+	++index->count;
+	return 1;
+}
+
+static unsigned int ReadLe16(const unsigned char *data) {
+	return data[0] | (data[1] << 8);
+}
+
+static unsigned long ReadLe32(const unsigned char *data) {
+	return data[0] | (data[1] << 8) | ((unsigned long)data[2] << 16) | ((unsigned long)data[3] << 24);
+}
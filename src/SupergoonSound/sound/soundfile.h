@@ -0,0 +1,89 @@
+/**
+ * @file soundfile.h
+ * @brief Maps sound files into memory, reads RIFF/WAVE headers so their samples can be used in place, and indexes ogg pages for seeking.
+ * @author Kevin Blanchard
+ * @version 0.1
+ * @date 2026-10-18
+ */
+#pragma once
+#include <SupergoonSound/include/sound.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Where the samples are in a wav file, and how they are stored.
+ */
+typedef struct WavInfo {
+	int channels;
+	long sample_rate;
+	// 16 or 24 for integer pcm, 32 for float.
+	int bits;
+	int is_float;
+	// Points into the file data.
+	const unsigned char *samples;
+	size_t samples_size;
+	// Length in sample frames.
+	long frames;
+} WavInfo;
+
+/**
+ * @brief Where each page of an ogg file starts, and the sample frame it ends on, so seeks can go straight to the right page.
+ */
+typedef struct OggPageIndex {
+	int64_t *granules;
+	int64_t *offsets;
+	int count;
+	int capacity;
+} OggPageIndex;
+
+/**
+ * @brief Maps a file read only, or reads it into memory where mapping isn't available.
+ *
+ * @param filename The file to open.
+ * @param size Set to the file size.
+ * @param mapped Set to 1 if it was mapped, pass it to UnmapSoundFile.
+ * @param arena Where a file that can't be mapped is read to, NULL to use the allocator.
+ *
+ * @return The file data, or NULL if it couldn't be opened.
+ */
+unsigned char *MapSoundFile(const char *filename, size_t *size, int *mapped, gsArena *arena);
+/**
+ * @brief Releases a file from MapSoundFile.
+ */
+void UnmapSoundFile(unsigned char *data, size_t size, int mapped);
+/**
+ * @brief Checks if file data starts with a RIFF/WAVE header.
+ */
+int IsWav(const unsigned char *data, size_t size);
+/**
+ * @brief Reads a wav header.  Mono and stereo, 16 and 24 bit pcm, and 32 bit float are supported.
+ *
+ * @param data The whole file.
+ * @param size The file size.
+ * @param info Filled with the format and where the samples are.
+ *
+ * @return 1 if it is a supported wav, 0 if not.
+ */
+int ParseWav(const unsigned char *data, size_t size, WavInfo *info);
+/**
+ * @brief Indexes the pages of an ogg file, reading only the page headers.  Pages after a damaged one aren't indexed.
+ *
+ * @param filename The file to index.
+ * @param index Filled with the pages, free it with FreeOggPageIndex.
+ *
+ * @return 1 if any pages were indexed, 0 if not.
+ */
+int BuildOggPageIndex(const char *filename, OggPageIndex *index);
+/**
+ * @brief Frees an index's pages, it can be built again after.
+ */
+void FreeOggPageIndex(OggPageIndex *index);
+/**
+ * @brief Finds the page to start decoding from to reach a sample frame.
+ *
+ * @param index The index to search.
+ * @param frame The frame to reach.
+ *
+ * @return The last page that ends before the frame, -1 if the frame is in the first page.
+ */
+int FindOggPage(const OggPageIndex *index, int64_t frame);
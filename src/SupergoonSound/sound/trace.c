@@ -0,0 +1,564 @@
+#include <SupergoonSound/gnpch.h>
+#include <SupergoonSound/base/allocator.h>
+#include <SupergoonSound/sound/engine.h>
+#include <SupergoonSound/sound/trace.h>
+
+#define TRACE_BUFFER_SIZE 65536	 // Bytes of records held before writing them to the file.
+#define TRACE_MAP_START 64		 // Starting number of sfx or bgm pointers that can be looked up, power of two.
+
+const char *const trace_op_signatures[TraceOp_Count] = {
+	[TraceOp_Init] = "iiiifzif",
+	[TraceOp_Close] = "",
+	[TraceOp_Update] = "",
+	[TraceOp_NewSfx] = "us",
+	[TraceOp_SfxState] = "uiifiiffi",
+	[TraceOp_LoadSfx] = "ui",
+	[TraceOp_UnloadSfx] = "u",
+	[TraceOp_SetSfxLimits] = "uifi",
+	[TraceOp_PlaySfxOneShot] = "ufu",
+	[TraceOp_PlaySfxLooped] = "ufu",
+	[TraceOp_PlaySfxBatch] = "u",
+	[TraceOp_PlaySfxBatchItem] = "ufffiuifffl",
+	[TraceOp_StopVoice] = "u",
+	[TraceOp_SetVoiceVolume] = "uf",
+	[TraceOp_SetVoicePitch] = "uf",
+	[TraceOp_SetVoicePan] = "uf",
+	[TraceOp_VoiceIsPlaying] = "u",
+	[TraceOp_VoiceIsVirtual] = "u",
+	[TraceOp_NewBgm] = "usdd",
+	[TraceOp_UnloadBgm] = "u",
+	[TraceOp_PreLoadBgm] = "ui",
+	[TraceOp_PlayBgm] = "f",
+	[TraceOp_PlayBackgroundBgm] = "f",
+	[TraceOp_StopBgm] = "",
+	[TraceOp_StopBackgroundBgm] = "",
+	[TraceOp_PauseBgm] = "",
+	[TraceOp_UnPauseBgm] = "",
+	[TraceOp_SetPlayerLoops] = "i",
+	[TraceOp_BgmTell] = "i",
+	[TraceOp_BgmSeek] = "id",
+	[TraceOp_SetPcmBudget] = "z",
+	[TraceOp_GetSoundStats] = "",
+	[TraceOp_PlaySfxAt] = "ufifffu",
+	[TraceOp_SetEmitterPositions] = "u",
+	[TraceOp_SetEmitterPositionsItem] = "ufff",
+	[TraceOp_SetListener] = "fffffffff",
+	[TraceOp_SetVoiceOccluded] = "ui",
+	[TraceOp_PreLoadStems] = "u",
+	[TraceOp_PreLoadStemsItem] = "s",
+	[TraceOp_PlayStems] = "f",
+	[TraceOp_StopStems] = "",
+	[TraceOp_PauseStems] = "",
+	[TraceOp_UnPauseStems] = "",
+	[TraceOp_SetStemGain] = "iff",
+	[TraceOp_StemsTell] = "",
+	[TraceOp_StemsSeek] = "d",
+	[TraceOp_StopVoiceScheduled] = "ul",
+	[TraceOp_PlayBgmScheduled] = "fl",
+	[TraceOp_GetSoundClock] = "",
+	[TraceOp_SetBusVolume] = "if",
+	[TraceOp_SetBusMuted] = "ii",
+	[TraceOp_SetBusPaused] = "ii",
+	[TraceOp_SetBusParent] = "ii",
+	[TraceOp_FadeVoice] = "uffi",
+	[TraceOp_FadeBgm] = "iffi",
+};
+
+const char *const trace_op_names[TraceOp_Count] = {
+	[TraceOp_Init] = "Init",
+	[TraceOp_Close] = "Close",
+	[TraceOp_Update] = "Update",
+	[TraceOp_NewSfx] = "NewSfx",
+	[TraceOp_SfxState] = "SfxState",
+	[TraceOp_LoadSfx] = "LoadSfx",
+	[TraceOp_UnloadSfx] = "UnloadSfx",
+	[TraceOp_SetSfxLimits] = "SetSfxLimits",
+	[TraceOp_PlaySfxOneShot] = "PlaySfxOneShot",
+	[TraceOp_PlaySfxLooped] = "PlaySfxLooped",
+	[TraceOp_PlaySfxBatch] = "PlaySfxBatch",
+	[TraceOp_PlaySfxBatchItem] = "PlaySfxBatchItem",
+	[TraceOp_StopVoice] = "StopVoice",
+	[TraceOp_SetVoiceVolume] = "SetVoiceVolume",
+	[TraceOp_SetVoicePitch] = "SetVoicePitch",
+	[TraceOp_SetVoicePan] = "SetVoicePan",
+	[TraceOp_VoiceIsPlaying] = "VoiceIsPlaying",
+	[TraceOp_VoiceIsVirtual] = "VoiceIsVirtual",
+	[TraceOp_NewBgm] = "NewBgm",
+	[TraceOp_UnloadBgm] = "UnloadBgm",
+	[TraceOp_PreLoadBgm] = "PreLoadBgm",
+	[TraceOp_PlayBgm] = "PlayBgm",
+	[TraceOp_PlayBackgroundBgm] = "PlayBackgroundBgm",
+	[TraceOp_StopBgm] = "StopBgm",
+	[TraceOp_StopBackgroundBgm] = "StopBackgroundBgm",
+	[TraceOp_PauseBgm] = "PauseBgm",
+	[TraceOp_UnPauseBgm] = "UnPauseBgm",
+	[TraceOp_SetPlayerLoops] = "SetPlayerLoops",
+	[TraceOp_BgmTell] = "BgmTell",
+	[TraceOp_BgmSeek] = "BgmSeek",
+	[TraceOp_SetPcmBudget] = "SetPcmBudget",
+	[TraceOp_GetSoundStats] = "GetSoundStats",
+	[TraceOp_PlaySfxAt] = "PlaySfxAt",
+	[TraceOp_SetEmitterPositions] = "SetEmitterPositions",
+	[TraceOp_SetEmitterPositionsItem] = "SetEmitterPositionsItem",
+	[TraceOp_SetListener] = "SetListener",
+	[TraceOp_SetVoiceOccluded] = "SetVoiceOccluded",
+	[TraceOp_PreLoadStems] = "PreLoadStems",
+	[TraceOp_PreLoadStemsItem] = "PreLoadStemsItem",
+	[TraceOp_PlayStems] = "PlayStems",
+	[TraceOp_StopStems] = "StopStems",
+	[TraceOp_PauseStems] = "PauseStems",
+	[TraceOp_UnPauseStems] = "UnPauseStems",
+	[TraceOp_SetStemGain] = "SetStemGain",
+	[TraceOp_StemsTell] = "StemsTell",
+	[TraceOp_StemsSeek] = "StemsSeek",
+	[TraceOp_StopVoiceScheduled] = "StopVoiceScheduled",
+	[TraceOp_PlayBgmScheduled] = "PlayBgmScheduled",
+	[TraceOp_GetSoundClock] = "GetSoundClock",
+	[TraceOp_SetBusVolume] = "SetBusVolume",
+	[TraceOp_SetBusMuted] = "SetBusMuted",
+	[TraceOp_SetBusPaused] = "SetBusPaused",
+	[TraceOp_SetBusParent] = "SetBusParent",
+	[TraceOp_FadeVoice] = "FadeVoice",
+	[TraceOp_FadeBgm] = "FadeBgm",
+};
+
+/**
+ * @brief A sfx or bgm that has been written, and the sfx fields last written for it.
+ */
+typedef struct TraceMapEntry {
+	const void *key;
+	unsigned int id;
+	int priority;
+	int max_instances;
+	float min_retrigger_seconds;
+	int coalesce;
+	int stream;
+	float min_distance;
+	float max_distance;
+	gsBus bus;
+} TraceMapEntry;
+
+/**
+ * @brief Open addressed pointer to id table, linear probing.
+ */
+typedef struct TraceMap {
+	TraceMapEntry *entries;
+	size_t capacity;
+	size_t count;
+} TraceMap;
+
+typedef struct TraceWriter {
+	FILE *file;
+	unsigned char *buffer;
+	size_t used;
+	Uint64 start_counter;
+	uint64_t last_time;
+	unsigned int next_sfx_id;
+	unsigned int next_bgm_id;
+	TraceMap sfx;
+	TraceMap bgm;
+} TraceWriter;
+
+struct TraceReader {
+	FILE *file;
+	uint64_t time;
+	// Holds the strings of the last record read.
+	char *strings;
+	size_t strings_size;
+};
+
+/**
+ * @brief Gets the trace of the current engine, each engine records its own calls.
+ */
+static TraceWriter *CurrentTrace(void);
+/**
+ * @brief Writes the buffered records to the file.
+ */
+static void FlushTrace(TraceWriter *trace);
+/**
+ * @brief Buffers bytes, flushing first if they don't fit.
+ */
+static void WriteTraceBytes(TraceWriter *trace, const void *bytes, size_t size);
+static void WriteVarint(TraceWriter *trace, uint64_t value);
+/**
+ * @brief Microseconds since the trace was opened.
+ */
+static uint64_t TraceNow(TraceWriter *trace);
+/**
+ * @brief Finds the entry for a pointer, or the empty slot it would go in.
+ */
+static TraceMapEntry *FindTraceEntry(TraceMap *map, const void *key);
+/**
+ * @brief Adds a pointer, growing the table past half full.
+ */
+static TraceMapEntry *InsertTraceEntry(TraceMap *map, const void *key, unsigned int id);
+/**
+ * @brief Removes a pointer, moving back the entries after it so lookups don't stop early.
+ */
+static void RemoveTraceEntry(TraceMap *map, const void *key);
+static int ReadVarint(FILE *file, uint64_t *value);
+
+int OpenTrace(const char *filename, const gsSoundConfig *config) {
+	static const gsSoundConfig default_config = {0};
+	gsEngine *engine = CurrentEngine();
+	if (!engine)
+		return 0;
+	if (engine->trace)
+		CloseTrace();
+	FILE *file = fopen(filename, "wb");
+	if (!file) {
+		fprintf(stderr, "Could not open trace file %s\n", filename);
+		return 0;
+	}
+	TraceWriter *trace = SoundCalloc(1, sizeof(*trace));
+	trace->file = file;
+	trace->buffer = SoundMalloc(TRACE_BUFFER_SIZE);
+	trace->start_counter = SDL_GetPerformanceCounter();
+	trace->next_sfx_id = trace->next_bgm_id = 1;
+	engine->trace = trace;
+	WriteTraceBytes(trace, "GSTR", 4);
+	unsigned char version = TRACE_VERSION;
+	WriteTraceBytes(trace, &version, 1);
+	if (!config)
+		config = &default_config;
+	TraceCall(TraceOp_Init, config->sample_rate, config->period_frames, config->channels, (int)config->command_mode,
+			  (double)config->sfx_stream_seconds, config->pcm_budget_bytes, config->compress_sfx, (double)config->cull_gain);
+	return 1;
+}
+
+void CloseTrace(void) {
+	TraceWriter *trace = CurrentTrace();
+	if (!trace)
+		return;
+	TraceCall(TraceOp_Close);
+	FlushTrace(trace);
+	fclose(trace->file);
+	SoundFree(trace->buffer);
+	SoundFree(trace->sfx.entries);
+	SoundFree(trace->bgm.entries);
+	SoundFree(trace);
+	CurrentEngine()->trace = NULL;
+}
+
+int TraceEnabled(void) {
+	return CurrentTrace() != NULL;
+}
+
+void TraceCall(TraceOp op, ...) {
+	TraceWriter *trace = CurrentTrace();
+	if (!trace)
+		return;
+	uint64_t now = TraceNow(trace);
+	unsigned char op_byte = (unsigned char)op;
+	WriteTraceBytes(trace, &op_byte, 1);
+	WriteVarint(trace, now - trace->last_time);
+	trace->last_time = now;
+	va_list args;
+	va_start(args, op);
+	for (const char *type = trace_op_signatures[op]; *type; ++type) {
+		switch (*type) {
+			case 'u':
+				WriteVarint(trace, va_arg(args, unsigned int));
+				break;
+			case 'i': {
+				int64_t value = va_arg(args, int);
+				WriteVarint(trace, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+				break;
+			}
+			case 'f': {
+				float value = (float)va_arg(args, double);
+				uint32_t bits;
+				memcpy(&bits, &value, sizeof(bits));
+				unsigned char bytes[4] = {bits, bits >> 8, bits >> 16, bits >> 24};
+				WriteTraceBytes(trace, bytes, sizeof(bytes));
+				break;
+			}
+			case 'd': {
+				double value = va_arg(args, double);
+				uint64_t bits;
+				memcpy(&bits, &value, sizeof(bits));
+				unsigned char bytes[8];
+				for (int i = 0; i < 8; ++i)
+					bytes[i] = (unsigned char)(bits >> (i * 8));
+				WriteTraceBytes(trace, bytes, sizeof(bytes));
+				break;
+			}
+			case 'z':
+				WriteVarint(trace, va_arg(args, size_t));
+				break;
+			case 'l':
+				WriteVarint(trace, va_arg(args, uint64_t));
+				break;
+			case 's': {
+				const char *value = va_arg(args, const char *);
+				size_t length = value ? strlen(value) : 0;
+				WriteVarint(trace, length);
+				if (length)
+					WriteTraceBytes(trace, value, length);
+				break;
+			}
+		}
+	}
+	va_end(args);
+}
+
+unsigned int TraceSfx(const gsSfx *sfx) {
+	TraceWriter *trace = CurrentTrace();
+	if (!trace || !sfx)
+		return 0;
+	TraceMapEntry *entry = FindTraceEntry(&trace->sfx, sfx);
+	if (!entry || !entry->key) {
+		entry = InsertTraceEntry(&trace->sfx, sfx, trace->next_sfx_id++);
+		// The entry starts zeroed like gsNewSfx leaves the fields, so a untouched sfx doesn't need a state record.
+		TraceCall(TraceOp_NewSfx, entry->id, sfx->sfx_name);
+	}
+	if (entry->priority != sfx->priority || entry->max_instances != sfx->max_instances ||
+		entry->min_retrigger_seconds != sfx->min_retrigger_seconds || entry->coalesce != sfx->coalesce || entry->stream != sfx->stream ||
+		entry->min_distance != sfx->min_distance || entry->max_distance != sfx->max_distance || entry->bus != sfx->bus) {
+		entry->priority = sfx->priority;
+		entry->max_instances = sfx->max_instances;
+		entry->min_retrigger_seconds = sfx->min_retrigger_seconds;
+		entry->coalesce = sfx->coalesce;
+		entry->stream = sfx->stream;
+		entry->min_distance = sfx->min_distance;
+		entry->max_distance = sfx->max_distance;
+		entry->bus = sfx->bus;
+		TraceCall(TraceOp_SfxState, entry->id, sfx->priority, sfx->max_instances, (double)sfx->min_retrigger_seconds, sfx->coalesce, sfx->stream,
+				  (double)sfx->min_distance, (double)sfx->max_distance, (int)sfx->bus);
+	}
+	return entry->id;
+}
+
+void TraceForgetSfx(const gsSfx *sfx) {
+	TraceWriter *trace = CurrentTrace();
+	if (trace && sfx)
+		RemoveTraceEntry(&trace->sfx, sfx);
+}
+
+unsigned int TraceBgm(const gsBgm *bgm) {
+	TraceWriter *trace = CurrentTrace();
+	if (!trace || !bgm)
+		return 0;
+	TraceMapEntry *entry = FindTraceEntry(&trace->bgm, bgm);
+	if (entry && entry->key)
+		return entry->id;
+	entry = InsertTraceEntry(&trace->bgm, bgm, trace->next_bgm_id++);
+	TraceCall(TraceOp_NewBgm, entry->id, bgm->bgm_name, bgm->loop_begin, bgm->loop_end);
+	return entry->id;
+}
+
+void TraceForgetBgm(const gsBgm *bgm) {
+	TraceWriter *trace = CurrentTrace();
+	if (trace && bgm)
+		RemoveTraceEntry(&trace->bgm, bgm);
+}
+
+static TraceWriter *CurrentTrace(void) {
+	gsEngine *engine = CurrentEngine();
+	return engine ? engine->trace : NULL;
+}
+
+static void FlushTrace(TraceWriter *trace) {
+	if (trace->used)
+		fwrite(trace->buffer, 1, trace->used, trace->file);
+	trace->used = 0;
+}
+
+static void WriteTraceBytes(TraceWriter *trace, const void *bytes, size_t size) {
+	if (trace->used + size > TRACE_BUFFER_SIZE)
+		FlushTrace(trace);
+	if (size > TRACE_BUFFER_SIZE) {
+		fwrite(bytes, 1, size, trace->file);
+		return;
+	}
+	memcpy(trace->buffer + trace->used, bytes, size);
+	trace->used += size;
+}
+
+static void WriteVarint(TraceWriter *trace, uint64_t value) {
+	unsigned char bytes[10];
+	size_t size = 0;
+	do {
+		bytes[size] = value & 0x7f;
+		value >>= 7;
+		if (value)
+			bytes[size] |= 0x80;
+		++size;
+	} while (value);
+	WriteTraceBytes(trace, bytes, size);
+}
+
+static uint64_t TraceNow(TraceWriter *trace) {
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 elapsed = SDL_GetPerformanceCounter() - trace->start_counter;
+	// Split so the multiply can't overflow on long sessions with fast counters.
+	return (elapsed / frequency) * 1000000 + (elapsed % frequency) * 1000000 / frequency;
+}
+
+static size_t HashTracePointer(const void *key) {
+	uint64_t value = (uint64_t)(uintptr_t)key;
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	return (size_t)value;
+}
+
+static TraceMapEntry *FindTraceEntry(TraceMap *map, const void *key) {
+	if (!map->capacity)
+		return NULL;
+	size_t mask = map->capacity - 1;
+	size_t i = HashTracePointer(key) & mask;
+	while (map->entries[i].key && map->entries[i].key != key)
+		i = (i + 1) & mask;
+	return &map->entries[i];
+}
+
+static TraceMapEntry *InsertTraceEntry(TraceMap *map, const void *key, unsigned int id) {
+	if ((map->count + 1) * 2 > map->capacity) {
+		TraceMap grown = {0};
+		grown.capacity = map->capacity ? map->capacity * 2 : TRACE_MAP_START;
+		grown.entries = SoundCalloc(grown.capacity, sizeof(TraceMapEntry));
+		grown.count = map->count;
+		for (size_t i = 0; i < map->capacity; ++i) {
+			if (map->entries[i].key)
+				*FindTraceEntry(&grown, map->entries[i].key) = map->entries[i];
+		}
+		SoundFree(map->entries);
+		*map = grown;
+	}
+	TraceMapEntry *entry = FindTraceEntry(map, key);
+	memset(entry, 0, sizeof(*entry));
+	entry->key = key;
+	entry->id = id;
+	++map->count;
+	return entry;
+}
+
+static void RemoveTraceEntry(TraceMap *map, const void *key) {
+	TraceMapEntry *entry = FindTraceEntry(map, key);
+	if (!entry || !entry->key)
+		return;
+	size_t mask = map->capacity - 1;
+	size_t hole = entry - map->entries;
+	map->entries[hole].key = NULL;
+	--map->count;
+	for (size_t i = (hole + 1) & mask; map->entries[i].key; i = (i + 1) & mask) {
+		size_t home = HashTracePointer(map->entries[i].key) & mask;
+		// Leave entries that would still be found from their home slot, move the rest into the hole.
+		int reachable = (hole <= i) ? (home > hole && home <= i) : (home > hole || home <= i);
+		if (reachable)
+			continue;
+		map->entries[hole] = map->entries[i];
+		map->entries[i].key = NULL;
+		hole = i;
+	}
+}
+
+TraceReader *OpenTraceReader(const char *filename) {
+	FILE *file = fopen(filename, "rb");
+	if (!file) {
+		fprintf(stderr, "Could not open trace file %s\n", filename);
+		return NULL;
+	}
+	unsigned char header[5];
+	if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, "GSTR", 4) != 0 || header[4] != TRACE_VERSION) {
+		fprintf(stderr, "%s is not a version %d sound trace\n", filename, TRACE_VERSION);
+		fclose(file);
+		return NULL;
+	}
+	TraceReader *reader = SoundCalloc(1, sizeof(*reader));
+	reader->file = file;
+	return reader;
+}
+
+int ReadTraceRecord(TraceReader *reader, TraceRecord *record) {
+	int op = fgetc(reader->file);
+	uint64_t delta;
+	if (op == EOF || op >= TraceOp_Count || !ReadVarint(reader->file, &delta))
+		return 0;
+	reader->time += delta;
+	record->op = (TraceOp)op;
+	record->time = reader->time;
+	const char *signature = trace_op_signatures[op];
+	size_t strings_used = 0;
+	for (int arg = 0; signature[arg]; ++arg) {
+		TraceArg *value = &record->args[arg];
+		switch (signature[arg]) {
+			case 'u':
+			case 'z':
+			case 'l':
+				if (!ReadVarint(reader->file, &value->u))
+					return 0;
+				break;
+			case 'i': {
+				uint64_t zigzag;
+				if (!ReadVarint(reader->file, &zigzag))
+					return 0;
+				value->i = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+				break;
+			}
+			case 'f': {
+				unsigned char bytes[4];
+				if (fread(bytes, 1, sizeof(bytes), reader->file) != sizeof(bytes))
+					return 0;
+				uint32_t bits = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+				float f;
+				memcpy(&f, &bits, sizeof(f));
+				value->f = f;
+				break;
+			}
+			case 'd': {
+				unsigned char bytes[8];
+				if (fread(bytes, 1, sizeof(bytes), reader->file) != sizeof(bytes))
+					return 0;
+				uint64_t bits = 0;
+				for (int i = 0; i < 8; ++i)
+					bits |= (uint64_t)bytes[i] << (i * 8);
+				memcpy(&value->f, &bits, sizeof(value->f));
+				break;
+			}
+			case 's': {
+				uint64_t length;
+				if (!ReadVarint(reader->file, &length))
+					return 0;
+				if (strings_used + length + 1 > reader->strings_size) {
+					reader->strings_size = strings_used + length + 1;
+					reader->strings = SoundRealloc(reader->strings, reader->strings_size);
+				}
+				if (fread(reader->strings + strings_used, 1, length, reader->file) != length)
+					return 0;
+				reader->strings[strings_used + length] = '\0';
+				// Offsets until every string is read, the buffer can move as it grows.
+				value->u = strings_used;
+				strings_used += length + 1;
+				break;
+			}
+		}
+	}
+	for (int arg = 0; signature[arg]; ++arg) {
+		if (signature[arg] == 's')
+			record->args[arg].s = reader->strings + record->args[arg].u;
+	}
+	return 1;
+}
+
+void CloseTraceReader(TraceReader *reader) {
+	if (!reader)
+		return;
+	fclose(reader->file);
+	SoundFree(reader->strings);
+	SoundFree(reader);
+}
+
+static int ReadVarint(FILE *file, uint64_t *value) {
+	*value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int byte = fgetc(file);
+		if (byte == EOF)
+			return 0;
+		*value |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return 1;
+	}
+	return 0;
+}
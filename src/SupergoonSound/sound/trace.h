@@ -0,0 +1,159 @@
+/**
+ * @file trace.h
+ * @brief Records public sound calls to a compact binary trace, and reads them back for the replay tool.
+ * @author Kevin Blanchard
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * A trace is the bytes "GSTR" and a version byte, then one record per call.  A record is the op byte, the
+ * microseconds since the last record as a varint, then the op's arguments in the order of its signature:
+ * u is a unsigned varint, i a zigzag varint, f a little endian float, d a little endian double, z a size_t as a
+ * unsigned varint, l a uint64_t as a unsigned varint, and s a string as a varint length and its bytes.  Sfx and bgm are written as ids, the first
+ * time one is seen a NewSfx or NewBgm record gives its file, and sfx fields set directly are written as a
+ * SfxState record when they change.
+ */
+#pragma once
+#include <SupergoonSound/include/sound.h>
+#include <stdint.h>
+
+#define TRACE_VERSION 7
+#define TRACE_MAX_ARGS 12
+
+typedef enum TraceOp {
+	TraceOp_Init,
+	TraceOp_Close,
+	TraceOp_Update,
+	TraceOp_NewSfx,
+	TraceOp_SfxState,
+	TraceOp_LoadSfx,
+	TraceOp_UnloadSfx,
+	TraceOp_SetSfxLimits,
+	TraceOp_PlaySfxOneShot,
+	TraceOp_PlaySfxLooped,
+	TraceOp_PlaySfxBatch,
+	TraceOp_PlaySfxBatchItem,
+	TraceOp_StopVoice,
+	TraceOp_SetVoiceVolume,
+	TraceOp_SetVoicePitch,
+	TraceOp_SetVoicePan,
+	TraceOp_VoiceIsPlaying,
+	TraceOp_VoiceIsVirtual,
+	TraceOp_NewBgm,
+	TraceOp_UnloadBgm,
+	TraceOp_PreLoadBgm,
+	TraceOp_PlayBgm,
+	TraceOp_PlayBackgroundBgm,
+	TraceOp_StopBgm,
+	TraceOp_StopBackgroundBgm,
+	TraceOp_PauseBgm,
+	TraceOp_UnPauseBgm,
+	TraceOp_SetPlayerLoops,
+	TraceOp_BgmTell,
+	TraceOp_BgmSeek,
+	TraceOp_SetPcmBudget,
+	TraceOp_GetSoundStats,
+	TraceOp_PlaySfxAt,
+	TraceOp_SetEmitterPositions,
+	TraceOp_SetEmitterPositionsItem,
+	TraceOp_SetListener,
+	TraceOp_SetVoiceOccluded,
+	TraceOp_PreLoadStems,
+	TraceOp_PreLoadStemsItem,
+	TraceOp_PlayStems,
+	TraceOp_StopStems,
+	TraceOp_PauseStems,
+	TraceOp_UnPauseStems,
+	TraceOp_SetStemGain,
+	TraceOp_StemsTell,
+	TraceOp_StemsSeek,
+	TraceOp_StopVoiceScheduled,
+	TraceOp_PlayBgmScheduled,
+	TraceOp_GetSoundClock,
+	TraceOp_SetBusVolume,
+	TraceOp_SetBusMuted,
+	TraceOp_SetBusPaused,
+	TraceOp_SetBusParent,
+	TraceOp_FadeVoice,
+	TraceOp_FadeBgm,
+	TraceOp_Count,
+} TraceOp;
+
+/**
+ * @brief The argument types of every op, in the order they are written.
+ */
+extern const char *const trace_op_signatures[TraceOp_Count];
+/**
+ * @brief The name of every op, for printing.
+ */
+extern const char *const trace_op_names[TraceOp_Count];
+
+typedef union TraceArg {
+	uint64_t u;
+	int64_t i;
+	double f;
+	const char *s;
+} TraceArg;
+
+/**
+ * @brief A record read back from a trace.
+ */
+typedef struct TraceRecord {
+	TraceOp op;
+	// Microseconds since the trace was opened.
+	uint64_t time;
+	TraceArg args[TRACE_MAX_ARGS];
+} TraceRecord;
+
+typedef struct TraceReader TraceReader;
+
+/**
+ * @brief Starts recording calls, writes the header and a Init record with the config.
+ *
+ * @param filename The file to write, it is replaced.
+ * @param config The config sound was initialized with, NULL for the defaults.
+ *
+ * @return 1 if it is recording, 0 if the file couldn't be opened.
+ */
+int OpenTrace(const char *filename, const gsSoundConfig *config);
+/**
+ * @brief Writes a Close record and finishes the file, does nothing if not recording.
+ */
+void CloseTrace(void);
+/**
+ * @brief Checks if calls are being recorded, so hooks can skip building their arguments.
+ */
+int TraceEnabled(void);
+/**
+ * @brief Writes a record, the arguments must match the op signature, with f passed as a double, u as a unsigned int, i as a int, z as a size_t, l as a uint64_t and s as a const char *.
+ */
+void TraceCall(TraceOp op, ...);
+/**
+ * @brief Gets the id a sfx is written as, writing a NewSfx record the first time it is seen, and a SfxState record if its fields changed since last time.
+ */
+unsigned int TraceSfx(const gsSfx *sfx);
+/**
+ * @brief Forgets a sfx that is being freed, so the pointer can be reused.
+ */
+void TraceForgetSfx(const gsSfx *sfx);
+/**
+ * @brief Gets the id a bgm is written as, writing a NewBgm record the first time it is seen.
+ */
+unsigned int TraceBgm(const gsBgm *bgm);
+/**
+ * @brief Forgets a bgm that is being freed, so the pointer can be reused.
+ */
+void TraceForgetBgm(const gsBgm *bgm);
+
+/**
+ * @brief Opens a trace to read.
+ *
+ * @return The reader, or NULL if the file couldn't be read or isn't a trace.
+ */
+TraceReader *OpenTraceReader(const char *filename);
+/**
+ * @brief Reads the next record.  Strings in it are valid until the next read.
+ *
+ * @return 1 if a record was read, 0 at the end of the trace or if it is cut short.
+ */
+int ReadTraceRecord(TraceReader *reader, TraceRecord *record);
+void CloseTraceReader(TraceReader *reader);
@@ -0,0 +1,524 @@
+/**
+ * @file replay.c
+ * @brief Replays a sound trace against a headless mixer, so a recorded session can be profiled the same way every time.
+ * @author Kevin Blanchard
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * Usage: sgReplay <trace> [-realtime] [-o <file>] [-mix-threads <n>]
+ * Calls are made in order, and before each one the mix is rendered up to the time it was recorded at.  By default
+ * that is as fast as possible, -realtime waits for the recorded time before each call.  -o writes the mix to a file
+ * as raw interleaved floats.  -mix-threads mixes voices on that many extra threads, to compare against mixing on
+ * one.  Sfx and bgm are loaded by the names they were recorded with, so run it from the same directory the game was
+ * run from.
+ */
+#include <SupergoonSound/gnpch.h>
+#include <SupergoonSound/include/sound.h>
+#include <SupergoonSound/sound/trace.h>
+
+#define REPLAY_VOICE_MAP_SIZE 65536	 // One entry for every voice slot index, the low 16 bits of a voice.
+
+typedef struct ReplayVoice {
+	gsVoice recorded;
+	gsVoice replayed;
+} ReplayVoice;
+
+typedef struct ReplayOpStats {
+	unsigned long count;
+	Uint64 ticks;
+} ReplayOpStats;
+
+typedef struct Replay {
+	int realtime;
+	int mix_threads;
+	FILE *output;
+	int sample_rate;
+	int channels;
+	int period_frames;
+	float *mix;
+	uint64_t rendered_frames;
+	Uint64 render_ticks;
+	Uint64 start_ticks;
+	// Indexed by the recorded id, NULL when unloaded.
+	gsSfx **sfx;
+	unsigned int num_sfx;
+	gsBgm **bgm;
+	unsigned int num_bgm;
+	ReplayVoice *voices;
+	// Batch items waiting for the rest of their batch.
+	gsPlayRequest *batch;
+	gsVoice *batch_recorded;
+	unsigned int batch_count;
+	unsigned int batch_size;
+	// Stem files waiting for the rest of their PreLoadStems, and the stems they were last loaded as.
+	char *stem_names[GS_MAX_STEMS];
+	unsigned int stems_count;
+	unsigned int stems_size;
+	gsStems *stems;
+	ReplayOpStats ops[TraceOp_Count];
+} Replay;
+
+/**
+ * @brief Initializes sound headless with the settings from the Init record.
+ *
+ * @return 1 if successful, 0 if sound couldn't start.
+ */
+static int StartReplay(Replay *replay, const TraceRecord *init);
+/**
+ * @brief Mixes until the recorded time, waiting for it first when realtime.
+ */
+static void RenderUntil(Replay *replay, uint64_t time);
+/**
+ * @brief Makes the call a record was written for.
+ */
+static void ReplayRecord(Replay *replay, const TraceRecord *record);
+static gsSfx *ReplaySfx(Replay *replay, uint64_t id);
+static gsBgm *ReplayBgm(Replay *replay, uint64_t id);
+/**
+ * @brief Remembers which voice a recorded voice was replayed on.
+ */
+static void MapVoice(Replay *replay, gsVoice recorded, gsVoice replayed);
+/**
+ * @brief Gets the voice a recorded voice was replayed on, 0 if it wasn't started or is stale.
+ */
+static gsVoice ReplayVoiceFor(Replay *replay, uint64_t recorded);
+static void PrintReplayStats(const Replay *replay, uint64_t length);
+
+int main(int argc, char *argv[]) {
+	const char *trace_filename = NULL;
+	const char *output_filename = NULL;
+	Replay replay = {0};
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-realtime") == 0) {
+			replay.realtime = 1;
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output_filename = argv[++i];
+		} else if (strcmp(argv[i], "-mix-threads") == 0 && i + 1 < argc) {
+			replay.mix_threads = atoi(argv[++i]);
+		} else {
+			trace_filename = argv[i];
+		}
+	}
+	if (!trace_filename) {
+		fprintf(stderr, "Usage: %s <trace> [-realtime] [-o <file>] [-mix-threads <n>]\n", argv[0]);
+		return 1;
+	}
+	TraceReader *reader = OpenTraceReader(trace_filename);
+	if (!reader)
+		return 1;
+	TraceRecord record;
+	if (!ReadTraceRecord(reader, &record) || record.op != TraceOp_Init) {
+		fprintf(stderr, "%s doesn't start with a Init record\n", trace_filename);
+		CloseTraceReader(reader);
+		return 1;
+	}
+	if (output_filename && !(replay.output = fopen(output_filename, "wb"))) {
+		fprintf(stderr, "Could not open output file %s\n", output_filename);
+		CloseTraceReader(reader);
+		return 1;
+	}
+	if (!StartReplay(&replay, &record)) {
+		CloseTraceReader(reader);
+		return 1;
+	}
+	uint64_t length = 0;
+	while (ReadTraceRecord(reader, &record) && record.op != TraceOp_Close) {
+		RenderUntil(&replay, record.time);
+		Uint64 start = SDL_GetPerformanceCounter();
+		ReplayRecord(&replay, &record);
+		replay.ops[record.op].ticks += SDL_GetPerformanceCounter() - start;
+		replay.ops[record.op].count++;
+		length = record.time;
+	}
+	CloseTraceReader(reader);
+	PrintReplayStats(&replay, length);
+	for (unsigned int i = 0; i < replay.num_sfx; ++i) {
+		if (replay.sfx[i])
+			gsUnloadSfx(replay.sfx[i]);
+	}
+	for (unsigned int i = 0; i < replay.num_bgm; ++i)
+		gsUnloadBgm(replay.bgm[i]);
+	gsUnloadStems(replay.stems);
+	gsCloseSound();
+	if (replay.output)
+		fclose(replay.output);
+	free(replay.sfx);
+	free(replay.bgm);
+	free(replay.voices);
+	free(replay.batch);
+	free(replay.batch_recorded);
+	free(replay.mix);
+	return 0;
+}
+
+static int StartReplay(Replay *replay, const TraceRecord *init) {
+	gsSoundConfig config = {0};
+	config.sample_rate = (int)init->args[0].i;
+	config.period_frames = (int)init->args[1].i;
+	config.channels = (int)init->args[2].i;
+	// Replays run on one thread, the recorded order is already the order the sound state saw.
+	config.command_mode = gsCommandMode_Direct;
+	config.sfx_stream_seconds = (float)init->args[4].f;
+	config.pcm_budget_bytes = (size_t)init->args[5].u;
+	config.compress_sfx = (int)init->args[6].i;
+	config.cull_gain = (float)init->args[7].f;
+	config.headless = 1;
+	config.mix_threads = replay->mix_threads;
+	if (!gsInitializeSoundEx(&config)) {
+		fprintf(stderr, "Could not initialize headless sound\n");
+		return 0;
+	}
+	replay->sample_rate = config.sample_rate > 0 ? config.sample_rate : 48000;
+	replay->period_frames = config.period_frames > 0 ? config.period_frames : 1024;
+	switch (config.channels) {
+		case 1:
+		case 4:
+		case 6:
+		case 7:
+		case 8:
+			replay->channels = config.channels;
+			break;
+		default:
+			replay->channels = 2;
+			break;
+	}
+	replay->mix = malloc(replay->period_frames * replay->channels * sizeof(float));
+	replay->voices = calloc(REPLAY_VOICE_MAP_SIZE, sizeof(ReplayVoice));
+	replay->start_ticks = SDL_GetPerformanceCounter();
+	return 1;
+}
+
+static void RenderUntil(Replay *replay, uint64_t time) {
+	if (replay->realtime) {
+		Uint64 frequency = SDL_GetPerformanceFrequency();
+		for (;;) {
+			Uint64 elapsed = SDL_GetPerformanceCounter() - replay->start_ticks;
+			uint64_t now = (elapsed / frequency) * 1000000 + (elapsed % frequency) * 1000000 / frequency;
+			if (now >= time)
+				break;
+			SDL_Delay((Uint32)((time - now) / 1000));
+		}
+	}
+	uint64_t target = time * replay->sample_rate / 1000000;
+	while (replay->rendered_frames < target) {
+		int frames = (int)SDL_min((uint64_t)replay->period_frames, target - replay->rendered_frames);
+		Uint64 start = SDL_GetPerformanceCounter();
+		gsRenderSound(replay->mix, frames);
+		replay->render_ticks += SDL_GetPerformanceCounter() - start;
+		if (replay->output)
+			fwrite(replay->mix, sizeof(float) * replay->channels, frames, replay->output);
+		replay->rendered_frames += frames;
+	}
+}
+
+static void ReplayRecord(Replay *replay, const TraceRecord *record) {
+	const TraceArg *args = record->args;
+	switch (record->op) {
+		case TraceOp_Init:
+		case TraceOp_Close:
+		case TraceOp_Count:
+			break;
+		case TraceOp_Update:
+			gsUpdateSound();
+			break;
+		case TraceOp_NewSfx: {
+			unsigned int id = (unsigned int)args[0].u;
+			if (id >= replay->num_sfx) {
+				unsigned int num_sfx = SDL_max(id + 1, replay->num_sfx * 2);
+				replay->sfx = realloc(replay->sfx, num_sfx * sizeof(*replay->sfx));
+				memset(replay->sfx + replay->num_sfx, 0, (num_sfx - replay->num_sfx) * sizeof(*replay->sfx));
+				replay->num_sfx = num_sfx;
+			}
+			replay->sfx[id] = gsNewSfx(args[1].s);
+			break;
+		}
+		case TraceOp_SfxState: {
+			gsSfx *sfx = ReplaySfx(replay, args[0].u);
+			if (!sfx)
+				break;
+			sfx->priority = (int)args[1].i;
+			sfx->max_instances = (int)args[2].i;
+			sfx->min_retrigger_seconds = (float)args[3].f;
+			sfx->coalesce = (int)args[4].i;
+			sfx->stream = (int)args[5].i;
+			sfx->min_distance = (float)args[6].f;
+			sfx->max_distance = (float)args[7].f;
+			sfx->bus = (gsBus)args[8].i;
+			break;
+		}
+		case TraceOp_LoadSfx: {
+			gsSfx *sfx = ReplaySfx(replay, args[0].u);
+			if (sfx)
+				gsLoadSfx(sfx);
+			break;
+		}
+		case TraceOp_UnloadSfx: {
+			gsSfx *sfx = ReplaySfx(replay, args[0].u);
+			if (sfx) {
+				gsUnloadSfx(sfx);
+				replay->sfx[args[0].u] = NULL;
+			}
+			break;
+		}
+		case TraceOp_SetSfxLimits: {
+			gsSfx *sfx = ReplaySfx(replay, args[0].u);
+			if (sfx)
+				gsSetSfxLimits(sfx, (int)args[1].i, (float)args[2].f, (int)args[3].i);
+			break;
+		}
+		case TraceOp_PlaySfxOneShot:
+		case TraceOp_PlaySfxLooped: {
+			gsSfx *sfx = ReplaySfx(replay, args[0].u);
+			if (!sfx)
+				break;
+			gsVoice voice = record->op == TraceOp_PlaySfxOneShot ? gsPlaySfxOneShot(sfx, (float)args[1].f) : gsPlaySfxLooped(sfx, (float)args[1].f);
+			MapVoice(replay, (gsVoice)args[2].u, voice);
+			break;
+		}
+		case TraceOp_PlaySfxBatch:
+			replay->batch_count = 0;
+			replay->batch_size = (unsigned int)args[0].u;
+			replay->batch = realloc(replay->batch, replay->batch_size * sizeof(*replay->batch));
+			replay->batch_recorded = realloc(replay->batch_recorded, replay->batch_size * sizeof(*replay->batch_recorded));
+			break;
+		case TraceOp_PlaySfxBatchItem: {
+			if (replay->batch_count == replay->batch_size)
+				break;
+			gsPlayRequest *request = &replay->batch[replay->batch_count];
+			request->sfx = ReplaySfx(replay, args[0].u);
+			request->volume = (float)args[1].f;
+			request->pitch = (float)args[2].f;
+			request->pan = (float)args[3].f;
+			request->looping = (int)args[4].i;
+			request->positional = (int)args[6].i;
+			for (int i = 0; i < 3; ++i)
+				request->position[i] = (float)args[7 + i].f;
+			request->start_frame = args[10].u;
+			replay->batch_recorded[replay->batch_count++] = (gsVoice)args[5].u;
+			if (replay->batch_count < replay->batch_size)
+				break;
+			// The whole batch is played with the last item, reuse the recorded voices for the replayed ones.
+			gsVoice *voices = malloc(replay->batch_size * sizeof(*voices));
+			gsPlaySfxBatch(replay->batch, (int)replay->batch_size, voices);
+			for (unsigned int i = 0; i < replay->batch_size; ++i)
+				MapVoice(replay, replay->batch_recorded[i], voices[i]);
+			free(voices);
+			break;
+		}
+		case TraceOp_StopVoice:
+			gsStopVoice(ReplayVoiceFor(replay, args[0].u));
+			break;
+		case TraceOp_SetVoiceVolume:
+			gsSetVoiceVolume(ReplayVoiceFor(replay, args[0].u), (float)args[1].f);
+			break;
+		case TraceOp_SetVoicePitch:
+			gsSetVoicePitch(ReplayVoiceFor(replay, args[0].u), (float)args[1].f);
+			break;
+		case TraceOp_SetVoicePan:
+			gsSetVoicePan(ReplayVoiceFor(replay, args[0].u), (float)args[1].f);
+			break;
+		case TraceOp_VoiceIsPlaying:
+			gsVoiceIsPlaying(ReplayVoiceFor(replay, args[0].u));
+			break;
+		case TraceOp_VoiceIsVirtual:
+			gsVoiceIsVirtual(ReplayVoiceFor(replay, args[0].u));
+			break;
+		case TraceOp_NewBgm: {
+			unsigned int id = (unsigned int)args[0].u;
+			if (id >= replay->num_bgm) {
+				unsigned int num_bgm = SDL_max(id + 1, replay->num_bgm * 2);
+				replay->bgm = realloc(replay->bgm, num_bgm * sizeof(*replay->bgm));
+				memset(replay->bgm + replay->num_bgm, 0, (num_bgm - replay->num_bgm) * sizeof(*replay->bgm));
+				replay->num_bgm = num_bgm;
+			}
+			replay->bgm[id] = gsLoadBgmWithLoopPoints(args[1].s, (float)args[2].f, (float)args[3].f);
+			break;
+		}
+		case TraceOp_UnloadBgm:
+			gsUnloadBgm(ReplayBgm(replay, args[0].u));
+			if (args[0].u < replay->num_bgm)
+				replay->bgm[args[0].u] = NULL;
+			break;
+		case TraceOp_PreLoadBgm: {
+			gsBgm *bgm = ReplayBgm(replay, args[0].u);
+			if (bgm)
+				gsPreLoadBgm(bgm, (int)args[1].i);
+			break;
+		}
+		case TraceOp_PlayBgm:
+			gsPlayBgm((float)args[0].f);
+			break;
+		case TraceOp_PlayBackgroundBgm:
+			gsPlayBackgroundBgm((float)args[0].f);
+			break;
+		case TraceOp_StopBgm:
+			gsStopBgm();
+			break;
+		case TraceOp_StopBackgroundBgm:
+			gsStopBackgroundBgm();
+			break;
+		case TraceOp_PauseBgm:
+			gsPauseBgm();
+			break;
+		case TraceOp_UnPauseBgm:
+			gsUnPauseBgm();
+			break;
+		case TraceOp_SetPlayerLoops:
+			gsSetPlayerLoops((int)args[0].i);
+			break;
+		case TraceOp_BgmTell:
+			gsBgmTell((int)args[0].i);
+			break;
+		case TraceOp_BgmSeek:
+			gsBgmSeek((int)args[0].i, args[1].f);
+			break;
+		case TraceOp_SetPcmBudget:
+			gsSetPcmBudget((size_t)args[0].u);
+			break;
+		case TraceOp_GetSoundStats: {
+			gsSoundStats stats;
+			gsGetSoundStats(&stats);
+			break;
+		}
+		case TraceOp_PlaySfxAt: {
+			gsSfx *sfx = ReplaySfx(replay, args[0].u);
+			if (!sfx)
+				break;
+			float x = (float)args[3].f, y = (float)args[4].f, z = (float)args[5].f;
+			gsVoice voice = args[2].i ? gsPlaySfxLoopedAt(sfx, (float)args[1].f, x, y, z) : gsPlaySfxAt(sfx, (float)args[1].f, x, y, z);
+			MapVoice(replay, (gsVoice)args[6].u, voice);
+			break;
+		}
+		case TraceOp_SetEmitterPositions:
+			// Moves only reach the mixer on update, so the items are replayed one at a time.
+			break;
+		case TraceOp_SetEmitterPositionsItem: {
+			gsVoice voice = ReplayVoiceFor(replay, args[0].u);
+			float position[3] = {(float)args[1].f, (float)args[2].f, (float)args[3].f};
+			gsSetEmitterPositions(&voice, position, 1);
+			break;
+		}
+		case TraceOp_SetListener: {
+			gsListener listener;
+			for (int i = 0; i < 3; ++i) {
+				listener.position[i] = (float)args[i].f;
+				listener.forward[i] = (float)args[3 + i].f;
+				listener.up[i] = (float)args[6 + i].f;
+			}
+			gsSetListener(&listener);
+			break;
+		}
+		case TraceOp_SetVoiceOccluded:
+			gsSetVoiceOccluded(ReplayVoiceFor(replay, args[0].u), (int)args[1].i);
+			break;
+		case TraceOp_PreLoadStems:
+			replay->stems_count = 0;
+			replay->stems_size = (unsigned int)SDL_min(args[0].u, GS_MAX_STEMS);
+			break;
+		case TraceOp_PreLoadStemsItem: {
+			if (replay->stems_count == replay->stems_size)
+				break;
+			replay->stem_names[replay->stems_count++] = SDL_strdup(args[0].s);
+			if (replay->stems_count < replay->stems_size)
+				break;
+			gsUnloadStems(replay->stems);
+			replay->stems = gsLoadStems((const char *const *)replay->stem_names, (int)replay->stems_size);
+			for (unsigned int i = 0; i < replay->stems_size; ++i)
+				SDL_free(replay->stem_names[i]);
+			if (replay->stems)
+				gsPreLoadStems(replay->stems);
+			break;
+		}
+		case TraceOp_PlayStems:
+			gsPlayStems((float)args[0].f);
+			break;
+		case TraceOp_StopStems:
+			gsStopStems();
+			break;
+		case TraceOp_PauseStems:
+			gsPauseStems();
+			break;
+		case TraceOp_UnPauseStems:
+			gsUnPauseStems();
+			break;
+		case TraceOp_SetStemGain:
+			gsSetStemGain((int)args[0].i, (float)args[1].f, (float)args[2].f);
+			break;
+		case TraceOp_StemsTell:
+			gsStemsTell();
+			break;
+		case TraceOp_StemsSeek:
+			gsStemsSeek(args[0].f);
+			break;
+		case TraceOp_StopVoiceScheduled:
+			gsStopVoiceScheduled(ReplayVoiceFor(replay, args[0].u), args[1].u);
+			break;
+		case TraceOp_PlayBgmScheduled:
+			gsPlayBgmScheduled((float)args[0].f, args[1].u);
+			break;
+		case TraceOp_GetSoundClock:
+			gsGetSoundClock();
+			break;
+		case TraceOp_SetBusVolume:
+			gsSetBusVolume((gsBus)args[0].i, (float)args[1].f);
+			break;
+		case TraceOp_SetBusMuted:
+			gsSetBusMuted((gsBus)args[0].i, (int)args[1].i);
+			break;
+		case TraceOp_SetBusPaused:
+			gsSetBusPaused((gsBus)args[0].i, (int)args[1].i);
+			break;
+		case TraceOp_SetBusParent:
+			gsSetBusParent((gsBus)args[0].i, (gsBus)args[1].i);
+			break;
+		case TraceOp_FadeVoice:
+			gsFadeVoice(ReplayVoiceFor(replay, args[0].u), (float)args[1].f, (float)args[2].f, (int)args[3].i);
+			break;
+		case TraceOp_FadeBgm:
+			gsFadeBgm((int)args[0].i, (float)args[1].f, (float)args[2].f, (int)args[3].i);
+			break;
+	}
+}
+
+static gsSfx *ReplaySfx(Replay *replay, uint64_t id) {
+	return id < replay->num_sfx ? replay->sfx[id] : NULL;
+}
+
+static gsBgm *ReplayBgm(Replay *replay, uint64_t id) {
+	return id < replay->num_bgm ? replay->bgm[id] : NULL;
+}
+
+static void MapVoice(Replay *replay, gsVoice recorded, gsVoice replayed) {
+	if (!recorded)
+		return;
+	ReplayVoice *entry = &replay->voices[recorded & (REPLAY_VOICE_MAP_SIZE - 1)];
+	entry->recorded = recorded;
+	entry->replayed = replayed;
+}
+
+static gsVoice ReplayVoiceFor(Replay *replay, uint64_t recorded) {
+	const ReplayVoice *entry = &replay->voices[recorded & (REPLAY_VOICE_MAP_SIZE - 1)];
+	return (recorded && entry->recorded == recorded) ? entry->replayed : 0;
+}
+
+static void PrintReplayStats(const Replay *replay, uint64_t length) {
+	double frequency = (double)SDL_GetPerformanceFrequency();
+	double wall_seconds = (SDL_GetPerformanceCounter() - replay->start_ticks) / frequency;
+	double render_seconds = replay->render_ticks / frequency;
+	double mixed_seconds = (double)replay->rendered_frames / replay->sample_rate;
+	printf("Session length  %10.3f s\n", length / 1000000.0);
+	printf("Replay time     %10.3f s\n", wall_seconds);
+	printf("Mixing time     %10.3f s for %.3f s of sound, %.1fx realtime\n", render_seconds, mixed_seconds, render_seconds > 0 ? mixed_seconds / render_seconds : 0.0);
+	gsCallbackTiming timing;
+	if (gsGetCallbackTiming(&timing, 0))
+		printf("Period load     p50 %.3f  p99 %.3f  max %.3f of %.3f ms, %lu of %lu periods overran\n", timing.p50_load, timing.p99_load,
+			   timing.max_load, timing.deadline_ms, timing.overruns, timing.callbacks);
+	printf("\n%-20s %10s %12s %10s\n", "Call", "Count", "Total ms", "Avg us");
+	for (int op = 0; op < TraceOp_Count; ++op) {
+		const ReplayOpStats *stats = &replay->ops[op];
+		if (!stats->count)
+			continue;
+		double total_ms = stats->ticks * 1000.0 / frequency;
+		printf("%-20s %10lu %12.3f %10.2f\n", trace_op_names[op], stats->count, total_ms, total_ms * 1000.0 / stats->count);
+	}
+}